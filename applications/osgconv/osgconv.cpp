@@ -518,6 +518,8 @@ static void usage( const char *prog, const char *msg )
                               "                         (--addMissingColours also accepted)."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --overallNormal    - Replace normals with a single overall normal."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --enable-object-cache - Enable caching of objects, images, etc."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --read-threads <n> - Number of threads reading the input files, by default\n"
+                              "                         OSG_NUM_READ_FILE_THREADS or the number of processors."<< std::endl;
 
     osg::notify( osg::NOTICE ) << std::endl;
     osg::notify( osg::NOTICE ) <<
@@ -530,6 +532,10 @@ static void usage( const char *prog, const char *msg )
     osg::notify( osg::NOTICE ) <<
         "    --plugin <plugin>  - Display information about the specified <plugin>,\n"
         "                         where <plugin> is the plugin's full path and file name." << std::endl;
+    osg::notify( osg::NOTICE ) <<
+        "    --plugin-manifest <file> - Write a manifest of the extensions supported by\n"
+        "                         each plugin, for OSG_PLUGIN_MANIFEST or to install as\n"
+        "                         osgPlugins-<version>/osgdb_plugins.manifest." << std::endl;
 }
 
 
@@ -575,6 +581,12 @@ int main( int argc, char **argv )
         return 0;
     }
 
+    std::string manifest;
+    if (arguments.read("--plugin-manifest", manifest))
+    {
+        return osgDB::writePluginManifest(manifest) ? 0 : 1;
+    }
+
     std::string plugin;
     if (arguments.read("--plugin", plugin))
     {
@@ -751,6 +763,9 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    unsigned int numReadThreads = 0;
+    while(arguments.read("--read-threads", numReadThreads)) {}
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -784,7 +799,27 @@ int main( int argc, char **argv )
 
     osg::Timer_t startTick = osg::Timer::instance()->tick();
 
-    osg::ref_ptr<osg::Node> root = osgDB::readRefNodeFiles(fileNames);
+    // read the input files concurrently, reporting the ones that fail
+    osgDB::ReadResultList results = osgDB::readNodeFilesConcurrently(fileNames, osgDB::Registry::instance()->getOptions(), numReadThreads);
+
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    for(unsigned int i=0; i<results.size(); ++i)
+    {
+        if (results[i].validNode())
+        {
+            osg::Node* node = results[i].getNode();
+            if (node->getName().empty()) node->setName(fileNames[i]);
+            group->addChild(node);
+        }
+        else
+        {
+            std::cout<<"Error reading file "<<fileNames[i]<<": "<<results[i].statusMessage()<<std::endl;
+        }
+    }
+
+    osg::ref_ptr<osg::Node> root;
+    if (group->getNumChildren()==1) root = group->getChild(0);
+    else if (group->getNumChildren()>1) root = group;
 
     if (root.valid())
     {
@@ -415,6 +415,8 @@ int main( int argc, char **argv )
     arguments.getApplicationUsage()->addCommandLineOption("-e level minX minY maxX maxY","Read down to <level> across the extents minX, minY to maxY, maxY.  Note, for geocentric datase X and Y are longitude and latitude respectively.");
     arguments.getApplicationUsage()->addCommandLineOption("-c directory","Shorthand for --file-cache directory.");
     arguments.getApplicationUsage()->addCommandLineOption("--file-cache directory","Set directory as to place cache download files.");
+    arguments.getApplicationUsage()->addCommandLineOption("--no-write-behind","Write each file to the cache before reading the next, rather than on a background thread.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-cache-size megabytes","Bound the size of the cache directory, removing the oldest files first.");
 
     // if user request help write it out to cout.
     if (arguments.read("-h") || arguments.read("--help"))
@@ -443,7 +445,16 @@ int main( int argc, char **argv )
         return 1;
     }
 
-    ldv.setFileCache(new osgDB::FileCache(fileCachePath));
+    osg::ref_ptr<osgDB::FileCache> fileCache = new osgDB::FileCache(fileCachePath);
+
+    // downloads go on while earlier tiles are written out, flushed before exiting
+    fileCache->setWriteBehind(!arguments.read("--no-write-behind"));
+
+    double maxCacheSize = 0.0;
+    while(arguments.read("--max-cache-size",maxCacheSize)) {}
+    if (maxCacheSize>0.0) fileCache->setMaximumSizeInBytes(static_cast<uint64_t>(maxCacheSize*1024.0*1024.0));
+
+    ldv.setFileCache(fileCache.get());
 
     unsigned int maxLevels = 0;
     while(arguments.read("-l",maxLevels))
@@ -489,6 +500,18 @@ int main( int argc, char **argv )
         std::cout<<"osgfilecache exited in response to signal : "<<s_SigValue<<std::endl;
     }
 
+    if (fileCache->getNumPendingWrites()>0)
+    {
+        std::cout<<"Writing "<<fileCache->getNumPendingWrites()<<" remaining files to the cache."<<std::endl;
+        fileCache->flush();
+    }
+
+    osgDB::FileCache::Statistics statistics = fileCache->getStatistics();
+    std::cout<<"Written "<<statistics.numWrites<<" files to the cache";
+    if (statistics.numFailedWrites>0) std::cout<<", "<<statistics.numFailedWrites<<" failed";
+    if (statistics.numEvictions>0) std::cout<<", removed "<<statistics.numEvictions<<" to keep within the maximum size";
+    std::cout<<"."<<std::endl;
+
     return 0;
 }
 
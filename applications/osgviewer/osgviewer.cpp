@@ -48,6 +48,7 @@ int main(int argc, char** argv)
     arguments.getApplicationUsage()->addCommandLineOption("-p <filename>","Play specified camera path animation file, previously saved with 'z' key.");
     arguments.getApplicationUsage()->addCommandLineOption("--speed <factor>","Speed factor for animation playing (1 == normal speed).");
     arguments.getApplicationUsage()->addCommandLineOption("--device <device-name>","add named device to the viewer");
+    arguments.getApplicationUsage()->addCommandLineOption("--read-threads <n>","Number of threads reading the files given, by default OSG_NUM_READ_FILE_THREADS or the number of processors.");
 
     osgViewer::Viewer viewer(arguments);
 
@@ -147,8 +148,11 @@ int main(int argc, char** argv)
     // add the screen capture handler
     viewer.addEventHandler(new osgViewer::ScreenCaptureHandler);
 
-    // load the data
-    osg::ref_ptr<osg::Node> loadedModel = osgDB::readRefNodeFiles(arguments);
+    unsigned int numReadThreads = 0;
+    while(arguments.read("--read-threads", numReadThreads)) {}
+
+    // load the data, reading the files concurrently
+    osg::ref_ptr<osg::Node> loadedModel = osgDB::readRefNodeFiles(arguments, osgDB::Registry::instance()->getOptions(), numReadThreads);
     if (!loadedModel)
     {
         std::cout << arguments.getApplicationName() <<": No data loaded" << std::endl;
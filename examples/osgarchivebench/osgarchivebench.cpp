@@ -0,0 +1,224 @@
+/* OpenSceneGraph example, osgarchivebench.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osg/Geode>
+#include <osg/Geometry>
+
+#include <osgDB/Archive>
+#include <osgDB/ReadFile>
+#include <osgDB/FileUtils>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+
+// Measures how reads of tiles from a single .osga archive scale with the number of threads, with the archive
+// memory mapped and with reads serialized on the archive's file stream.
+
+osg::Node* createTile(unsigned int index, unsigned int side)
+{
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::Vec2Array* texcoords = new osg::Vec2Array;
+    for(unsigned int y=0; y<side; ++y)
+    {
+        for(unsigned int x=0; x<side; ++x)
+        {
+            vertices->push_back(osg::Vec3(float(x), float(y), float((x*y+index) % 17)));
+            texcoords->push_back(osg::Vec2(float(x)/float(side), float(y)/float(side)));
+        }
+    }
+
+    osg::DrawElementsUInt* triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int y=0; y+1<side; ++y)
+    {
+        for(unsigned int x=0; x+1<side; ++x)
+        {
+            unsigned int i = y*side+x;
+            triangles->push_back(i); triangles->push_back(i+1); triangles->push_back(i+side);
+            triangles->push_back(i+1); triangles->push_back(i+side+1); triangles->push_back(i+side);
+        }
+    }
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices);
+    geometry->setTexCoordArray(0, texcoords);
+    geometry->addPrimitiveSet(triangles);
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(geometry);
+    return geode;
+}
+
+std::string tileName(unsigned int index)
+{
+    std::ostringstream name;
+    name<<"tile_"<<index<<".osgb";
+    return name.str();
+}
+
+class ReadThread : public OpenThreads::Thread
+{
+public:
+    ReadThread(osgDB::Archive* archive, unsigned int numTiles, unsigned int numReads, unsigned int seed):
+        _archive(archive),
+        _numTiles(numTiles),
+        _numReads(numReads),
+        _seed(seed),
+        _numSucceeded(0) {}
+
+    virtual void run()
+    {
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+        unsigned int random = _seed;
+        for(unsigned int i=0; i<_numReads; ++i)
+        {
+            random = random*1664525u + 1013904223u;
+            osgDB::ReaderWriter::ReadResult result = _archive->readNode(tileName((random>>8) % _numTiles), options.get());
+            if (result.validNode()) ++_numSucceeded;
+        }
+    }
+
+    osgDB::Archive* _archive;
+    unsigned int    _numTiles;
+    unsigned int    _numReads;
+    unsigned int    _seed;
+    unsigned int    _numSucceeded;
+};
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" measures the throughput of reading tiles from one .osga archive from several threads at once.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--archive <file>", "Archive to create and read, default osgarchivebench.osga.");
+    arguments.getApplicationUsage()->addCommandLineOption("--tiles <n>", "Number of tiles written to the archive, default 256.");
+    arguments.getApplicationUsage()->addCommandLineOption("--tile-size <n>", "Vertices along each side of a tile, default 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <list>", "Comma separated numbers of threads, default 1,2,4,8.");
+    arguments.getApplicationUsage()->addCommandLineOption("--reads <n>", "Tiles read per thread, default 2000.");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    std::string archiveName = "osgarchivebench.osga";
+    std::string threadList = "1,2,4,8";
+    unsigned int numTiles = 256;
+    unsigned int tileSize = 64;
+    unsigned int numReads = 2000;
+    arguments.read("--archive", archiveName);
+    arguments.read("--tiles", numTiles);
+    arguments.read("--tile-size", tileSize);
+    arguments.read("--threads", threadList);
+    arguments.read("--reads", numReads);
+    numTiles = osg::maximum(numTiles, 1u);
+    tileSize = osg::maximum(tileSize, 2u);
+
+    osg::Timer* timer = osg::Timer::instance();
+
+    {
+        osg::Timer_t start = timer->tick();
+        // keep the archives out of the Registry's archive cache so that each one is opened afresh
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+        osg::ref_ptr<osgDB::Archive> archive = osgDB::openArchive(archiveName, osgDB::Archive::CREATE, 4096, options.get());
+        if (!archive)
+        {
+            std::cout<<"Error: could not create "<<archiveName<<std::endl;
+            return 1;
+        }
+
+        for(unsigned int i=0; i<numTiles; ++i)
+        {
+            osg::ref_ptr<osg::Node> tile = createTile(i, tileSize);
+            if (!archive->writeNode(*tile, tileName(i)).success())
+            {
+                std::cout<<"Error: could not write "<<tileName(i)<<" to "<<archiveName<<std::endl;
+                return 1;
+            }
+        }
+        archive->close();
+
+        std::cout<<"Wrote "<<numTiles<<" tiles to "<<archiveName<<" in "<<timer->delta_s(start, timer->tick())<<"s"<<std::endl;
+    }
+
+    std::vector<unsigned int> threadCounts;
+    std::istringstream threadStream(threadList);
+    for(std::string count; std::getline(threadStream, count, ','); )
+    {
+        threadCounts.push_back(static_cast<unsigned int>(atoi(count.c_str())));
+    }
+
+    std::cout<<"mode\tthreads\ttiles/s\tper thread/s"<<std::endl;
+    for(unsigned int mode=0; mode<2; ++mode)
+    {
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options(mode==0 ? "NoMemoryMapping" : "");
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+        osg::ref_ptr<osgDB::Archive> archive = osgDB::openArchive(archiveName, osgDB::Archive::READ, 4096, options.get());
+        if (!archive)
+        {
+            std::cout<<"Error: could not open "<<archiveName<<std::endl;
+            return 1;
+        }
+
+        for(std::vector<unsigned int>::iterator itr = threadCounts.begin(); itr != threadCounts.end(); ++itr)
+        {
+            unsigned int numThreads = osg::maximum(*itr, 1u);
+
+            std::vector<ReadThread*> threads;
+            for(unsigned int t=0; t<numThreads; ++t)
+            {
+                threads.push_back(new ReadThread(archive.get(), numTiles, numReads, t+1));
+            }
+
+            osg::Timer_t start = timer->tick();
+            for(unsigned int t=0; t<numThreads; ++t) threads[t]->start();
+
+            unsigned int numSucceeded = 0;
+            for(unsigned int t=0; t<numThreads; ++t)
+            {
+                threads[t]->join();
+                numSucceeded += threads[t]->_numSucceeded;
+                delete threads[t];
+            }
+            double seconds = timer->delta_s(start, timer->tick());
+
+            if (numSucceeded!=numThreads*numReads)
+            {
+                std::cout<<"Warning: only "<<numSucceeded<<" of "<<numThreads*numReads<<" reads succeeded."<<std::endl;
+            }
+
+            double rate = seconds>0.0 ? double(numThreads*numReads)/seconds : 0.0;
+            std::cout<<(mode==0 ? "stream" : "mapped")<<"\t"<<numThreads<<"\t"<<rate<<"\t"<<rate/numThreads<<std::endl;
+        }
+    }
+
+    return 0;
+}
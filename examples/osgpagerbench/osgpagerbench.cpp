@@ -0,0 +1,372 @@
+/* OpenSceneGraph example, osgpagerbench.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osg/Notify>
+#include <osg/Group>
+
+#include <osgDB/DatabasePager>
+#include <osgDB/FileNameUtils>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+
+// Stress test of the DatabasePager request queue. A "cull" side keeps a fixed number of requests outstanding,
+// re-requesting most of them every frame with a new timestamp and priority the way PagedLODs do during a fly-through,
+// while reader threads take the most important ones. Reported are the takes and requests per second for every depth.
+class QueueBenchPager : public osgDB::DatabasePager
+{
+public:
+
+    struct Result
+    {
+        Result(): depth(0), taken(0), requested(0), takeSeconds(0.0), requestSeconds(0.0) {}
+
+        unsigned int depth;
+        unsigned int taken;
+        unsigned int requested;
+        // time spent in takeFirst, and in add and updatePriority on the cull side
+        double       takeSeconds;
+        double       requestSeconds;
+    };
+
+    Result runQueueStress(unsigned int depth, unsigned int frames, unsigned int takesPerFrame, unsigned int numReaders, double rerequestRatio)
+    {
+        std::vector< osg::ref_ptr<DatabaseRequest> > outstanding;
+
+        _fileRequestQueue->clear();
+        _frameNumber.exchange(0);
+
+        unsigned int seed = 1;
+        double timestamp = 0.0;
+
+        for(unsigned int i=0; i<depth; ++i)
+        {
+            outstanding.push_back(createRequest(0, timestamp, random(seed)));
+            _fileRequestQueue->add(outstanding.back().get());
+        }
+
+        Result result;
+        result.depth = depth;
+
+        ReaderThread* readers[16];
+        numReaders = osg::minimum(numReaders, 16u);
+
+        osg::Timer* timer = osg::Timer::instance();
+        osg::Timer_t start = timer->tick();
+
+        for(unsigned int r=0; r<numReaders; ++r)
+        {
+            readers[r] = new ReaderThread(this, takesPerFrame * frames / numReaders);
+            readers[r]->start();
+        }
+
+        for(unsigned int frame=1; frame<=frames; ++frame)
+        {
+            _frameNumber.exchange(frame);
+            timestamp += 1.0/60.0;
+
+            osg::Timer_t cullStart = timer->tick();
+
+            // cull: re-request a share of the tiles still wanted, replace the ones taken or dropped
+            for(unsigned int i=0; i<outstanding.size(); ++i)
+            {
+                DatabaseRequest* dr = outstanding[i].get();
+                bool queued = outstanding[i]->referenceCount()>1;
+
+                if (!queued || random(seed)>rerequestRatio)
+                {
+                    // no longer visible, left to be pruned by the queue
+                    if (queued && random(seed)>0.5f) continue;
+
+                    outstanding[i] = createRequest(frame, timestamp, random(seed));
+                    _fileRequestQueue->add(outstanding[i].get());
+                }
+                else
+                {
+                    {
+                        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+                        dr->_frameNumberLastRequest = frame;
+                        dr->_timestampLastRequest = timestamp;
+                        dr->_priorityLastRequest = random(seed);
+                    }
+                    _fileRequestQueue->updatePriority(dr);
+                }
+                ++result.requested;
+            }
+
+            osg::Timer_t cullEnd = timer->tick();
+            result.requestSeconds += timer->delta_s(cullStart, cullEnd);
+
+            if (numReaders==0)
+            {
+                for(unsigned int t=0; t<takesPerFrame; ++t)
+                {
+                    osg::ref_ptr<DatabaseRequest> databaseRequest;
+                    _fileRequestQueue->takeFirst(databaseRequest);
+                    if (databaseRequest.valid()) ++result.taken;
+                }
+                result.takeSeconds += timer->delta_s(cullEnd, timer->tick());
+            }
+        }
+
+        for(unsigned int r=0; r<numReaders; ++r)
+        {
+            readers[r]->join();
+            result.taken += readers[r]->_taken;
+            delete readers[r];
+        }
+
+        // readers run alongside the cull side, their rate is over the whole run
+        if (numReaders>0) result.takeSeconds = timer->delta_s(start, timer->tick());
+
+        _fileRequestQueue->clear();
+        return result;
+    }
+
+protected:
+
+    class ReaderThread : public OpenThreads::Thread
+    {
+    public:
+        ReaderThread(QueueBenchPager* pager, unsigned int takes): _pager(pager), _takes(takes), _taken(0) {}
+
+        virtual void run()
+        {
+            for(unsigned int t=0; t<_takes; ++t)
+            {
+                osg::ref_ptr<DatabaseRequest> databaseRequest;
+                _pager->_fileRequestQueue->takeFirst(databaseRequest);
+                if (databaseRequest.valid()) ++_taken;
+                else OpenThreads::Thread::YieldCurrentThread();
+            }
+        }
+
+        QueueBenchPager*    _pager;
+        unsigned int        _takes;
+        unsigned int        _taken;
+    };
+
+    static float random(unsigned int& seed)
+    {
+        seed = seed * 1103515245u + 12345u;
+        return float((seed >> 8) & 0xffff) / 65535.0f;
+    }
+
+    DatabaseRequest* createRequest(unsigned int frameNumber, double timestamp, float priority)
+    {
+        DatabaseRequest* databaseRequest = new DatabaseRequest;
+        databaseRequest->_valid = true;
+        databaseRequest->_fileName = "tile.osgb";
+        databaseRequest->_frameNumberFirstRequest = frameNumber;
+        databaseRequest->_timestampFirstRequest = timestamp;
+        databaseRequest->_priorityFirstRequest = priority;
+        databaseRequest->_frameNumberLastRequest = frameNumber;
+        databaseRequest->_timestampLastRequest = timestamp;
+        databaseRequest->_priorityLastRequest = priority;
+        return databaseRequest;
+    }
+};
+
+// Reads of the mixed paging run sleep for the latency of the source the file name points at,
+// so the pager sees local tiles, tiles inside an archive and tiles behind a slow server.
+class SimulatedLatencyReadFileCallback : public osgDB::Registry::ReadFileCallback
+{
+public:
+    SimulatedLatencyReadFileCallback(double localLatency, double archiveLatency, double networkLatency):
+        _localLatency(localLatency),
+        _archiveLatency(archiveLatency),
+        _networkLatency(networkLatency) {}
+
+    virtual osgDB::ReaderWriter::ReadResult readNode(const std::string& filename, const osgDB::Options*)
+    {
+        double latency = _localLatency;
+        if (osgDB::containsServerAddress(filename)) latency = _networkLatency;
+        else if (filename.find(".osga/")!=std::string::npos) latency = _archiveLatency;
+
+        OpenThreads::Thread::microSleep(static_cast<unsigned int>(latency*1000000.0));
+        return new osg::Group;
+    }
+
+protected:
+    double _localLatency;
+    double _archiveLatency;
+    double _networkLatency;
+};
+
+// Page numTiles tiles spread evenly over the three sources through requestNodeFile the way PagedLODs do,
+// re-requesting the ones not loaded yet every frame, and return the tiles merged per second.
+// The pool is held at numThreads threads, so both modes read with the same number of threads.
+double runMixedPaging(bool useThreadPool, unsigned int numThreads, unsigned int numTiles, double& seconds)
+{
+    osg::ref_ptr<osgDB::DatabasePager> pager = new osgDB::DatabasePager;
+    pager->setUseThreadPool(useThreadPool);
+    if (useThreadPool) pager->setThreadPoolSize(numThreads, numThreads);
+    pager->setUpThreads(numThreads, useThreadPool ? 0 : 1);
+    pager->setTargetMaximumNumberOfPageLOD(numTiles*2);
+
+    // every tile is merged into a group of its own, which tells whether it is loaded
+    std::vector< osg::ref_ptr<osg::Group> > groups(numTiles);
+    std::vector<osg::NodePath> nodePaths(numTiles);
+    std::vector<std::string> fileNames;
+    std::vector< osg::ref_ptr<osg::Referenced> > requests(numTiles);
+    for(unsigned int i=0; i<numTiles; ++i)
+    {
+        groups[i] = new osg::Group;
+        nodePaths[i].push_back(groups[i].get());
+
+        std::ostringstream fileName;
+        switch(i%3)
+        {
+            case(0): fileName<<"tiles/tile_"<<i<<".osgb"; break;
+            case(1): fileName<<"terrain.osga/tile_"<<i<<".osgb"; break;
+            default: fileName<<"http://tileserver/tile_"<<i<<".osgb"; break;
+        }
+        fileNames.push_back(fileName.str());
+    }
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    osg::Timer* timer = osg::Timer::instance();
+    osg::Timer_t start = timer->tick();
+
+    unsigned int numLoaded = 0;
+    for(unsigned int frame=1; numLoaded<numTiles; ++frame)
+    {
+        frameStamp->setFrameNumber(frame);
+        frameStamp->setReferenceTime(timer->delta_s(start, timer->tick()));
+
+        pager->signalBeginFrame(frameStamp.get());
+
+        numLoaded = 0;
+        for(unsigned int i=0; i<numTiles; ++i)
+        {
+            if (groups[i]->getNumChildren()>0)
+            {
+                ++numLoaded;
+                continue;
+            }
+
+            pager->requestNodeFile(fileNames[i], nodePaths[i], float(i%7), frameStamp.get(), requests[i], 0);
+        }
+
+        pager->updateSceneGraph(*frameStamp);
+        pager->signalEndFrame();
+
+        OpenThreads::Thread::microSleep(1000);
+    }
+
+    seconds = timer->delta_s(start, timer->tick());
+    pager->cancel();
+
+    return seconds>0.0 ? double(numTiles)/seconds : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" measures the throughput of the DatabasePager request queue against the number of outstanding requests.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--depths <list>", "Comma separated numbers of outstanding requests, default 100,1000,10000,100000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <n>", "Frames simulated for every depth, default 100.");
+    arguments.getApplicationUsage()->addCommandLineOption("--takes <n>", "Requests taken per frame, default 32.");
+    arguments.getApplicationUsage()->addCommandLineOption("--readers <n>", "Reader threads taking requests concurrently with the cull side, 0 takes on the main thread, default 0.");
+    arguments.getApplicationUsage()->addCommandLineOption("--rerequest <ratio>", "Share of outstanding requests repeated every frame, default 0.9.");
+    arguments.getApplicationUsage()->addCommandLineOption("--mixed <tiles>", "Instead of the queue stress page tiles from simulated local, archive and network sources, with and without the thread pool.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <n>", "Database threads of the mixed paging run, the same number with and without the pool, at least and default 2.");
+    arguments.getApplicationUsage()->addCommandLineOption("--latencies <local,archive,network>", "Simulated read latencies of the mixed paging run in milliseconds, default 2,5,50.");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    std::string depthList = "100,1000,10000,100000";
+    unsigned int frames = 100;
+    unsigned int takes = 32;
+    unsigned int readers = 0;
+    double rerequest = 0.9;
+    arguments.read("--depths", depthList);
+    arguments.read("--frames", frames);
+    arguments.read("--takes", takes);
+    arguments.read("--readers", readers);
+    arguments.read("--rerequest", rerequest);
+
+    unsigned int mixedTiles = 0;
+    if (arguments.read("--mixed", mixedTiles))
+    {
+        unsigned int numThreads = 2;
+        std::string latencyList = "2,5,50";
+        arguments.read("--threads", numThreads);
+        arguments.read("--latencies", latencyList);
+
+        double latencies[3] = { 0.002, 0.005, 0.05 };
+        std::istringstream latencyStream(latencyList);
+        std::string latency;
+        for(unsigned int i=0; i<3 && std::getline(latencyStream, latency, ','); ++i)
+        {
+            latencies[i] = atof(latency.c_str())/1000.0;
+        }
+
+        osgDB::Registry::instance()->setReadFileCallback(new SimulatedLatencyReadFileCallback(latencies[0], latencies[1], latencies[2]));
+
+        // the fixed threads are split into local and http ones, which takes at least two
+        numThreads = osg::maximum(numThreads, 2u);
+
+        std::cout<<"mode\tthreads\ttiles\tseconds\ttiles/s"<<std::endl;
+        for(unsigned int pooled=0; pooled<2; ++pooled)
+        {
+            double seconds = 0.0;
+            double rate = runMixedPaging(pooled!=0, numThreads, mixedTiles, seconds);
+            std::cout<<(pooled ? "pool" : "fixed")<<"\t"<<numThreads<<"\t"<<mixedTiles<<"\t"<<seconds<<"\t"<<rate<<std::endl;
+        }
+
+        osgDB::Registry::instance()->setReadFileCallback(0);
+        return 0;
+    }
+
+    std::vector<unsigned int> depths;
+    std::istringstream depthStream(depthList);
+    for(std::string depth; std::getline(depthStream, depth, ','); )
+    {
+        depths.push_back(static_cast<unsigned int>(atoi(depth.c_str())));
+    }
+
+    osg::ref_ptr<QueueBenchPager> pager = new QueueBenchPager;
+
+    std::cout<<"depth\ttakes/s\trequests/s"<<std::endl;
+    for(std::vector<unsigned int>::iterator itr = depths.begin(); itr != depths.end(); ++itr)
+    {
+        QueueBenchPager::Result result = pager->runQueueStress(*itr, frames, takes, readers, rerequest);
+
+        std::cout<<result.depth<<"\t"
+                 <<(result.takeSeconds>0.0 ? double(result.taken)/result.takeSeconds : 0.0)<<"\t"
+                 <<(result.requestSeconds>0.0 ? double(result.requested)/result.requestSeconds : 0.0)<<std::endl;
+    }
+
+    return 0;
+}
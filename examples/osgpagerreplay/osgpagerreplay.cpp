@@ -0,0 +1,519 @@
+/* OpenSceneGraph example, osgpagerreplay.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/AnimationPath>
+#include <osg/Camera>
+#include <osg/Timer>
+#include <osg/Notify>
+#include <osg/PagedLOD>
+#include <osg/Geode>
+#include <osg/ShapeDrawable>
+
+#include <osgDB/DatabasePager>
+#include <osgDB/ReadFile>
+#include <osgDB/FileNameUtils>
+#include <osgDB/Registry>
+
+#include <osgUtil/CullVisitor>
+#include <osgUtil/RenderStage>
+#include <osgUtil/StateGraph>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <cfloat>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <unistd.h>
+    #include <sys/resource.h>
+#endif
+
+// Replays a camera path against a paged database without a window or graphics context. Every frame the pager
+// merges and expires tiles, a CullVisitor culls the scene for the camera on the path, which is what issues the
+// requests, and the state of the pager is recorded. The frames can be written as CSV or JSON for comparing runs.
+
+// Pager that times the two halves of updateSceneGraph() and counts the requests of the cull traversal.
+class ReplayPager : public osgDB::DatabasePager
+{
+public:
+
+    ReplayPager():
+        _numRequests(0),
+        _updateTime(0.0),
+        _expiryTime(0.0) {}
+
+    virtual void requestNodeFile(const std::string& fileName, osg::NodePath& nodePath,
+                                 float priority, const osg::FrameStamp* framestamp,
+                                 osg::ref_ptr<osg::Referenced>& databaseRequest,
+                                 const osg::Referenced* options)
+    {
+        ++_numRequests;
+        osgDB::DatabasePager::requestNodeFile(fileName, nodePath, priority, framestamp, databaseRequest, options);
+    }
+
+    virtual void updateSceneGraph(const osg::FrameStamp& frameStamp)
+    {
+        _expiryTime = 0.0;
+
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        osgDB::DatabasePager::updateSceneGraph(frameStamp);
+        _updateTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    }
+
+    unsigned int takeNumRequests() { unsigned int num = _numRequests; _numRequests = 0; return num; }
+
+    double getExpiryTime() const { return _expiryTime; }
+
+    // the rest of updateSceneGraph() is spent in addLoadedDataToSceneGraph()
+    double getMergeTime() const { return osg::maximum(0.0, _updateTime-_expiryTime); }
+
+    unsigned int getNumTilesMerged() const { return _numTilesMerges; }
+
+    unsigned int getNumActivePagedLODs() const { return _activePagedLODList->size(); }
+
+protected:
+
+    virtual void removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        osgDB::DatabasePager::removeExpiredSubgraphs(frameStamp);
+        _expiryTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    }
+
+    unsigned int    _numRequests;
+    double          _updateTime;
+    double          _expiryTime;
+};
+
+struct FrameRecord
+{
+    unsigned int    frameNumber;
+    double          time;
+    double          cullTime;
+    double          mergeTime;
+    double          expiryTime;
+    unsigned int    numRequests;
+    unsigned int    fileRequestQueue;
+    unsigned int    compileQueue;
+    unsigned int    mergeQueue;
+    unsigned int    numMerged;
+    // seconds from the first request of the tiles merged in the frame to their merge
+    double          minimumLatency;
+    double          averageLatency;
+    double          maximumLatency;
+    unsigned int    numActivePagedLODs;
+    double          memoryMB;
+};
+
+// Resident memory of the process, the peak where the current size isn't available.
+static double getMemoryUsageMB()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0.0;
+    return double(counters.WorkingSetSize)/(1024.0*1024.0);
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    unsigned long size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0.0;
+    return double(resident)*double(sysconf(_SC_PAGESIZE))/(1024.0*1024.0);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)!=0) return 0.0;
+    #if defined(__APPLE__)
+        return double(usage.ru_maxrss)/(1024.0*1024.0);
+    #else
+        return double(usage.ru_maxrss)/1024.0;
+    #endif
+#endif
+}
+
+// Tiles of the synthetic database take the given time to read, so the run needs no data on disk.
+class SyntheticTileReadFileCallback : public osgDB::Registry::ReadFileCallback
+{
+public:
+    SyntheticTileReadFileCallback(double latency): _latency(latency) {}
+
+    virtual osgDB::ReaderWriter::ReadResult readNode(const std::string& filename, const osgDB::Options* options)
+    {
+        if (osgDB::getLowerCaseFileExtension(filename)!="tile")
+        {
+            return osgDB::Registry::ReadFileCallback::readNode(filename, options);
+        }
+
+        OpenThreads::Thread::microSleep(static_cast<unsigned int>(_latency*1000000.0));
+
+        osg::Geode* geode = new osg::Geode;
+        geode->addDrawable(new osg::ShapeDrawable(new osg::Box(osg::Vec3(0.0f,0.0f,0.0f), 50.0f)));
+        return geode;
+    }
+
+protected:
+    double _latency;
+};
+
+// A size by size grid of PagedLOD tiles 100 units apart, each paged in within 400 units.
+osg::Node* createSyntheticDatabase(unsigned int size)
+{
+    osg::Group* group = new osg::Group;
+    for(unsigned int i=0; i<size; ++i)
+    {
+        for(unsigned int j=0; j<size; ++j)
+        {
+            std::ostringstream fileName;
+            fileName<<"tile_"<<i<<"_"<<j<<".tile";
+
+            osg::PagedLOD* plod = new osg::PagedLOD;
+            plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+            plod->setCenter(osg::Vec3(float(i)*100.0f, float(j)*100.0f, 0.0f));
+            plod->setRadius(75.0f);
+            plod->setFileName(0, fileName.str());
+            plod->setRange(0, 0.0f, 400.0f);
+            group->addChild(plod);
+        }
+    }
+    return group;
+}
+
+// Fly across the scene through its centre, a little above it and looking ahead and down.
+osg::AnimationPath* createDefaultPath(const osg::BoundingSphere& bs, double duration)
+{
+    osg::AnimationPath* path = new osg::AnimationPath;
+    path->setLoopMode(osg::AnimationPath::NO_LOOPING);
+
+    osg::Quat rotation = osg::Quat(osg::DegreesToRadians(75.0), osg::Vec3d(1.0,0.0,0.0)) *
+                         osg::Quat(osg::DegreesToRadians(-90.0), osg::Vec3d(0.0,0.0,1.0));
+
+    osg::Vec3d height(0.0, 0.0, bs.radius()*0.05);
+    osg::Vec3d across(bs.radius(), 0.0, 0.0);
+
+    path->insert(0.0, osg::AnimationPath::ControlPoint(osg::Vec3d(bs.center())-across+height, rotation));
+    path->insert(duration, osg::AnimationPath::ControlPoint(osg::Vec3d(bs.center())+across+height, rotation));
+    return path;
+}
+
+void writeCSV(std::ostream& out, const std::vector<FrameRecord>& records)
+{
+    out<<"frame,time,cull_ms,merge_ms,expiry_ms,requests,file_request_queue,compile_queue,merge_queue,merged,"
+       <<"min_latency_ms,average_latency_ms,max_latency_ms,active_pagedlods,memory_mb"<<std::endl;
+
+    for(std::vector<FrameRecord>::const_iterator itr = records.begin(); itr != records.end(); ++itr)
+    {
+        out<<itr->frameNumber<<","<<itr->time<<","
+           <<itr->cullTime*1000.0<<","<<itr->mergeTime*1000.0<<","<<itr->expiryTime*1000.0<<","
+           <<itr->numRequests<<","<<itr->fileRequestQueue<<","<<itr->compileQueue<<","<<itr->mergeQueue<<","
+           <<itr->numMerged<<","<<itr->minimumLatency*1000.0<<","<<itr->averageLatency*1000.0<<","<<itr->maximumLatency*1000.0<<","
+           <<itr->numActivePagedLODs<<","<<itr->memoryMB<<std::endl;
+    }
+}
+
+void writeJSON(std::ostream& out, const std::vector<FrameRecord>& records)
+{
+    out<<"{"<<std::endl<<"  \"frames\": ["<<std::endl;
+
+    for(std::vector<FrameRecord>::const_iterator itr = records.begin(); itr != records.end(); ++itr)
+    {
+        out<<"    {\"frame\": "<<itr->frameNumber<<", \"time\": "<<itr->time
+           <<", \"cull_ms\": "<<itr->cullTime*1000.0<<", \"merge_ms\": "<<itr->mergeTime*1000.0<<", \"expiry_ms\": "<<itr->expiryTime*1000.0
+           <<", \"requests\": "<<itr->numRequests<<", \"file_request_queue\": "<<itr->fileRequestQueue
+           <<", \"compile_queue\": "<<itr->compileQueue<<", \"merge_queue\": "<<itr->mergeQueue<<", \"merged\": "<<itr->numMerged
+           <<", \"min_latency_ms\": "<<itr->minimumLatency*1000.0<<", \"average_latency_ms\": "<<itr->averageLatency*1000.0
+           <<", \"max_latency_ms\": "<<itr->maximumLatency*1000.0<<", \"active_pagedlods\": "<<itr->numActivePagedLODs
+           <<", \"memory_mb\": "<<itr->memoryMB<<"}"<<((itr+1)!=records.end() ? "," : "")<<std::endl;
+    }
+
+    out<<"  ]"<<std::endl<<"}"<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" replays a camera path against a paged database through the DatabasePager without a window, recording the paging of every frame.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename]");
+    arguments.getApplicationUsage()->addCommandLineOption("-p <filename>", "Camera path to replay, as recorded by osgviewer. By default the camera flies across the scene.");
+    arguments.getApplicationUsage()->addCommandLineOption("--synthetic <n>", "Instead of a file page an n by n grid of tiles that are read with a simulated latency.");
+    arguments.getApplicationUsage()->addCommandLineOption("--latency <ms>", "Read latency of the synthetic tiles, default 20.");
+    arguments.getApplicationUsage()->addCommandLineOption("--duration <seconds>", "Duration of the default camera path, default 20.");
+    arguments.getApplicationUsage()->addCommandLineOption("--fps <n>", "Frames per second of path time, default 60.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <n>", "Stop after n frames.");
+    arguments.getApplicationUsage()->addCommandLineOption("--unpaced", "Run the frames back to back rather than at the pace of the path.");
+    arguments.getApplicationUsage()->addCommandLineOption("--window <x y w h>", "Viewport the camera projects onto, default 0 0 1280 720.");
+    arguments.getApplicationUsage()->addCommandLineOption("--fov <degrees>", "Vertical field of view, default 30.");
+    arguments.getApplicationUsage()->addCommandLineOption("--lod-scale <scale>", "LOD scale of the camera, default 1.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <n>", "Number of database threads, default from osg::DisplaySettings.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-pagedlod <n>", "Target maximum number of PagedLOD kept loaded.");
+    arguments.getApplicationUsage()->addCommandLineOption("--prefetch", "Prefetch the tiles the camera is predicted to need.");
+    arguments.getApplicationUsage()->addCommandLineOption("--csv <filename>", "Write the frames as CSV, - for the console.");
+    arguments.getApplicationUsage()->addCommandLineOption("--json <filename>", "Write the frames as JSON, - for the console.");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    std::string pathFile;
+    unsigned int syntheticSize = 0;
+    double latency = 20.0;
+    double duration = 20.0;
+    double fps = 60.0;
+    unsigned int maxFrames = 0;
+    int x = 0, y = 0, width = 1280, height = 720;
+    double fov = 30.0;
+    float lodScale = 1.0f;
+    unsigned int numThreads = 0;
+    int maxPagedLOD = -1;
+    std::string csvFile, jsonFile;
+
+    arguments.read("-p", pathFile);
+    arguments.read("--synthetic", syntheticSize);
+    arguments.read("--latency", latency);
+    arguments.read("--duration", duration);
+    arguments.read("--fps", fps);
+    arguments.read("--frames", maxFrames);
+    bool paced = !arguments.read("--unpaced");
+    arguments.read("--window", x, y, width, height);
+    arguments.read("--fov", fov);
+    arguments.read("--lod-scale", lodScale);
+    arguments.read("--threads", numThreads);
+    arguments.read("--max-pagedlod", maxPagedLOD);
+    bool prefetch = arguments.read("--prefetch");
+    arguments.read("--csv", csvFile);
+    arguments.read("--json", jsonFile);
+
+    if (fps<=0.0)
+    {
+        std::cout<<"Error: --fps must be greater than 0."<<std::endl;
+        return 1;
+    }
+
+    osg::ref_ptr<osg::Node> scene;
+    if (syntheticSize>0)
+    {
+        osgDB::Registry::instance()->setReadFileCallback(new SyntheticTileReadFileCallback(latency/1000.0));
+        scene = createSyntheticDatabase(syntheticSize);
+    }
+    else
+    {
+        scene = osgDB::readRefNodeFiles(arguments);
+    }
+
+    if (!scene)
+    {
+        std::cout<<arguments.getApplicationName()<<": No data loaded, give a paged database or --synthetic <n>."<<std::endl;
+        return 1;
+    }
+
+    osg::ref_ptr<osg::AnimationPath> path;
+    if (!pathFile.empty())
+    {
+        std::ifstream in(pathFile.c_str());
+        if (!in)
+        {
+            std::cout<<"Error: could not open camera path "<<pathFile<<std::endl;
+            return 1;
+        }
+
+        path = new osg::AnimationPath;
+        path->read(in);
+        if (path->empty())
+        {
+            std::cout<<"Error: no control points in camera path "<<pathFile<<std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        path = createDefaultPath(scene->getBound(), duration);
+    }
+
+    osg::ref_ptr<ReplayPager> pager = new ReplayPager;
+    if (numThreads>0) pager->setUpThreads(numThreads, 1);
+    if (maxPagedLOD>=0) pager->setTargetMaximumNumberOfPageLOD(maxPagedLOD);
+    pager->setDoPrefetch(prefetch);
+    pager->registerPagedLODs(scene.get());
+
+    osg::ref_ptr<osg::Camera> camera = new osg::Camera;
+    camera->setViewport(x, y, width, height);
+    camera->setProjectionMatrixAsPerspective(fov, double(width)/double(height), 1.0, osg::maximum(10000.0, double(scene->getBound().radius())*4.0));
+    camera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+    camera->setLODScale(lodScale);
+
+    // cull into a render stage of our own, nothing is drawn from it
+    osg::ref_ptr<osgUtil::CullVisitor> cullVisitor = new osgUtil::CullVisitor;
+    osg::ref_ptr<osgUtil::StateGraph> stateGraph = new osgUtil::StateGraph;
+    osg::ref_ptr<osgUtil::RenderStage> renderStage = new osgUtil::RenderStage;
+    cullVisitor->setStateGraph(stateGraph.get());
+    cullVisitor->setRenderStage(renderStage.get());
+    cullVisitor->setDatabaseRequestHandler(pager.get());
+    cullVisitor->inheritCullSettings(*camera);
+
+    double firstTime = path->getFirstTime();
+    double lastTime = path->getLastTime();
+    unsigned int numFrames = static_cast<unsigned int>((lastTime-firstTime)*fps)+1;
+    if (maxFrames>0) numFrames = osg::minimum(numFrames, maxFrames);
+
+    std::vector<FrameRecord> records;
+    records.reserve(numFrames);
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    osg::Timer* timer = osg::Timer::instance();
+    osg::Timer_t start = timer->tick();
+
+    pager->resetStats();
+
+    for(unsigned int frame=0; frame<numFrames; ++frame)
+    {
+        double time = double(frame)/fps;
+
+        frameStamp->setFrameNumber(frame);
+        frameStamp->setReferenceTime(time);
+        frameStamp->setSimulationTime(time);
+
+        osg::Matrixd cameraMatrix;
+        path->getMatrix(firstTime+time, cameraMatrix);
+        camera->setViewMatrix(osg::Matrixd::inverse(cameraMatrix));
+
+        pager->signalBeginFrame(frameStamp.get());
+
+        pager->updateSceneGraph(*frameStamp);
+        if (pager->getDoPrefetch()) pager->prefetch(scene.get(), *camera, *frameStamp);
+
+        FrameRecord record;
+        record.frameNumber = frame;
+        record.time = time;
+        record.mergeTime = pager->getMergeTime();
+        record.expiryTime = pager->getExpiryTime();
+        record.numMerged = pager->getNumTilesMerged();
+        record.minimumLatency = record.numMerged>0 ? pager->getMinimumTimeToMergeTile() : 0.0;
+        record.averageLatency = pager->getAverageTimeToMergeTiles();
+        record.maximumLatency = record.numMerged>0 ? pager->getMaximumTimeToMergeTile() : 0.0;
+        pager->resetStats();
+
+        osg::Timer_t cullStart = timer->tick();
+
+        cullVisitor->reset();
+        cullVisitor->setFrameStamp(frameStamp.get());
+        cullVisitor->setTraversalNumber(frame);
+        cullVisitor->pushViewport(camera->getViewport());
+        cullVisitor->pushProjectionMatrix(new osg::RefMatrix(camera->getProjectionMatrix()));
+        cullVisitor->pushModelViewMatrix(new osg::RefMatrix(camera->getViewMatrix()), osg::Transform::ABSOLUTE_RF);
+        scene->accept(*cullVisitor);
+        cullVisitor->popModelViewMatrix();
+        cullVisitor->popProjectionMatrix();
+        cullVisitor->popViewport();
+
+        renderStage->reset();
+        stateGraph->clean();
+
+        record.cullTime = timer->delta_s(cullStart, timer->tick());
+        record.numRequests = pager->takeNumRequests();
+
+        pager->signalEndFrame();
+
+        record.fileRequestQueue = pager->getFileRequestListSize();
+        record.compileQueue = pager->getDataToCompileListSize();
+        record.mergeQueue = pager->getDataToMergeListSize();
+        record.numActivePagedLODs = pager->getNumActivePagedLODs();
+        record.memoryMB = getMemoryUsageMB();
+        records.push_back(record);
+
+        if (paced)
+        {
+            double remaining = double(frame+1)/fps - timer->delta_s(start, timer->tick());
+            if (remaining>0.0) OpenThreads::Thread::microSleep(static_cast<unsigned int>(remaining*1000000.0));
+        }
+    }
+
+    double seconds = timer->delta_s(start, timer->tick());
+
+    pager->cancel();
+
+    if (!csvFile.empty())
+    {
+        if (csvFile=="-") writeCSV(std::cout, records);
+        else
+        {
+            std::ofstream out(csvFile.c_str());
+            writeCSV(out, records);
+        }
+    }
+
+    if (!jsonFile.empty())
+    {
+        if (jsonFile=="-") writeJSON(std::cout, records);
+        else
+        {
+            std::ofstream out(jsonFile.c_str());
+            writeJSON(out, records);
+        }
+    }
+
+    // summary of the run
+    unsigned int totalMerged = 0, totalRequests = 0, maxFileRequestQueue = 0;
+    double totalLatency = 0.0, maxLatency = 0.0, totalMergeTime = 0.0, maxMergeTime = 0.0;
+    double totalExpiryTime = 0.0, maxExpiryTime = 0.0, maxMemory = 0.0;
+    for(std::vector<FrameRecord>::const_iterator itr = records.begin(); itr != records.end(); ++itr)
+    {
+        totalMerged += itr->numMerged;
+        totalRequests += itr->numRequests;
+        totalLatency += itr->averageLatency*double(itr->numMerged);
+        maxLatency = osg::maximum(maxLatency, itr->maximumLatency);
+        maxFileRequestQueue = osg::maximum(maxFileRequestQueue, itr->fileRequestQueue);
+        totalMergeTime += itr->mergeTime;
+        maxMergeTime = osg::maximum(maxMergeTime, itr->mergeTime);
+        totalExpiryTime += itr->expiryTime;
+        maxExpiryTime = osg::maximum(maxExpiryTime, itr->expiryTime);
+        maxMemory = osg::maximum(maxMemory, itr->memoryMB);
+    }
+
+    double numRecords = records.empty() ? 1.0 : double(records.size());
+
+    std::ostream& summary = (csvFile=="-" || jsonFile=="-") ? std::cerr : std::cout;
+    summary<<"frames\t"<<records.size()<<std::endl;
+    summary<<"seconds\t"<<seconds<<std::endl;
+    summary<<"requests\t"<<totalRequests<<std::endl;
+    summary<<"tiles merged\t"<<totalMerged<<std::endl;
+    summary<<"latency ms (average, max)\t"<<(totalMerged>0 ? totalLatency/double(totalMerged)*1000.0 : 0.0)<<"\t"<<maxLatency*1000.0<<std::endl;
+    summary<<"max file request queue\t"<<maxFileRequestQueue<<std::endl;
+    summary<<"merge ms (average, max)\t"<<totalMergeTime/numRecords*1000.0<<"\t"<<maxMergeTime*1000.0<<std::endl;
+    summary<<"expiry ms (average, max)\t"<<totalExpiryTime/numRecords*1000.0<<"\t"<<maxExpiryTime*1000.0<<std::endl;
+    summary<<"max memory MB\t"<<maxMemory<<std::endl;
+
+    if (pager->getDoPrefetch())
+    {
+        osgDB::DatabasePager::PrefetchStatistics prefetchStatistics = pager->getPrefetchStatistics();
+        summary<<"prefetch (requested, hits, misses, hit rate)\t"<<prefetchStatistics.numRequested<<"\t"<<prefetchStatistics.numHits
+               <<"\t"<<prefetchStatistics.numMisses<<"\t"<<prefetchStatistics.getHitRate()<<std::endl;
+    }
+
+    osgDB::Registry::instance()->setReadFileCallback(0);
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+/* OpenSceneGraph example, osgregistrybench.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osg/Group>
+
+#include <osgDB/Registry>
+#include <osgDB/ReadFile>
+#include <osgDB/FileNameUtils>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+
+// Measures how well plugin lookups in the osgDB::Registry scale with the number of threads. Registered are a number of
+// ReaderWriters standing in for loaded plugins, each with a few extensions of its own, and one that builds an empty
+// group for ".rbench" files without touching the disk, so the reads time the Registry rather than the file system.
+class StandInReaderWriter : public osgDB::ReaderWriter
+{
+public:
+    StandInReaderWriter(unsigned int index)
+    {
+        for(unsigned int i=0; i<3; ++i)
+        {
+            std::ostringstream ext;
+            ext<<"fmt"<<index<<"_"<<i;
+            supportsExtension(ext.str(), "stand in format");
+        }
+    }
+
+    virtual const char* className() const { return "Stand in ReaderWriter"; }
+
+    virtual ReadResult readNode(const std::string& fileName, const osgDB::Options*) const
+    {
+        if (!acceptsExtension(osgDB::getLowerCaseFileExtension(fileName))) return ReadResult::FILE_NOT_HANDLED;
+        return ReadResult::FILE_NOT_FOUND;
+    }
+};
+
+class BenchReaderWriter : public osgDB::ReaderWriter
+{
+public:
+    BenchReaderWriter() { supportsExtension("rbench", "osgregistrybench in memory format"); }
+
+    virtual const char* className() const { return "osgregistrybench ReaderWriter"; }
+
+    virtual ReadResult readNode(const std::string& fileName, const osgDB::Options*) const
+    {
+        if (!acceptsExtension(osgDB::getLowerCaseFileExtension(fileName))) return ReadResult::FILE_NOT_HANDLED;
+        return new osg::Group;
+    }
+};
+
+class LookupThread : public OpenThreads::Thread
+{
+public:
+    LookupThread(bool readFiles, unsigned int numOperations, unsigned int numReaderWriters):
+        _readFiles(readFiles),
+        _numOperations(numOperations),
+        _numReaderWriters(numReaderWriters),
+        _numSucceeded(0) {}
+
+    virtual void run()
+    {
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+        for(unsigned int i=0; i<_numOperations; ++i)
+        {
+            if (_readFiles)
+            {
+                std::ostringstream fileName;
+                fileName<<"tile_"<<i<<".rbench";
+                if (osgDB::readRefNodeFile(fileName.str(), options.get()).valid()) ++_numSucceeded;
+            }
+            else
+            {
+                std::ostringstream ext;
+                ext<<"fmt"<<(i % _numReaderWriters)<<"_"<<(i % 3);
+                if (osgDB::Registry::instance()->getReaderWriterForExtension(ext.str())) ++_numSucceeded;
+            }
+        }
+    }
+
+    bool            _readFiles;
+    unsigned int    _numOperations;
+    unsigned int    _numReaderWriters;
+    unsigned int    _numSucceeded;
+};
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" measures the throughput of osgDB::Registry plugin lookups and reads from several threads at once.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <list>", "Comma separated numbers of threads, default 1,2,4,8,16.");
+    arguments.getApplicationUsage()->addCommandLineOption("--operations <n>", "Lookups or reads per thread, default 20000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--plugins <n>", "Stand in ReaderWriters registered ahead of the one read from, default 60.");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    std::string threadList = "1,2,4,8,16";
+    unsigned int numOperations = 20000;
+    unsigned int numReaderWriters = 60;
+    arguments.read("--threads", threadList);
+    arguments.read("--operations", numOperations);
+    arguments.read("--plugins", numReaderWriters);
+    numReaderWriters = osg::maximum(numReaderWriters, 1u);
+
+    std::vector< osg::ref_ptr<osgDB::ReaderWriter> > readerWriters;
+    for(unsigned int i=0; i<numReaderWriters; ++i)
+    {
+        readerWriters.push_back(new StandInReaderWriter(i));
+        osgDB::Registry::instance()->addReaderWriter(readerWriters.back().get());
+    }
+    readerWriters.push_back(new BenchReaderWriter);
+    osgDB::Registry::instance()->addReaderWriter(readerWriters.back().get());
+
+    std::vector<unsigned int> threadCounts;
+    std::istringstream threadStream(threadList);
+    for(std::string count; std::getline(threadStream, count, ','); )
+    {
+        threadCounts.push_back(static_cast<unsigned int>(atoi(count.c_str())));
+    }
+
+    osg::Timer* timer = osg::Timer::instance();
+
+    std::cout<<"mode\tthreads\toperations/s\tper thread/s"<<std::endl;
+    for(unsigned int mode=0; mode<2; ++mode)
+    {
+        for(std::vector<unsigned int>::iterator itr = threadCounts.begin(); itr != threadCounts.end(); ++itr)
+        {
+            unsigned int numThreads = osg::maximum(*itr, 1u);
+
+            std::vector<LookupThread*> threads;
+            for(unsigned int t=0; t<numThreads; ++t)
+            {
+                threads.push_back(new LookupThread(mode==1, numOperations, numReaderWriters));
+            }
+
+            osg::Timer_t start = timer->tick();
+            for(unsigned int t=0; t<numThreads; ++t) threads[t]->start();
+
+            unsigned int numSucceeded = 0;
+            for(unsigned int t=0; t<numThreads; ++t)
+            {
+                threads[t]->join();
+                numSucceeded += threads[t]->_numSucceeded;
+                delete threads[t];
+            }
+            double seconds = timer->delta_s(start, timer->tick());
+
+            if (numSucceeded!=numThreads*numOperations)
+            {
+                std::cout<<"Warning: only "<<numSucceeded<<" of "<<numThreads*numOperations<<" operations succeeded."<<std::endl;
+            }
+
+            double rate = seconds>0.0 ? double(numThreads*numOperations)/seconds : 0.0;
+            std::cout<<(mode==1 ? "read" : "lookup")<<"\t"<<numThreads<<"\t"<<rate<<"\t"<<rate/numThreads<<std::endl;
+        }
+    }
+
+    for(std::vector< osg::ref_ptr<osgDB::ReaderWriter> >::iterator itr = readerWriters.begin(); itr != readerWriters.end(); ++itr)
+    {
+        osgDB::Registry::instance()->removeReaderWriter(itr->get());
+    }
+
+    return 0;
+}
@@ -385,13 +385,13 @@ void ImageSequence::update(osg::NodeVisitor* nv)
              else
              {
                 OSG_NOTICE<<"Requesting file, entry="<<i<<" : _fileNames[i]="<<_imageDataList[i]._filename<<std::endl;
-                irh->requestImageFile(_imageDataList[i]._filename, this, i, time, fs, _imageDataList[i]._imageRequest, _readOptions.get());
+                irh->requestImageFile(_imageDataList[i]._filename, this, i, fs->getSimulationTime(), fs, _imageDataList[i]._imageRequest, _readOptions.get());
              }
         }
     }
     else
     {
-        double preLoadTime = time + osg::minimum(irh->getPreLoadTime()*_timeMultiplier, _length);
+        double preLoadTime = time + osg::minimum(osg::maximum(irh->getPreLoadTime()*_timeMultiplier, double(irh->getPreLoadFrames())*_timePerImage), _length);
 
         int startLoadIndex = int(time/_timePerImage);
         if (startLoadIndex>=int(_imageDataList.size())) startLoadIndex = int(_imageDataList.size())-1;
@@ -402,7 +402,9 @@ void ImageSequence::update(osg::NodeVisitor* nv)
         if (endLoadIndex>=int(_imageDataList.size())) endLoadIndex = int(_imageDataList.size())-1;
         if (endLoadIndex<0) endLoadIndex = 0;
 
-        double requestTime = time;
+        // images are requested by the simulation time they'll be shown at, so that requests from different sequences can be ordered
+        double simulationTimePerImage = _timeMultiplier>0.0 ? _timePerImage/_timeMultiplier : 0.0;
+        double requestTime = fs->getSimulationTime();
 
         if (endLoadIndex<startLoadIndex)
         {
@@ -412,7 +414,7 @@ void ImageSequence::update(osg::NodeVisitor* nv)
                 {
                     irh->requestImageFile(_imageDataList[i]._filename, this, i, requestTime, fs, _imageDataList[i]._imageRequest, _readOptions.get());
                 }
-                requestTime += _timePerImage;
+                requestTime += simulationTimePerImage;
             }
 
             for(int i=0; i<=endLoadIndex; ++i)
@@ -421,7 +423,7 @@ void ImageSequence::update(osg::NodeVisitor* nv)
                 {
                     irh->requestImageFile(_imageDataList[i]._filename, this, i, requestTime, fs, _imageDataList[i]._imageRequest, _readOptions.get());
                 }
-                requestTime += _timePerImage;
+                requestTime += simulationTimePerImage;
             }
         }
         else
@@ -432,7 +434,7 @@ void ImageSequence::update(osg::NodeVisitor* nv)
                 {
                     irh->requestImageFile(_imageDataList[i]._filename, this, i, requestTime, fs, _imageDataList[i]._imageRequest, _readOptions.get());
                 }
-                requestTime += _timePerImage;
+                requestTime += simulationTimePerImage;
             }
         }
 
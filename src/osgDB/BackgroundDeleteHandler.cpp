@@ -0,0 +1,322 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/BackgroundDeleteHandler>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+using namespace osgDB;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  DeleteThread
+//
+class BackgroundDeleteHandler::DeleteThread : public OpenThreads::Thread
+{
+public:
+
+    DeleteThread(BackgroundDeleteHandler* handler):
+        _done(false),
+        _handler(handler) {}
+
+    void setDone(bool done) { _done = done; }
+    bool getDone() const { return _done; }
+
+    virtual void run()
+    {
+        OSG_INFO<<"BackgroundDeleteHandler::DeleteThread::run()"<<std::endl;
+
+        while(!_done)
+        {
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_handler->_mutex);
+                while(!_done && !_handler->hasObjectsReadyToDeleteNoLock())
+                {
+                    // flush() signals each frame, the timeout covers applications that never call it
+                    _handler->_condition.wait(&(_handler->_mutex), 100);
+                }
+            }
+
+            if (_done) break;
+
+            if (_handler->deleteSlice() && _handler->_minimumTimeBetweenSlices>0.0)
+            {
+                // leave the cores to the frame and the database threads for a while before the next slice
+                OpenThreads::Thread::microSleep(static_cast<unsigned int>(_handler->_minimumTimeBetweenSlices*1000000.0));
+            }
+        }
+    }
+
+protected:
+
+    volatile bool               _done;
+    BackgroundDeleteHandler*    _handler;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  BackgroundDeleteHandler
+//
+BackgroundDeleteHandler::BackgroundDeleteHandler(int numberOfFramesToRetainObjects):
+    osg::DeleteHandler(numberOfFramesToRetainObjects),
+    _maximumTimePerSlice(0.002),
+    _minimumTimeBetweenSlices(0.001),
+    _numRequested(0),
+    _shutdown(false),
+    _thread(0),
+    _totalLatency(0.0),
+    _totalSliceTime(0.0)
+{
+}
+
+BackgroundDeleteHandler::~BackgroundDeleteHandler()
+{
+    stopThread();
+
+    if (!_pendingDeletes.empty() || !_releasedDeletes.empty())
+    {
+        OSG_INFO<<"BackgroundDeleteHandler::~BackgroundDeleteHandler() "<<_pendingDeletes.size()+_releasedDeletes.size()<<" objects left undeleted."<<std::endl;
+    }
+}
+
+void BackgroundDeleteHandler::shutdown()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _shutdown = true;
+    }
+
+    stopThread();
+
+    flushAll();
+}
+
+void BackgroundDeleteHandler::startThread()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> threadLock(_threadMutex);
+    if (_thread || _shutdown) return;
+
+    _thread = new DeleteThread(this);
+    _thread->setSchedulePriority(OpenThreads::Thread::THREAD_PRIORITY_LOW);
+    _thread->startThread();
+}
+
+void BackgroundDeleteHandler::stopThread()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> threadLock(_threadMutex);
+    if (!_thread) return;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _thread->setDone(true);
+        _condition.broadcast();
+    }
+
+    _thread->join();
+
+    delete _thread;
+    _thread = 0;
+}
+
+bool BackgroundDeleteHandler::isDeleteThread() const
+{
+    return _thread && OpenThreads::Thread::CurrentThread()==_thread;
+}
+
+void BackgroundDeleteHandler::requestRelease(const osg::Referenced* object)
+{
+    if (!object) return;
+
+    if (!_thread && !_shutdown) startThread();
+
+    osg::Timer_t tick = osg::Timer::instance()->tick();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // after shutdown() the caller's own reference releases the object
+    if (_shutdown) return;
+
+    object->ref();
+    ++_numRequested;
+    _pendingDeletes.push_back(PendingDelete(_currentFrameNumber, tick, object, true));
+    if (_numFramesToRetainObjects==0) _condition.signal();
+}
+
+void BackgroundDeleteHandler::requestDelete(const osg::Referenced* object)
+{
+    if (isDeleteThread())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        if (!_shutdown)
+        {
+            // released by an object deleted on the deletion thread, so it has already been retained long enough
+            ++_numRequested;
+            _releasedDeletes.push_back(PendingDelete(_currentFrameNumber, osg::Timer::instance()->tick(), object, false));
+            return;
+        }
+    }
+
+    // released elsewhere, such as graphics contexts and windows by the application, so it isn't ours to move to another thread
+    osg::DeleteHandler::requestDelete(object);
+}
+
+void BackgroundDeleteHandler::flush()
+{
+    osg::DeleteHandler::flush();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    if (hasObjectsReadyToDeleteNoLock()) _condition.signal();
+}
+
+void BackgroundDeleteHandler::flushAll()
+{
+    osg::DeleteHandler::flushAll();
+
+    // the deletion thread holds the slice lock while it deletes, and the queue is being emptied by it anyway
+    if (isDeleteThread()) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> sliceLock(_sliceMutex);
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    unsigned int numDeleted = 0;
+    double totalLatency = 0.0;
+    double maximumLatency = 0.0;
+
+    PendingDelete pendingDelete;
+    while(takeNext(pendingDelete, true))
+    {
+        deleteObject(pendingDelete);
+
+        double latency = osg::Timer::instance()->delta_s(pendingDelete.requestTick, osg::Timer::instance()->tick());
+        totalLatency += latency;
+        if (latency>maximumLatency) maximumLatency = latency;
+        ++numDeleted;
+    }
+
+    if (numDeleted>0) recordSlice(numDeleted, totalLatency, maximumLatency, osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick()));
+}
+
+void BackgroundDeleteHandler::deleteObject(const PendingDelete& pendingDelete)
+{
+    if (pendingDelete.release) pendingDelete.object->unref();
+    else doDelete(pendingDelete.object);
+}
+
+bool BackgroundDeleteHandler::takeNext(PendingDelete& pendingDelete, bool includeRetained)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // finish taking apart the subgraphs already started on before moving to the next
+    if (!_releasedDeletes.empty())
+    {
+        pendingDelete = _releasedDeletes.back();
+        _releasedDeletes.pop_back();
+        return true;
+    }
+
+    if (!_pendingDeletes.empty() && (includeRetained || isReadyToDelete(_pendingDeletes.front())))
+    {
+        pendingDelete = _pendingDeletes.front();
+        _pendingDeletes.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+bool BackgroundDeleteHandler::deleteSlice()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> sliceLock(_sliceMutex);
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    osg::Timer_t tick = startTick;
+    unsigned int numDeleted = 0;
+    double totalLatency = 0.0;
+    double maximumLatency = 0.0;
+    bool sliceUsedUp = false;
+
+    PendingDelete pendingDelete;
+    while(takeNext(pendingDelete, false))
+    {
+        deleteObject(pendingDelete);
+
+        tick = osg::Timer::instance()->tick();
+
+        double latency = osg::Timer::instance()->delta_s(pendingDelete.requestTick, tick);
+        totalLatency += latency;
+        if (latency>maximumLatency) maximumLatency = latency;
+        ++numDeleted;
+
+        if (osg::Timer::instance()->delta_s(startTick, tick)>=_maximumTimePerSlice)
+        {
+            sliceUsedUp = true;
+            break;
+        }
+    }
+
+    if (numDeleted>0) recordSlice(numDeleted, totalLatency, maximumLatency, osg::Timer::instance()->delta_s(startTick, tick));
+
+    if (!sliceUsedUp) return false;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return hasObjectsReadyToDeleteNoLock();
+}
+
+void BackgroundDeleteHandler::recordSlice(unsigned int numDeleted, double totalLatency, double maximumLatency, double sliceTime)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+
+    _statistics.numDeleted += numDeleted;
+    ++_statistics.numSlices;
+
+    _totalLatency += totalLatency;
+    if (maximumLatency>_statistics.maximumLatency) _statistics.maximumLatency = maximumLatency;
+
+    _totalSliceTime += sliceTime;
+    if (sliceTime>_statistics.maximumSliceTime) _statistics.maximumSliceTime = sliceTime;
+}
+
+BackgroundDeleteHandler::Statistics BackgroundDeleteHandler::getStatistics() const
+{
+    Statistics statistics;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+        statistics = _statistics;
+        if (statistics.numDeleted>0) statistics.averageLatency = _totalLatency/static_cast<double>(statistics.numDeleted);
+        if (statistics.numSlices>0) statistics.averageSliceTime = _totalSliceTime/static_cast<double>(statistics.numSlices);
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(const_cast<OpenThreads::Mutex&>(_mutex));
+        statistics.numRequested = _numRequested;
+        statistics.numPending = static_cast<unsigned int>(_pendingDeletes.size() + _releasedDeletes.size());
+    }
+
+    return statistics;
+}
+
+void BackgroundDeleteHandler::resetStatistics()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _numRequested = 0;
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+    _statistics = Statistics();
+    _totalLatency = 0.0;
+    _totalSliceTime = 0.0;
+}
@@ -13,10 +13,20 @@
 // Written by Wang Rui, (C) 2010
 
 #include <osg/Notify>
+#include <osg/Math>
 #include <osgDB/Registry>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <osgDB/MemoryMappedFile>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Condition>
 #include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <string.h>
 
 using namespace osgDB;
 
@@ -48,6 +58,682 @@ public:
 
 REGISTER_COMPRESSOR( "null", NullCompressor )
 
+// Compressor base splitting the data into independently compressed blocks, written after a block index so that
+// the blocks can be decompressed in parallel, and in step with reading through createDecompressionStream().
+// Layout: INT block count, then per block INT compressed size and INT size, then the compressed blocks.
+// Blocks hold at most BLOCK_SIZE bytes, a block whose compressed size equals its size is stored uncompressed.
+class BlockCompressor : public BaseCompressor
+{
+public:
+    enum { BLOCK_SIZE = 256*1024 };
+
+    /** Compress a block, appending to dst, return false on failure.*/
+    virtual bool compressBlock( const char* src, unsigned int size, std::string& dst ) const = 0;
+
+    /** Decompress a block into exactly dstSize bytes at dst, return false on corrupt data.*/
+    virtual bool decompressBlock( const char* src, unsigned int size, char* dst, unsigned int dstSize ) const = 0;
+
+    virtual bool compress( std::ostream& fout, const std::string& src );
+    virtual bool decompress( std::istream& fin, std::string& target );
+    virtual std::istream* createDecompressionStream( std::istream& fin );
+};
+
+namespace
+{
+
+class BlockTasks;
+
+// Worker threads shared by all the block compressors and decompression streams of the process, at most one fewer
+// than the processors, so that any number of streams read at once never start more threads than the machine has.
+// Block tasks queue up for help, a free worker picks the oldest and works on it until it has no blocks left.
+class BlockWorkerPool
+{
+public:
+    static BlockWorkerPool& instance()
+    {
+        static BlockWorkerPool s_pool;
+        return s_pool;
+    }
+
+    /** Queue the tasks for help, starting another worker if none is free.*/
+    void add( BlockTasks* tasks );
+
+    /** Take the tasks off the queue and wait for the workers still on them.*/
+    void remove( BlockTasks* tasks );
+
+protected:
+
+    BlockWorkerPool();
+    ~BlockWorkerPool();
+
+    class WorkerThread : public OpenThreads::Thread
+    {
+    public:
+        WorkerThread( BlockWorkerPool* pool ): _pool(pool) {}
+        virtual void run() { _pool->runWorker(); }
+
+        BlockWorkerPool* _pool;
+    };
+
+    void runWorker();
+
+    typedef std::vector<BlockTasks*> TasksList;
+    typedef std::map<BlockTasks*, unsigned int> NumWorkersMap;
+
+    OpenThreads::Mutex          _mutex;
+    OpenThreads::Condition      _queued;
+    OpenThreads::Condition      _released;
+    TasksList                   _queue;
+    NumWorkersMap               _numWorkers;
+    std::vector<WorkerThread*>  _threads;
+    unsigned int                _maxNumThreads;
+    unsigned int                _numIdleThreads;
+    bool                        _done;
+};
+
+// Blocks processed by the shared workers, the thread asking for a block helps out with the outstanding ones
+// rather than just waiting, so everything still works, in order, without any worker at all.
+class BlockTasks
+{
+public:
+    BlockTasks(): _nextBlock(0), _failed(false), _cancelled(false), _queued(false) {}
+
+    virtual ~BlockTasks() { stop(); }
+
+    void start( unsigned int numBlocks )
+    {
+        _done.assign( numBlocks, 0 );
+
+        // the calling thread works on the blocks as well, a single block needs no help
+        if ( numBlocks>1 )
+        {
+            _queued = true;
+            BlockWorkerPool::instance().add( this );
+        }
+    }
+
+    /** Stop handing out blocks and wait for the workers, must be called by subclasses before they are destructed.*/
+    void stop()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            _cancelled = true;
+        }
+        if ( _queued )
+        {
+            BlockWorkerPool::instance().remove( this );
+            _queued = false;
+        }
+    }
+
+    /** Wait for the block, processing outstanding ones meanwhile, return false if any block failed.*/
+    bool waitFor( unsigned int block )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        while ( !_done[block] && !_failed )
+        {
+            if ( _nextBlock<_done.size() && !_cancelled ) processNextBlock();
+            else _completed.wait( &_mutex );
+        }
+        return !_failed;
+    }
+
+    bool waitForAll()
+    {
+        for ( unsigned int i=0; i<_done.size(); ++i )
+        {
+            if ( !waitFor(i) ) return false;
+        }
+        return true;
+    }
+
+    bool isDone( unsigned int block )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        return _done[block]!=0;
+    }
+
+    /** Called by a worker, process blocks until there are none left to hand out.*/
+    void help()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        while ( _nextBlock<_done.size() && !_cancelled && !_failed )
+        {
+            processNextBlock();
+        }
+    }
+
+protected:
+
+    virtual bool processBlock( unsigned int block ) = 0;
+
+    // called with _mutex held, releases it while the block is processed
+    void processNextBlock()
+    {
+        unsigned int block = _nextBlock++;
+        _mutex.unlock();
+        bool result = processBlock( block );
+        _mutex.lock();
+
+        _done[block] = 1;
+        if ( !result ) _failed = true;
+        _completed.broadcast();
+    }
+
+    OpenThreads::Mutex          _mutex;
+    OpenThreads::Condition      _completed;
+    std::vector<unsigned char>  _done;
+    unsigned int                _nextBlock;
+    bool                        _failed;
+    bool                        _cancelled;
+    bool                        _queued;
+};
+
+BlockWorkerPool::BlockWorkerPool():
+    _numIdleThreads(0),
+    _done(false)
+{
+    int numProcessors = OpenThreads::GetNumberOfProcessors();
+    _maxNumThreads = numProcessors>1 ? static_cast<unsigned int>(numProcessors-1) : 0u;
+}
+
+BlockWorkerPool::~BlockWorkerPool()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _done = true;
+        _queued.broadcast();
+    }
+    for ( std::vector<WorkerThread*>::iterator itr=_threads.begin(); itr!=_threads.end(); ++itr )
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+void BlockWorkerPool::add( BlockTasks* tasks )
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    if ( _maxNumThreads==0 ) return;
+
+    _queue.push_back( tasks );
+    if ( _numIdleThreads==0 && _threads.size()<_maxNumThreads )
+    {
+        _threads.push_back( new WorkerThread(this) );
+        _threads.back()->start();
+        ++_numIdleThreads;
+    }
+    _queued.signal();
+}
+
+void BlockWorkerPool::remove( BlockTasks* tasks )
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    TasksList::iterator itr = std::find( _queue.begin(), _queue.end(), tasks );
+    if ( itr!=_queue.end() ) _queue.erase( itr );
+
+    while ( _numWorkers.count(tasks)>0 ) _released.wait( &_mutex );
+}
+
+void BlockWorkerPool::runWorker()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    while ( !_done )
+    {
+        if ( _queue.empty() )
+        {
+            _queued.wait( &_mutex );
+            continue;
+        }
+
+        // stay on the oldest tasks along with any other free workers, they are the ones being waited for first
+        BlockTasks* tasks = _queue.front();
+        ++_numWorkers[tasks];
+        --_numIdleThreads;
+
+        _mutex.unlock();
+        tasks->help();
+        _mutex.lock();
+
+        // nothing left to hand out, later workers needn't bother
+        TasksList::iterator itr = std::find( _queue.begin(), _queue.end(), tasks );
+        if ( itr!=_queue.end() ) _queue.erase( itr );
+
+        ++_numIdleThreads;
+        NumWorkersMap::iterator nitr = _numWorkers.find( tasks );
+        if ( --(nitr->second)==0 )
+        {
+            _numWorkers.erase( nitr );
+            _released.broadcast();
+        }
+    }
+}
+
+class BlockCompressTasks : public BlockTasks
+{
+public:
+    BlockCompressTasks( const BlockCompressor* compressor, const std::string& src ):
+        _compressor(compressor), _src(src)
+    {
+        _results.resize( (src.size()+BlockCompressor::BLOCK_SIZE-1)/BlockCompressor::BLOCK_SIZE );
+    }
+
+    virtual ~BlockCompressTasks() { stop(); }
+
+    unsigned int getNumBlocks() const { return static_cast<unsigned int>(_results.size()); }
+
+    unsigned int getBlockSize( unsigned int block ) const
+    {
+        size_t offset = static_cast<size_t>(block)*BlockCompressor::BLOCK_SIZE;
+        return static_cast<unsigned int>( osg::minimum(_src.size()-offset, static_cast<size_t>(BlockCompressor::BLOCK_SIZE)) );
+    }
+
+    const std::string& getResult( unsigned int block ) const { return _results[block]; }
+
+protected:
+
+    virtual bool processBlock( unsigned int block )
+    {
+        const char* src = _src.data() + static_cast<size_t>(block)*BlockCompressor::BLOCK_SIZE;
+        unsigned int size = getBlockSize( block );
+
+        std::string& result = _results[block];
+        if ( !_compressor->compressBlock(src, size, result) ) return false;
+
+        // store blocks that don't get any smaller
+        if ( result.size()>=size ) result.assign( src, size );
+        return true;
+    }
+
+    const BlockCompressor*      _compressor;
+    const std::string&          _src;
+    std::vector<std::string>    _results;
+};
+
+// Bytes from the current position to the end of a seekable stream, or ~0 when the stream can't tell.
+size_t getRemainingSize( std::istream& fin )
+{
+    std::streampos current = fin.tellg();
+    if ( current==std::streampos(-1) )
+    {
+        fin.clear();
+        return ~size_t(0);
+    }
+
+    fin.seekg( 0, std::ios::end );
+    std::streampos end = fin.tellg();
+    fin.clear();
+    fin.seekg( current );
+    if ( end==std::streampos(-1) || end<current ) return ~size_t(0);
+    return static_cast<size_t>( end-current );
+}
+
+// Stream buffer handing out the decompressed blocks as soon as they, and all blocks before them, are ready.
+class BlockDecompressionBuffer : public MemoryStreamBuffer, public BlockTasks
+{
+public:
+    BlockDecompressionBuffer( const BlockCompressor* compressor ):
+        MemoryStreamBuffer(0, 0),
+        _compressor(compressor),
+        _compressed(0),
+        _numReady(0) {}
+
+    virtual ~BlockDecompressionBuffer() { stop(); }
+
+    bool init( std::istream& fin )
+    {
+        int numBlocks = 0;
+        fin.read( (char*)&numBlocks, INT_SIZE );
+        if ( fin.fail() || numBlocks<0 ) return false;
+
+        // the header is not trusted: the index and the compressed blocks have to fit in what's left of the stream,
+        // so corrupt counts fail here rather than with huge allocations
+        MemoryStreamBuffer* memory = dynamic_cast<MemoryStreamBuffer*>( fin.rdbuf() );
+        size_t remaining = memory ? memory->remaining() : getRemainingSize( fin );
+        size_t indexSize = static_cast<size_t>(numBlocks)*2*INT_SIZE;
+        if ( indexSize/(2*INT_SIZE)!=static_cast<size_t>(numBlocks) || indexSize>remaining ) return false;
+        remaining -= indexSize;
+
+        // read one entry at a time, so a truncated stream of unknown length fails before allocating its block count
+        size_t numReserved = remaining==~size_t(0) ? osg::minimum(static_cast<size_t>(numBlocks), size_t(4096)) : static_cast<size_t>(numBlocks);
+        _compressedOffsets.reserve( numReserved+1 );
+        _compressedOffsets.push_back( 0 );
+        _offsets.reserve( numReserved+1 );
+        _offsets.push_back( 0 );
+        for ( int i=0; i<numBlocks; ++i )
+        {
+            int sizes[2] = { 0, 0 };
+            fin.read( (char*)sizes, 2*INT_SIZE );
+            if ( fin.fail() || sizes[0]<0 || sizes[1]<0 || sizes[0]>sizes[1] || sizes[1]>BlockCompressor::BLOCK_SIZE ) return false;
+            if ( sizes[0]==0 && sizes[1]>0 ) return false;
+
+            size_t compressedSize = _compressedOffsets.back() + sizes[0];
+            if ( compressedSize>remaining || _offsets.back()>_data.max_size()-sizes[1] ) return false;
+
+            _compressedOffsets.push_back( compressedSize );
+            _offsets.push_back( _offsets.back() + sizes[1] );
+        }
+
+        // decompress straight from a memory mapped file, otherwise read all the compressed data
+        size_t compressedSize = _compressedOffsets.back();
+        if ( memory )
+        {
+            _compressed = memory->current();
+            memory->advance( compressedSize );
+        }
+        else
+        {
+            // in pieces, a stream of unknown length may end well before the index says
+            for ( size_t offset=0; offset<compressedSize; )
+            {
+                size_t size = osg::minimum( compressedSize-offset, static_cast<size_t>(BlockCompressor::BLOCK_SIZE)*16 );
+                _compressedData.resize( offset+size );
+                fin.read( &_compressedData[offset], size );
+                if ( fin.fail() ) return false;
+                offset += size;
+            }
+            _compressed = _compressedData.data();
+        }
+
+        _data.resize( _offsets.back() );
+        _begin = _data.empty() ? 0 : &_data[0];
+        _end = _begin + _data.size();
+        setg( _begin, _begin, _begin );
+
+        start( static_cast<unsigned int>(numBlocks) );
+        return true;
+    }
+
+    bool readAll( std::string& target )
+    {
+        if ( !waitForAll() ) return false;
+        target = _data;
+        return true;
+    }
+
+protected:
+
+    virtual bool processBlock( unsigned int block )
+    {
+        const char* src = _compressed + _compressedOffsets[block];
+        unsigned int size = static_cast<unsigned int>( _compressedOffsets[block+1]-_compressedOffsets[block] );
+        char* dst = _begin + _offsets[block];
+        unsigned int dstSize = static_cast<unsigned int>( _offsets[block+1]-_offsets[block] );
+
+        if ( size==dstSize )
+        {
+            if ( size>0 ) memcpy( dst, src, size );
+            return true;
+        }
+        return _compressor->decompressBlock( src, size, dst, dstSize );
+    }
+
+    // make everything up to and including block readable, along with any blocks after it that are ready too
+    bool makeReady( unsigned int block )
+    {
+        if ( block<_numReady ) return true;
+        if ( !waitFor(block) ) return false;
+
+        _numReady = block+1;
+        while ( _numReady+1<_offsets.size() && isDone(_numReady) ) ++_numReady;
+
+        setg( _begin, gptr(), _begin+_offsets[_numReady] );
+        return true;
+    }
+
+    // block holding the byte at position, or the number of blocks at the end
+    unsigned int findBlock( size_t position ) const
+    {
+        std::vector<size_t>::const_iterator itr = std::upper_bound( _offsets.begin(), _offsets.end(), position );
+        return static_cast<unsigned int>( itr-_offsets.begin() ) - 1;
+    }
+
+    virtual int_type underflow()
+    {
+        if ( gptr()<egptr() ) return traits_type::to_int_type(*gptr());
+        if ( _numReady+1>=_offsets.size() || !makeReady(_numReady) ) return traits_type::eof();
+        return gptr()<egptr() ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+    }
+
+    virtual std::streamsize xsgetn( char* s, std::streamsize n )
+    {
+        std::streamsize numRead = 0;
+        while ( numRead<n )
+        {
+            if ( gptr()==egptr() && underflow()==traits_type::eof() ) break;
+
+            size_t size = osg::minimum( static_cast<size_t>(n-numRead), remaining() );
+            read( s+numRead, size );
+            numRead += size;
+        }
+        return numRead;
+    }
+
+    virtual std::streamsize showmanyc()
+    {
+        return remaining()>0 ? static_cast<std::streamsize>(remaining()) : (gptr()<_end ? 0 : -1);
+    }
+
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir way, std::ios_base::openmode which )
+    {
+        if ( (which & std::ios_base::in)==0 ) return pos_type(off_type(-1));
+
+        // tellg()
+        if ( off==0 && way==std::ios_base::cur ) return pos_type( off_type(gptr()-_begin) );
+
+        char* base = way==std::ios_base::beg ? _begin : (way==std::ios_base::end ? _end : gptr());
+        if ( off < _begin-base || off > _end-base ) return pos_type(off_type(-1));
+
+        size_t position = static_cast<size_t>( base+off-_begin );
+        unsigned int numBlocks = static_cast<unsigned int>( _offsets.size()-1 );
+        if ( numBlocks>0 && !makeReady(osg::minimum(findBlock(position), numBlocks-1)) ) return pos_type(off_type(-1));
+
+        setg( _begin, _begin+position, egptr() );
+        return pos_type( off_type(position) );
+    }
+
+    virtual pos_type seekpos( pos_type pos, std::ios_base::openmode which )
+    {
+        return seekoff( off_type(pos), std::ios_base::beg, which );
+    }
+
+    const BlockCompressor*  _compressor;
+    const char*             _compressed;
+    std::string             _compressedData;
+    std::vector<size_t>     _compressedOffsets;
+    std::vector<size_t>     _offsets;
+    std::string             _data;
+    unsigned int            _numReady;
+};
+
+class BlockDecompressionStream : public std::istream
+{
+public:
+    BlockDecompressionStream( const BlockCompressor* compressor, std::istream& fin ):
+        std::istream(0),
+        _buffer(compressor)
+    {
+        if ( _buffer.init(fin) ) rdbuf( &_buffer );
+        else setstate( std::ios::failbit );
+    }
+
+protected:
+    BlockDecompressionBuffer _buffer;
+};
+
+}
+
+bool BlockCompressor::compress( std::ostream& fout, const std::string& src )
+{
+    BlockCompressTasks tasks( this, src );
+    tasks.start( tasks.getNumBlocks() );
+    if ( !tasks.waitForAll() ) return false;
+
+    int numBlocks = static_cast<int>( tasks.getNumBlocks() );
+    fout.write( (char*)&numBlocks, INT_SIZE );
+    for ( unsigned int i=0; i<tasks.getNumBlocks(); ++i )
+    {
+        int sizes[2] = { static_cast<int>(tasks.getResult(i).size()), static_cast<int>(tasks.getBlockSize(i)) };
+        fout.write( (char*)sizes, 2*INT_SIZE );
+    }
+    for ( unsigned int i=0; i<tasks.getNumBlocks(); ++i )
+    {
+        const std::string& result = tasks.getResult(i);
+        fout.write( result.data(), result.size() );
+    }
+    return !fout.fail();
+}
+
+bool BlockCompressor::decompress( std::istream& fin, std::string& target )
+{
+    BlockDecompressionBuffer buffer( this );
+    return buffer.init( fin ) && buffer.readAll( target );
+}
+
+std::istream* BlockCompressor::createDecompressionStream( std::istream& fin )
+{
+    return new BlockDecompressionStream( this, fin );
+}
+
+// Fast LZ77 compressor, byte oriented in the style of LZ4: each sequence is a token holding the literal and match
+// lengths, the literals, then a 16 bit offset back to the match. Decompression is bounds checked throughout.
+class LZCompressor : public BlockCompressor
+{
+public:
+    LZCompressor() {}
+
+    enum
+    {
+        MIN_MATCH = 4,
+        MAX_OFFSET = 65535,
+        HASH_BITS = 14,
+        // the last bytes of a block are always literals so matching never reads past the end
+        END_LITERALS = 12
+    };
+
+    virtual bool compressBlock( const char* data, unsigned int size, std::string& dst ) const
+    {
+        const unsigned char* src = reinterpret_cast<const unsigned char*>(data);
+        std::vector<int> table( 1<<HASH_BITS, -1 );
+        dst.reserve( size + size/255 + 16 );
+
+        unsigned int anchor = 0, pos = 0;
+        unsigned int limit = size>END_LITERALS ? size-END_LITERALS : 0;
+        while ( pos<limit )
+        {
+            unsigned int sequence = read32( src+pos );
+            int& entry = table[hash(sequence)];
+            int candidate = entry;
+            entry = static_cast<int>(pos);
+
+            if ( candidate<0 || pos-candidate>MAX_OFFSET || read32(src+candidate)!=sequence )
+            {
+                // skip faster through data that doesn't compress
+                pos += 1 + ((pos-anchor)>>6);
+                continue;
+            }
+
+            unsigned int matchEnd = pos+MIN_MATCH, matchLimit = size-5;
+            while ( matchEnd<matchLimit && src[matchEnd]==src[candidate+matchEnd-pos] ) ++matchEnd;
+
+            writeSequence( dst, src+anchor, pos-anchor, pos-candidate, matchEnd-pos-MIN_MATCH );
+            pos = anchor = matchEnd;
+        }
+
+        // final sequence is literals only
+        unsigned int numLiterals = size-anchor;
+        dst.push_back( static_cast<char>(osg::minimum(numLiterals, 15u)<<4) );
+        if ( numLiterals>=15 ) writeLength( dst, numLiterals-15 );
+        dst.append( reinterpret_cast<const char*>(src+anchor), numLiterals );
+        return true;
+    }
+
+    virtual bool decompressBlock( const char* data, unsigned int size, char* dst, unsigned int dstSize ) const
+    {
+        const unsigned char* ip = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* ipEnd = ip+size;
+        char* op = dst;
+        char* opEnd = dst+dstSize;
+
+        while ( ip<ipEnd )
+        {
+            unsigned int token = *ip++;
+
+            size_t numLiterals = token>>4;
+            if ( numLiterals==15 && !readLength(ip, ipEnd, numLiterals) ) return false;
+            if ( numLiterals>static_cast<size_t>(ipEnd-ip) || numLiterals>static_cast<size_t>(opEnd-op) ) return false;
+            memcpy( op, ip, numLiterals );
+            op += numLiterals; ip += numLiterals;
+
+            if ( ip==ipEnd ) break;
+
+            if ( ipEnd-ip<2 ) return false;
+            size_t offset = ip[0] | (ip[1]<<8);
+            ip += 2;
+            if ( offset==0 || offset>static_cast<size_t>(op-dst) ) return false;
+
+            size_t length = token & 15;
+            if ( length==15 && !readLength(ip, ipEnd, length) ) return false;
+            length += MIN_MATCH;
+            if ( length>static_cast<size_t>(opEnd-op) ) return false;
+
+            // overlapping matches repeat the bytes between match and op, copy as much of them as is there each time
+            const char* match = op-offset;
+            while ( length>0 )
+            {
+                size_t step = osg::minimum( length, static_cast<size_t>(op-match) );
+                memcpy( op, match, step );
+                op += step; length -= step;
+            }
+        }
+        return op==opEnd;
+    }
+
+protected:
+
+    static inline unsigned int read32( const unsigned char* p )
+    {
+        unsigned int value; memcpy( &value, p, 4 );
+        return value;
+    }
+
+    static inline unsigned int hash( unsigned int sequence )
+    {
+        return (sequence*2654435761u) >> (32-HASH_BITS);
+    }
+
+    static void writeLength( std::string& dst, unsigned int length )
+    {
+        for ( ; length>=255; length-=255 ) dst.push_back( static_cast<char>(255) );
+        dst.push_back( static_cast<char>(length) );
+    }
+
+    static bool readLength( const unsigned char*& ip, const unsigned char* ipEnd, size_t& length )
+    {
+        unsigned char c = 255;
+        while ( c==255 )
+        {
+            if ( ip>=ipEnd ) return false;
+            c = *ip++;
+            length += c;
+        }
+        return true;
+    }
+
+    static void writeSequence( std::string& dst, const unsigned char* literals, unsigned int numLiterals,
+                               unsigned int offset, unsigned int matchLength )
+    {
+        dst.push_back( static_cast<char>((osg::minimum(numLiterals, 15u)<<4) | osg::minimum(matchLength, 15u)) );
+        if ( numLiterals>=15 ) writeLength( dst, numLiterals-15 );
+        dst.append( reinterpret_cast<const char*>(literals), numLiterals );
+        dst.push_back( static_cast<char>(offset & 0xff) );
+        dst.push_back( static_cast<char>(offset>>8) );
+        if ( matchLength>=15 ) writeLength( dst, matchLength-15 );
+    }
+};
+
+REGISTER_COMPRESSOR( "lz", LZCompressor )
+
 #ifdef USE_ZLIB
 
 #include <zlib.h>
@@ -173,4 +859,28 @@ public:
 
 REGISTER_COMPRESSOR( "zlib", ZLibCompressor )
 
+// ZLib compressor working on independent blocks, which can be decompressed in parallel
+class ZLibBlockCompressor : public BlockCompressor
+{
+public:
+    ZLibBlockCompressor() {}
+
+    virtual bool compressBlock( const char* src, unsigned int size, std::string& dst ) const
+    {
+        uLongf compressedSize = compressBound( size );
+        dst.resize( compressedSize );
+        if ( compress2((Bytef*)&dst[0], &compressedSize, (const Bytef*)src, size, 6)!=Z_OK ) return false;
+        dst.resize( compressedSize );
+        return true;
+    }
+
+    virtual bool decompressBlock( const char* src, unsigned int size, char* dst, unsigned int dstSize ) const
+    {
+        uLongf decompressedSize = dstSize;
+        return uncompress( (Bytef*)dst, &decompressedSize, (const Bytef*)src, size )==Z_OK && decompressedSize==dstSize;
+    }
+};
+
+REGISTER_COMPRESSOR( "zlib_blocks", ZLibBlockCompressor )
+
 #endif
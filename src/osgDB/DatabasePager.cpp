@@ -16,6 +16,7 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
+#include <osgDB/BackgroundDeleteHandler>
 
 #include <osg/Geode>
 #include <osg/Timer>
@@ -23,6 +24,9 @@
 #include <osg/Notify>
 #include <osg/ProxyNode>
 #include <osg/ApplicationUsage>
+#include <osg/Transform>
+#include <osg/Polytope>
+#include <osg/CullingSet>
 
 #include <OpenThreads/ScopedLock>
 
@@ -48,6 +52,10 @@ static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRO
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_THREAD_POOL <ON/OFF>","Switch on or off, default off, the shared pool of database threads reading local files, archives and network requests within per source limits.");
+static osg::ApplicationUsageProxy DatabasePager_e14(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PREFETCH <ON/OFF>","Switch on or off the prefetching of the tiles the camera is predicted to need from its motion.");
+static osg::ApplicationUsageProxy DatabasePager_e15(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PREFETCH_TIME <seconds>","Set how far ahead the camera motion is extrapolated when prefetching.");
+static osg::ApplicationUsageProxy DatabasePager_e16(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BACKGROUND_DELETION <ON/OFF>","Switch on or off, default off, releasing the expired paged subgraphs on a low priority background thread.");
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -344,6 +352,213 @@ protected:
 };
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  PrefetchVisitor
+//
+//  Culls the scene against a predicted view and requests the PagedLOD and ProxyNode children it would need,
+//  selecting the PagedLOD children by range as PagedLOD::traverse() does for the CullVisitor.
+//
+class DatabasePager::PrefetchVisitor : public osg::NodeVisitor
+{
+public:
+    PrefetchVisitor(DatabasePager* pager, const osg::Camera& camera, const osg::FrameStamp& frameStamp):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _pager(pager),
+        _frameStamp(frameStamp),
+        _projectionMatrix(camera.getProjectionMatrix()),
+        _viewport(camera.getViewport()),
+        _lodScale(camera.getLODScale()),
+        // below the requests of the cull traversal, whose priorities lie within -1 to 1 unless offset
+        _priorityOffset(-2.0f)
+    {
+        setTraversalMask(camera.getCullMask());
+    }
+
+    META_NodeVisitor("osgDB","PrefetchVisitor")
+
+    void setViewMatrix(const osg::Matrixd& viewMatrix)
+    {
+        _viewMatrix = viewMatrix;
+
+        _frustum.setToUnitFrustum();
+        _frustum.transformProvidingInverse(_viewMatrix*_projectionMatrix);
+
+        _modelStates.clear();
+        pushModelState(osg::Matrixd::identity());
+    }
+
+    virtual osg::Vec3 getEyePoint() const { return _modelStates.back()._eye; }
+
+    virtual float getDistanceToEyePoint(const osg::Vec3& pos, bool useLODScale) const
+    {
+        return (pos-_modelStates.back()._eye).length()*(useLODScale ? _lodScale : 1.0f);
+    }
+
+    virtual float getDistanceFromEyePoint(const osg::Vec3& pos, bool useLODScale) const
+    {
+        return getDistanceToEyePoint(pos, useLODScale);
+    }
+
+    virtual float getDistanceToViewPoint(const osg::Vec3& pos, bool useLODScale) const
+    {
+        return getDistanceToEyePoint(pos, useLODScale);
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (isCulled(node)) return;
+
+        traverse(node);
+    }
+
+    // the leaves hold no database requests
+    virtual void apply(osg::Geode&) {}
+    virtual void apply(osg::Drawable&) {}
+
+    // nested cameras have views of their own
+    virtual void apply(osg::Camera&) {}
+
+    virtual void apply(osg::Transform& transform)
+    {
+        if (isCulled(transform)) return;
+
+        osg::Matrixd matrix = _modelStates.back()._matrix;
+        transform.computeLocalToWorldMatrix(matrix, this);
+
+        pushModelState(matrix);
+        traverse(transform);
+        _modelStates.pop_back();
+    }
+
+    virtual void apply(osg::PagedLOD& plod)
+    {
+        if (isCulled(plod)) return;
+
+        float requiredRange = 0.0f;
+        if (plod.getRangeMode()==osg::LOD::DISTANCE_FROM_EYE_POINT)
+        {
+            requiredRange = getDistanceToViewPoint(plod.getCenter(), true);
+        }
+        else
+        {
+            // without a viewport the pixel size is unknown, leave the selection to the cull traversal
+            if (!_viewport.valid() || _lodScale<=0.0f) return;
+
+            const osg::BoundingSphere& bs = plod.getBound();
+            requiredRange = fabs(bs.radius()/(bs.center()*_modelStates.back()._pixelSizeVector)) / _lodScale;
+        }
+
+        unsigned int numChildren = plod.getNumChildren();
+        int lastChildTraversed = -1;
+        bool needToLoadChild = false;
+        for(unsigned int i=0; i<plod.getNumRanges(); ++i)
+        {
+            if (plod.getMinRange(i)<=requiredRange && requiredRange<plod.getMaxRange(i))
+            {
+                if (i<numChildren)
+                {
+                    plod.getChild(i)->accept(*this);
+                    lastChildTraversed = (int)i;
+                }
+                else
+                {
+                    needToLoadChild = true;
+                }
+            }
+        }
+
+        if (!needToLoadChild) return;
+
+        // the last valid child is shown until the next is loaded, and may page in children of its own
+        if (numChildren>0 && ((int)numChildren-1)!=lastChildTraversed)
+        {
+            plod.getChild(numChildren-1)->accept(*this);
+        }
+
+        if (plod.getDisableExternalChildrenPaging() || numChildren>=plod.getNumFileNames()) return;
+
+        float priority = (plod.getMaxRange(numChildren)-requiredRange)/(plod.getMaxRange(numChildren)-plod.getMinRange(numChildren));
+        if (plod.getRangeMode()==osg::LOD::PIXEL_SIZE_ON_SCREEN) priority = -priority;
+        priority = plod.getPriorityOffset(numChildren) + priority * plod.getPriorityScale(numChildren) + _priorityOffset;
+
+        _pager->requestPrefetch(&plod, numChildren, plod.getDatabasePath()+plod.getFileName(numChildren), getNodePath(),
+                                priority, _frameStamp, plod.getDatabaseRequest(numChildren), plod.getDatabaseOptions());
+    }
+
+    virtual void apply(osg::ProxyNode& proxyNode)
+    {
+        if (isCulled(proxyNode)) return;
+
+        if (proxyNode.getNumFileNames()>proxyNode.getNumChildren() &&
+            proxyNode.getLoadingExternalReferenceMode()!=osg::ProxyNode::NO_AUTOMATIC_LOADING)
+        {
+            for(unsigned int i=proxyNode.getNumChildren(); i<proxyNode.getNumFileNames(); ++i)
+            {
+                _pager->requestPrefetch(&proxyNode, i, proxyNode.getDatabasePath()+proxyNode.getFileName(i), getNodePath(),
+                                        1.0f+_priorityOffset, _frameStamp, proxyNode.getDatabaseRequest(i), proxyNode.getDatabaseOptions());
+            }
+        }
+        else
+        {
+            traverse(proxyNode);
+        }
+    }
+
+protected:
+
+    struct ModelState
+    {
+        osg::Matrixd    _matrix;
+        double          _scale;
+        osg::Vec3       _eye;
+        osg::Vec4       _pixelSizeVector;
+    };
+
+    void pushModelState(const osg::Matrixd& matrix)
+    {
+        ModelState modelState;
+        modelState._matrix = matrix;
+
+        osg::Vec3d scale = matrix.getScale();
+        modelState._scale = osg::maximum(scale.x(), osg::maximum(scale.y(), scale.z()));
+
+        modelState._eye = osg::Vec3d(0.0,0.0,0.0)*osg::Matrixd::inverse(matrix*_viewMatrix);
+        if (_viewport.valid())
+        {
+            modelState._pixelSizeVector = osg::CullingSet::computePixelSizeVector(*_viewport, _projectionMatrix, matrix*_viewMatrix);
+        }
+
+        _modelStates.push_back(modelState);
+    }
+
+    bool isCulled(const osg::Node& node)
+    {
+        const osg::BoundingSphere& bs = node.getBound();
+        if (!bs.valid()) return false;
+
+        const ModelState& modelState = _modelStates.back();
+        osg::BoundingSphere worldBound(bs.center()*modelState._matrix, bs.radius()*modelState._scale);
+        return !_frustum.contains(worldBound);
+    }
+
+    typedef std::vector<ModelState> ModelStates;
+
+    DatabasePager*                  _pager;
+    const osg::FrameStamp&          _frameStamp;
+    osg::Matrixd                    _projectionMatrix;
+    osg::ref_ptr<const osg::Viewport> _viewport;
+    float                           _lodScale;
+    float                           _priorityOffset;
+
+    osg::Matrixd                    _viewMatrix;
+    osg::Polytope                   _frustum;
+    ModelStates                     _modelStates;
+
+    PrefetchVisitor& operator = (const PrefetchVisitor&) { return *this; }
+};
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  SortFileRequestFunctor
@@ -371,6 +586,8 @@ void DatabasePager::DatabaseRequest::invalidate()
     _loadedModel = 0;
     _compileSet = 0;
     _objectCache = 0;
+    _stateShared = false;
+    _stateSetReplacements.clear();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -379,6 +596,8 @@ void DatabasePager::DatabaseRequest::invalidate()
 //
 DatabasePager::RequestQueue::RequestQueue(DatabasePager* pager):
     _pager(pager),
+    _version(0),
+    _sequence(0),
     _frameNumberLastPruned(osg::UNINITIALIZED_FRAME_NUMBER)
 {
 }
@@ -386,11 +605,11 @@ DatabasePager::RequestQueue::RequestQueue(DatabasePager* pager):
 DatabasePager::RequestQueue::~RequestQueue()
 {
     OSG_INFO<<"DatabasePager::RequestQueue::~RequestQueue() Destructing queue."<<std::endl;
-    for(RequestList::iterator itr = _requestList.begin();
-        itr != _requestList.end();
+    for(QueuedRequestMap::iterator itr = _queuedRequests.begin();
+        itr != _queuedRequests.end();
         ++itr)
     {
-        invalidate(itr->get());
+        invalidate(itr->second._request.get());
     }
 }
 
@@ -408,6 +627,42 @@ void DatabasePager::RequestQueue::invalidate(DatabaseRequest* dr)
     dr->invalidate();
 }
 
+void DatabasePager::RequestQueue::pushNoLock(QueuedRequest& queuedRequest)
+{
+    HeapEntry entry;
+    entry._request = queuedRequest._request.get();
+    entry._version = queuedRequest._version = ++_version;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        entry._timestampLastRequest = queuedRequest._request->_timestampLastRequest;
+        entry._priorityLastRequest = queuedRequest._request->_priorityLastRequest;
+    }
+
+    _requestHeap.push_back(entry);
+    std::push_heap(_requestHeap.begin(), _requestHeap.end());
+
+    // every priority update leaves an outdated entry behind, drop them once they outnumber the queued requests
+    if (_requestHeap.size() > 2*_queuedRequests.size() + 64) compactHeapNoLock();
+}
+
+void DatabasePager::RequestQueue::compactHeapNoLock()
+{
+    RequestHeap::iterator last = _requestHeap.begin();
+    for(RequestHeap::iterator itr = _requestHeap.begin();
+        itr != _requestHeap.end();
+        ++itr)
+    {
+        QueuedRequestMap::iterator qitr = _queuedRequests.find(itr->_request);
+        if (qitr != _queuedRequests.end() && qitr->second._version == itr->_version)
+        {
+            *last++ = *itr;
+        }
+    }
+
+    _requestHeap.erase(last, _requestHeap.end());
+    std::make_heap(_requestHeap.begin(), _requestHeap.end());
+}
+
 
 bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
 {
@@ -416,57 +671,62 @@ bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
     unsigned int frameNumber = _pager->_frameNumber;
     if (_frameNumberLastPruned != frameNumber)
     {
-        for(RequestQueue::RequestList::iterator citr = _requestList.begin();
-            citr != _requestList.end();
+        bool pruned = false;
+        for(QueuedRequestMap::iterator citr = _queuedRequests.begin();
+            citr != _queuedRequests.end();
             )
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
+            if (citr->second._request->isRequestCurrent(frameNumber))
             {
                 ++citr;
             }
             else
             {
-                invalidate(citr->get());
+                invalidate(citr->second._request.get());
 
-                OSG_INFO<<"DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty(): Pruning "<<(*citr)<<std::endl;
-                citr = _requestList.erase(citr);
+                OSG_INFO<<"DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty(): Pruning "<<citr->second._request.get()<<std::endl;
+                _queuedRequests.erase(citr++);
+                pruned = true;
             }
         }
 
+        if (pruned) compactHeapNoLock();
+
         _frameNumberLastPruned = frameNumber;
 
         updateBlock();
     }
 
-    return _requestList.empty();
+    return _queuedRequests.empty();
 }
 
 bool DatabasePager::RequestQueue::empty()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    return _requestList.empty();
+    return _queuedRequests.empty();
 }
 
 unsigned int DatabasePager::RequestQueue::size()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    return _requestList.size();
+    return _queuedRequests.size();
 }
 
 void DatabasePager::RequestQueue::clear()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
-    for(RequestList::iterator citr = _requestList.begin();
-        citr != _requestList.end();
+    for(QueuedRequestMap::iterator citr = _queuedRequests.begin();
+        citr != _queuedRequests.end();
         ++citr)
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-        invalidate(citr->get());
+        invalidate(citr->second._request.get());
     }
 
-    _requestList.clear();
+    _queuedRequests.clear();
+    _requestHeap.clear();
 
     _frameNumberLastPruned = _pager->_frameNumber;
 
@@ -485,79 +745,144 @@ void DatabasePager::RequestQueue::remove(DatabasePager::DatabaseRequest* databas
 {
     // OSG_NOTICE<<"DatabasePager::RequestQueue::remove(DatabaseRequest* databaseRequest)"<<std::endl;
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    for(RequestList::iterator citr = _requestList.begin();
-        citr != _requestList.end();
-        ++citr)
-    {
-        if (citr->get()==databaseRequest)
-        {
-            // OSG_NOTICE<<"  done remove(DatabaseRequest* databaseRequest)"<<std::endl;
-            _requestList.erase(citr);
-            return;
-        }
-    }
+
+    // the heap entry is skipped when it reaches the top
+    _queuedRequests.erase(databaseRequest);
 }
 
 
 void DatabasePager::RequestQueue::addNoLock(DatabasePager::DatabaseRequest* databaseRequest)
 {
-    _requestList.push_back(databaseRequest);
+    QueuedRequest& queuedRequest = _queuedRequests[databaseRequest];
+    if (!queuedRequest._request)
+    {
+        queuedRequest._request = databaseRequest;
+        queuedRequest._sequence = _sequence++;
+    }
+
+    // a request added again is only repositioned
+    pushNoLock(queuedRequest);
     updateBlock();
 }
 
+void DatabasePager::RequestQueue::updatePriority(DatabasePager::DatabaseRequest* databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    QueuedRequestMap::iterator itr = _queuedRequests.find(databaseRequest);
+    if (itr != _queuedRequests.end()) pushNoLock(itr->second);
+}
+
+namespace
+{
+    template<class Item>
+    struct SortBySequence
+    {
+        bool operator() (const Item* lhs, const Item* rhs) const { return lhs->_sequence < rhs->_sequence; }
+    };
+}
+
 void DatabasePager::RequestQueue::swap(RequestList& requestList)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    _requestList.swap(requestList);
+
+    RequestList incoming;
+    incoming.swap(requestList);
+
+    // hand over the queued requests in the order they were added
+    std::vector<const QueuedRequest*> queued;
+    queued.reserve(_queuedRequests.size());
+    for(QueuedRequestMap::const_iterator itr = _queuedRequests.begin();
+        itr != _queuedRequests.end();
+        ++itr)
+    {
+        queued.push_back(&(itr->second));
+    }
+    std::sort(queued.begin(), queued.end(), SortBySequence<QueuedRequest>());
+
+    for(std::vector<const QueuedRequest*>::iterator itr = queued.begin();
+        itr != queued.end();
+        ++itr)
+    {
+        requestList.push_back((*itr)->_request);
+    }
+
+    _queuedRequests.clear();
+    _requestHeap.clear();
+
+    for(RequestList::iterator itr = incoming.begin();
+        itr != incoming.end();
+        ++itr)
+    {
+        QueuedRequest& queuedRequest = _queuedRequests[itr->get()];
+        queuedRequest._request = *itr;
+        queuedRequest._sequence = _sequence++;
+        pushNoLock(queuedRequest);
+    }
 }
 
-void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest)
+bool DatabasePager::RequestQueue::peekFirst(HeapEntry& entry)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
-    if (!_requestList.empty())
+    // drop the stale entries on top, they would be skipped by takeFirst as well
+    while(!_requestHeap.empty())
     {
-        DatabasePager::SortFileRequestFunctor highPriority;
+        const HeapEntry& front = _requestHeap.front();
+        QueuedRequestMap::iterator qitr = _queuedRequests.find(front._request);
+        if (qitr != _queuedRequests.end() && qitr->second._version == front._version)
+        {
+            entry = front;
+            return true;
+        }
+
+        std::pop_heap(_requestHeap.begin(), _requestHeap.end());
+        _requestHeap.pop_back();
+    }
 
-        RequestQueue::RequestList::iterator selected_itr = _requestList.end();
+    return false;
+}
+
+void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
+    if (!_queuedRequests.empty())
+    {
         int frameNumber = _pager->_frameNumber;
 
-        for(RequestQueue::RequestList::iterator citr = _requestList.begin();
-            citr != _requestList.end();
-            )
+        while(!_requestHeap.empty())
         {
+            HeapEntry entry = _requestHeap.front();
+            std::pop_heap(_requestHeap.begin(), _requestHeap.end());
+            _requestHeap.pop_back();
+
+            // removed, taken or repositioned since the entry was pushed
+            QueuedRequestMap::iterator qitr = _queuedRequests.find(entry._request);
+            if (qitr == _queuedRequests.end() || qitr->second._version != entry._version) continue;
+
+            osg::ref_ptr<DatabaseRequest> candidate = qitr->second._request;
+            _queuedRequests.erase(qitr);
+
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
+            if (candidate->isRequestCurrent(frameNumber))
             {
-                if (selected_itr==_requestList.end() || highPriority(*citr, *selected_itr))
-                {
-                    selected_itr = citr;
-                }
-
-                ++citr;
+                databaseRequest = candidate;
+                break;
             }
-            else
-            {
-                invalidate(citr->get());
 
-                OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<(*citr)<<std::endl;
-                citr = _requestList.erase(citr);
-            }
+            invalidate(candidate.get());
 
+            OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<candidate.get()<<std::endl;
         }
 
-        _frameNumberLastPruned = frameNumber;
-
-        if (selected_itr != _requestList.end())
+        if (databaseRequest.valid())
         {
-            databaseRequest = *selected_itr;
-            _requestList.erase(selected_itr);
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
+            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_queuedRequests.size()<<std::endl;
         }
         else
         {
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_requestList.size()<<std::endl;
+            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_queuedRequests.size()<<std::endl;
         }
 
         updateBlock();
@@ -577,8 +902,12 @@ DatabasePager::ReadQueue::ReadQueue(DatabasePager* pager, const std::string& nam
 
 void DatabasePager::ReadQueue::updateBlock()
 {
-    _block->set((!_requestList.empty() || !_childrenToDeleteList.empty()) &&
+    _block->set((!_queuedRequests.empty() || !_childrenToDeleteList.empty()) &&
                 !_pager->_databasePagerThreadPaused);
+
+    _numRequestsQueued.exchange(static_cast<unsigned int>(_queuedRequests.size()));
+    _numChildrenToDelete.exchange(static_cast<unsigned int>(_childrenToDeleteList.size()));
+    _pager->updateThreadPoolBlock();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -590,7 +919,8 @@ DatabasePager::DatabaseThread::DatabaseThread(DatabasePager* pager, Mode mode, c
     _active(false),
     _pager(pager),
     _mode(mode),
-    _name(name)
+    _name(name),
+    _poolIndex(0)
 {
 }
 
@@ -599,7 +929,8 @@ DatabasePager::DatabaseThread::DatabaseThread(const DatabaseThread& dt, Database
     _active(false),
     _pager(pager),
     _mode(dt._mode),
-    _name(dt._name)
+    _name(dt._name),
+    _poolIndex(dt._poolIndex)
 {
 }
 
@@ -627,6 +958,9 @@ int DatabasePager::DatabaseThread::cancel()
             case(HANDLE_ONLY_HTTP):
                 _pager->_httpRequestQueue->release();
                 break;
+            case(HANDLE_POOLED_REQUESTS):
+                _pager->wakeThreadPool();
+                break;
         }
 
         join();
@@ -661,14 +995,30 @@ void DatabasePager::DatabaseThread::run()
         case(HANDLE_ONLY_HTTP):
             read_queue = _pager->_httpRequestQueue;
             break;
+        case(HANDLE_POOLED_REQUESTS):
+            // subgraphs to delete are only ever put on the file request queue
+            read_queue = _pager->_fileRequestQueue;
+            out_queue = _pager->_httpRequestQueue;
+            break;
     }
 
+    bool pooled = _mode==HANDLE_POOLED_REQUESTS;
+
 
     do
     {
         _active = false;
 
-        read_queue->block();
+        if (pooled)
+        {
+            if (!_pager->waitForThreadPoolSlot(this)) break;
+
+            _pager->_threadPoolBlock->block();
+        }
+        else
+        {
+            read_queue->block();
+        }
 
         if (_done)
         {
@@ -702,7 +1052,18 @@ void DatabasePager::DatabaseThread::run()
         // load any subgraphs that are required.
         //
         osg::ref_ptr<DatabaseRequest> databaseRequest;
-        read_queue->takeFirst(databaseRequest);
+        RequestSource source = LOCAL_FILE_SOURCE;
+        bool holdsPoolSlot = false;
+        double readTime = 0.0;
+
+        if (pooled)
+        {
+            holdsPoolSlot = _pager->takePooledRequest(_poolIndex, databaseRequest, source);
+        }
+        else
+        {
+            read_queue->takeFirst(databaseRequest);
+        }
 
         bool readFromFileCache = false;
 
@@ -766,6 +1127,8 @@ void DatabasePager::DatabaseThread::run()
                         databaseRequest = 0;
                     }
 
+                    if (holdsPoolSlot) _pager->releasePooledRequest(source, 0.0);
+
                     // skip the rest of the do/while loop as we have done all the processing we need to do.
                     continue;
                 }
@@ -777,7 +1140,7 @@ void DatabasePager::DatabaseThread::run()
                 // need to disable any attempt to use the cache when loading as we're handle this ourselves to avoid threading conflicts
                 {
                     OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-                    databaseRequest->_objectCache = new ObjectCache;
+                    databaseRequest->_objectCache = new ObjectCache(1);
                     dr_loadOptions->setObjectCache(databaseRequest->_objectCache.get());
                 }
             }
@@ -836,6 +1199,32 @@ void DatabasePager::DatabaseThread::run()
                         // accept all requests, as we'll assume only high latency requests will have got here.
                         break;
                     }
+                    case(HANDLE_POOLED_REQUESTS):
+                    {
+                        bool isHighLatencyFileRequest = source==NETWORK_SOURCE;
+
+                        // network requests aren't recognised by name alone, check with the callback like HANDLE_NON_HTTP
+                        if (!isHighLatencyFileRequest && fileLocationCallback.valid())
+                        {
+                            isHighLatencyFileRequest = fileLocationCallback->fileLocation(fileName, dr_loadOptions.get()) == FileLocationCallback::REMOTE_FILE;
+                        }
+                        else if (!isHighLatencyFileRequest && fileCache.valid() && fileCache->isFileAppropriateForFileCache(fileName))
+                        {
+                            isHighLatencyFileRequest = true;
+                        }
+
+                        if (fileCache.valid() && fileCache->isFileAppropriateForFileCache(fileName) && fileCache->existsInCache(fileName))
+                        {
+                            readFromFileCache = true;
+                        }
+                        else if (isHighLatencyFileRequest && source!=NETWORK_SOURCE)
+                        {
+                            OSG_INFO<<_name<<": Passing http requests over "<<fileName<<std::endl;
+                            out_queue->add(databaseRequest.get());
+                            databaseRequest = 0;
+                        }
+                        break;
+                    }
                 }
             }
             else
@@ -854,11 +1243,15 @@ void DatabasePager::DatabaseThread::run()
             //osg::Timer_t before = osg::Timer::instance()->tick();
 
 
+            osg::Timer_t readStart = osg::Timer::instance()->tick();
+
             // assume that readNode is thread safe...
             ReaderWriter::ReadResult rr = readFromFileCache ?
                         fileCache->readNode(fileName, dr_loadOptions.get(), false) :
                         Registry::instance()->readNode(fileName, dr_loadOptions.get(), false);
 
+            readTime = osg::Timer::instance()->delta_s(readStart, osg::Timer::instance()->tick());
+
             osg::ref_ptr<osg::Node> loadedModel;
             if (rr.validNode()) loadedModel = rr.getNode();
             if (!rr.success()) OSG_WARN<<"Error in reading file "<<fileName<<" : "<<rr.statusMessage() << std::endl;
@@ -886,6 +1279,17 @@ void DatabasePager::DatabaseThread::run()
             {
                 loadedModel->getBound();
 
+                // share the state of the model while it is still private to this thread, leaving just the StateSets
+                // to assign on merge, so that several database threads don't queue up behind the update thread.
+                bool stateShared = false;
+                SharedStateManager::StateSetReplacementList stateSetReplacements;
+                SharedStateManager* sharedStateManager = osgDB::Registry::instance()->getSharedStateManager();
+                if (sharedStateManager && sharedStateManager->getConcurrentSharing() && !rr.loadedFromCache())
+                {
+                    sharedStateManager->share(loadedModel.get(), stateSetReplacements);
+                    stateShared = true;
+                }
+
                 bool loadedObjectsNeedToBeCompiled = false;
                 osg::ref_ptr<osgUtil::IncrementalCompileOperation::CompileSet> compileSet = 0;
                 if (!rr.loadedFromCache())
@@ -920,6 +1324,8 @@ void DatabasePager::DatabaseThread::run()
                     OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
                     databaseRequest->_loadedModel = loadedModel;
                     databaseRequest->_compileSet = compileSet;
+                    databaseRequest->_stateShared = stateShared;
+                    databaseRequest->_stateSetReplacements.swap(stateSetReplacements);
                 }
                 // Dereference the databaseRequest while the queue is
                 // locked. This prevents the request from being
@@ -949,6 +1355,8 @@ void DatabasePager::DatabaseThread::run()
             OpenThreads::Thread::YieldCurrentThread();
         }
 
+        if (holdsPoolSlot) _pager->releasePooledRequest(source, readTime);
+
 
         // go to sleep till our the next time our thread gets scheduled.
 
@@ -1032,6 +1440,13 @@ DatabasePager::DatabasePager()
 
     }
 
+    _backgroundDeleteHandler = 0;
+    if( (str = getenv("OSG_BACKGROUND_DELETION")) != 0)
+    {
+        setDeleteRemovedSubgraphsInBackgroundThread(strcmp(str,"yes")==0 || strcmp(str,"YES")==0 ||
+                                                    strcmp(str,"on")==0 || strcmp(str,"ON")==0);
+    }
+
     _targetMaximumNumberOfPageLOD = 300;
     if( (str = getenv("OSG_MAX_PAGEDLOD")) != 0)
     {
@@ -1047,10 +1462,45 @@ DatabasePager::DatabasePager()
                         strcmp(str,"on")==0 || strcmp(str,"ON")==0;
     }
 
+    _useThreadPool = false;
+    if( (str = getenv("OSG_DATABASE_PAGER_THREAD_POOL")) != 0)
+    {
+        _useThreadPool = strcmp(str,"yes")==0 || strcmp(str,"YES")==0 ||
+                         strcmp(str,"on")==0 || strcmp(str,"ON")==0;
+    }
+
+    _doPrefetch = false;
+    if( (str = getenv("OSG_DATABASE_PAGER_PREFETCH")) != 0)
+    {
+        _doPrefetch = strcmp(str,"yes")==0 || strcmp(str,"YES")==0 ||
+                      strcmp(str,"on")==0 || strcmp(str,"ON")==0;
+    }
+
+    _prefetchTime = 1.0;
+    if( (str = getenv("OSG_DATABASE_PAGER_PREFETCH_TIME")) != 0)
+    {
+        _prefetchTime = osg::asciiToDouble(str);
+    }
+
+    _numPrefetchSteps = 2;
+    _maximumNumPrefetchRequests = 16;
+    _numPrefetchRequestsPending = 0;
+
+    // local reads scale with the cores, archives serialize on their file handle, network reads mostly wait
+    _minimumThreadPoolSize = 1;
+    _maximumThreadPoolSize = osg::maximum(8, OpenThreads::GetNumberOfProcessors()*2);
+    _threadPoolLatencyThreshold = 0.02;
+    _maximumNumOfConcurrentReads[LOCAL_FILE_SOURCE] = osg::maximum(2, OpenThreads::GetNumberOfProcessors());
+    _maximumNumOfConcurrentReads[ARCHIVE_SOURCE] = 2;
+    _maximumNumOfConcurrentReads[NETWORK_SOURCE] = 4;
+
     // initialize the stats variables
     resetStats();
 
+    initThreadPool();
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
+    _archiveRequestQueue = new ReadQueue(this,"archiveRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
 
     _dataToCompileList = new RequestQueue(this);
@@ -1118,11 +1568,32 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 
     _deleteRemovedSubgraphsInDatabaseThread = rhs._deleteRemovedSubgraphsInDatabaseThread;
 
+    _backgroundDeleteHandler = 0;
+    setDeleteRemovedSubgraphsInBackgroundThread(rhs.getDeleteRemovedSubgraphsInBackgroundThread());
+
     _targetMaximumNumberOfPageLOD = rhs._targetMaximumNumberOfPageLOD;
 
     _doPreCompile = rhs._doPreCompile;
 
+    _doPrefetch = rhs._doPrefetch;
+    _prefetchTime = rhs._prefetchTime;
+    _numPrefetchSteps = rhs._numPrefetchSteps;
+    _maximumNumPrefetchRequests = rhs._maximumNumPrefetchRequests;
+    _numPrefetchRequestsPending = 0;
+
+    _useThreadPool = rhs._useThreadPool;
+    _minimumThreadPoolSize = rhs._minimumThreadPoolSize;
+    _maximumThreadPoolSize = rhs._maximumThreadPoolSize;
+    _threadPoolLatencyThreshold = rhs._threadPoolLatencyThreshold;
+    for(unsigned int i=0; i<NUMBER_OF_REQUEST_SOURCES; ++i)
+    {
+        _maximumNumOfConcurrentReads[i] = rhs._maximumNumOfConcurrentReads[i];
+    }
+
+    initThreadPool();
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
+    _archiveRequestQueue = new ReadQueue(this,"archiveRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
 
     _dataToCompileList = new RequestQueue(this);
@@ -1168,6 +1639,7 @@ DatabasePager::~DatabasePager()
 
     // destruct all the queues
     _fileRequestQueue = 0;
+    _archiveRequestQueue = 0;
     _httpRequestQueue = 0;
     _dataToCompileList = 0;
     _dataToMergeList = 0;
@@ -1175,10 +1647,29 @@ DatabasePager::~DatabasePager()
     // remove reference to the ICO
     _incrementalCompileOperation = 0;
 
+    // release the subgraphs still waiting for the background thread
+    setDeleteRemovedSubgraphsInBackgroundThread(false);
+
     //_activePagedLODList;
     //_inactivePagedLODList;
 }
 
+void DatabasePager::setDeleteRemovedSubgraphsInBackgroundThread(bool flag)
+{
+    if (flag==(_backgroundDeleteHandler!=0)) return;
+
+    if (flag)
+    {
+        _backgroundDeleteHandler = new BackgroundDeleteHandler(0);
+    }
+    else
+    {
+        _backgroundDeleteHandler->shutdown();
+        delete _backgroundDeleteHandler;
+        _backgroundDeleteHandler = 0;
+    }
+}
+
 osg::ref_ptr<DatabasePager>& DatabasePager::prototype()
 {
     static osg::ref_ptr<DatabasePager> s_DatabasePager = new DatabasePager;
@@ -1210,6 +1701,19 @@ void DatabasePager::setUpThreads(unsigned int totalNumThreads, unsigned int numH
 {
     _databaseThreads.clear();
 
+    if (_useThreadPool)
+    {
+        // all threads are created up front, the ones above the active size stay parked until the pool grows
+        _threadPoolActiveSize.exchange(osg::clampBetween(totalNumThreads, _minimumThreadPoolSize, _maximumThreadPoolSize));
+        _threadPoolLastResize = osg::Timer::instance()->tick();
+
+        for(unsigned int i=0; i<_maximumThreadPoolSize; ++i)
+        {
+            addDatabaseThread(DatabaseThread::HANDLE_POOLED_REQUESTS, "HANDLE_POOLED_REQUESTS");
+        }
+        return;
+    }
+
     unsigned int numGeneralThreads = numHttpThreads < totalNumThreads ?
         totalNumThreads - numHttpThreads :
         1;
@@ -1243,6 +1747,18 @@ unsigned int DatabasePager::addDatabaseThread(DatabaseThread::Mode mode, const s
 
     DatabaseThread* thread = new DatabaseThread(this, mode,name);
 
+    if (mode==DatabaseThread::HANDLE_POOLED_REQUESTS)
+    {
+        unsigned int poolIndex = 0;
+        for(DatabaseThreadList::iterator itr = _databaseThreads.begin();
+            itr != _databaseThreads.end();
+            ++itr)
+        {
+            if ((*itr)->_mode==DatabaseThread::HANDLE_POOLED_REQUESTS) ++poolIndex;
+        }
+        thread->_poolIndex = poolIndex;
+    }
+
     thread->setProcessorAffinity(_affinity);
 
     _databaseThreads.push_back(thread);
@@ -1256,6 +1772,210 @@ unsigned int DatabasePager::addDatabaseThread(DatabaseThread::Mode mode, const s
     return pos;
 }
 
+void DatabasePager::initThreadPool()
+{
+    _threadPoolBlock = new osg::RefBlock;
+    _threadPoolActiveSize.exchange(0);
+    _threadPoolLastResize = osg::Timer::instance()->tick();
+
+    for(unsigned int i=0; i<NUMBER_OF_REQUEST_SOURCES; ++i)
+    {
+        _numOfConcurrentReads[i].exchange(0);
+        _averageReadLatency[i] = 0.0;
+    }
+}
+
+void DatabasePager::setThreadPoolSize(unsigned int minNumThreads, unsigned int maxNumThreads)
+{
+    _minimumThreadPoolSize = osg::maximum(minNumThreads, 1u);
+    _maximumThreadPoolSize = osg::maximum(maxNumThreads, _minimumThreadPoolSize);
+}
+
+void DatabasePager::setMaximumNumOfConcurrentReads(RequestSource source, unsigned int numReads)
+{
+    _maximumNumOfConcurrentReads[source] = osg::maximum(numReads, 1u);
+    updateThreadPoolBlock();
+}
+
+double DatabasePager::getAverageReadLatency(RequestSource source) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(const_cast<OpenThreads::Mutex&>(_threadPoolMutex));
+    return _averageReadLatency[source];
+}
+
+DatabasePager::RequestSource DatabasePager::getRequestSource(const std::string& fileName, const Options* /*options*/) const
+{
+    if (containsServerAddress(fileName)) return NETWORK_SOURCE;
+
+    std::string lowerFileName = convertToLowerCase(fileName);
+
+    const Registry::ArchiveExtensionList& extensions = Registry::instance()->getArchiveExtensions();
+    for(Registry::ArchiveExtensionList::const_iterator itr = extensions.begin();
+        itr != extensions.end();
+        ++itr)
+    {
+        std::string::size_type pos = lowerFileName.find(std::string(".")+*itr);
+        while (pos != std::string::npos)
+        {
+            std::string::size_type end = pos + itr->size() + 1;
+            if (end < lowerFileName.size() && (lowerFileName[end]=='/' || lowerFileName[end]=='\\')) return ARCHIVE_SOURCE;
+
+            pos = lowerFileName.find(std::string(".")+*itr, end);
+        }
+    }
+
+    return LOCAL_FILE_SOURCE;
+}
+
+DatabasePager::ReadQueue* DatabasePager::getReadQueue(RequestSource source) const
+{
+    switch(source)
+    {
+        case(ARCHIVE_SOURCE): return _archiveRequestQueue.get();
+        case(NETWORK_SOURCE): return _httpRequestQueue.get();
+        default: return _fileRequestQueue.get();
+    }
+}
+
+bool DatabasePager::takePooledRequest(unsigned int poolIndex, osg::ref_ptr<DatabaseRequest>& databaseRequest, RequestSource& source)
+{
+    for(;;)
+    {
+        // the best head of the sources with a free read slot, so the order of the requests holds across the sources
+        bool found = false;
+        RequestQueue::HeapEntry best;
+        for(unsigned int i=0; i<NUMBER_OF_REQUEST_SOURCES; ++i)
+        {
+            RequestSource candidate = static_cast<RequestSource>((poolIndex + i) % NUMBER_OF_REQUEST_SOURCES);
+            ReadQueue* queue = getReadQueue(candidate);
+            if (queue->_numRequestsQueued==0) continue;
+            if (_numOfConcurrentReads[candidate] >= _maximumNumOfConcurrentReads[candidate]) continue;
+
+            RequestQueue::HeapEntry entry;
+            if (!queue->peekFirst(entry)) continue;
+
+            if (!found ||
+                entry._timestampLastRequest>best._timestampLastRequest ||
+                (entry._timestampLastRequest==best._timestampLastRequest && entry._priorityLastRequest>best._priorityLastRequest))
+            {
+                found = true;
+                best = entry;
+                source = candidate;
+            }
+        }
+
+        if (!found) break;
+
+        // reserve a read slot before taking, so the limit holds however many threads race for the source
+        if (++_numOfConcurrentReads[source] > _maximumNumOfConcurrentReads[source])
+        {
+            --_numOfConcurrentReads[source];
+            continue;
+        }
+
+        // another thread may have taken the head meanwhile, then the next one of the source is as good as any
+        getReadQueue(source)->takeFirst(databaseRequest);
+        if (databaseRequest.valid()) return true;
+
+        // everything left in the source was pruned, look again
+        --_numOfConcurrentReads[source];
+    }
+
+    updateThreadPoolBlock();
+    return false;
+}
+
+void DatabasePager::releasePooledRequest(RequestSource source, double readTime)
+{
+    --_numOfConcurrentReads[source];
+
+    if (readTime>0.0)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadPoolMutex);
+        double& latency = _averageReadLatency[source];
+        latency = latency==0.0 ? readTime : latency*0.9 + readTime*0.1;
+    }
+
+    adaptThreadPoolSize();
+    updateThreadPoolBlock();
+}
+
+bool DatabasePager::waitForThreadPoolSlot(DatabaseThread* thread)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadPoolMutex);
+    while(!thread->getDone() && thread->_poolIndex >= _threadPoolActiveSize)
+    {
+        _threadPoolCondition.wait(&_threadPoolMutex);
+    }
+    return !thread->getDone();
+}
+
+void DatabasePager::updateThreadPoolBlock()
+{
+    // called with queue locks held, so only reads the published sizes and takes the leaf block mutex
+    if (!_threadPoolBlock || !_fileRequestQueue || !_archiveRequestQueue || !_httpRequestQueue) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadPoolBlockMutex);
+
+    bool work = _fileRequestQueue->_numChildrenToDelete>0;
+    for(unsigned int i=0; i<NUMBER_OF_REQUEST_SOURCES && !work; ++i)
+    {
+        work = getReadQueue(static_cast<RequestSource>(i))->_numRequestsQueued>0 &&
+               _numOfConcurrentReads[i] < _maximumNumOfConcurrentReads[i];
+    }
+
+    _threadPoolBlock->set(work && !_databasePagerThreadPaused);
+}
+
+void DatabasePager::adaptThreadPoolSize()
+{
+    osg::Timer_t now = osg::Timer::instance()->tick();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadPoolMutex);
+
+    if (osg::Timer::instance()->delta_s(_threadPoolLastResize, now) < 0.25) return;
+
+    bool backlog = false;
+    unsigned int busy = 0;
+    double latency = 0.0;
+    for(unsigned int i=0; i<NUMBER_OF_REQUEST_SOURCES; ++i)
+    {
+        busy += _numOfConcurrentReads[i];
+        latency = osg::maximum(latency, _averageReadLatency[i]);
+        if (getReadQueue(static_cast<RequestSource>(i))->_numRequestsQueued>0 &&
+            _numOfConcurrentReads[i] < _maximumNumOfConcurrentReads[i])
+        {
+            backlog = true;
+        }
+    }
+
+    unsigned int activeSize = _threadPoolActiveSize;
+    if (backlog && busy>=activeSize && latency>_threadPoolLatencyThreshold && activeSize<_maximumThreadPoolSize)
+    {
+        _threadPoolActiveSize.exchange(activeSize+1);
+        _threadPoolLastResize = now;
+        _threadPoolCondition.broadcast();
+
+        OSG_INFO<<"DatabasePager thread pool grown to "<<activeSize+1<<" threads, average read latency "<<latency<<"s"<<std::endl;
+    }
+    else if (!backlog && busy+1<activeSize && activeSize>_minimumThreadPoolSize)
+    {
+        // the parked thread finishes its current read first
+        _threadPoolActiveSize.exchange(activeSize-1);
+        _threadPoolLastResize = now;
+
+        OSG_INFO<<"DatabasePager thread pool shrunk to "<<activeSize-1<<" threads"<<std::endl;
+    }
+}
+
+void DatabasePager::wakeThreadPool()
+{
+    if (_threadPoolBlock.valid()) _threadPoolBlock->release();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadPoolMutex);
+    _threadPoolCondition.broadcast();
+}
+
 int DatabasePager::setSchedulePriority(OpenThreads::Thread::ThreadPriority priority)
 {
     int result = 0;
@@ -1293,7 +2013,9 @@ int DatabasePager::cancel()
 
     // release the queue blocks in case they are holding up thread cancellation.
     _fileRequestQueue->release();
+    _archiveRequestQueue->release();
     _httpRequestQueue->release();
+    wakeThreadPool();
 
     for(DatabaseThreadList::iterator dt_itr = _databaseThreads.begin();
         dt_itr != _databaseThreads.end();
@@ -1311,6 +2033,7 @@ int DatabasePager::cancel()
 void DatabasePager::clear()
 {
     _fileRequestQueue->clear();
+    _archiveRequestQueue->clear();
     _httpRequestQueue->clear();
 
     _dataToCompileList->clear();
@@ -1354,6 +2077,14 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                                     float priority, const osg::FrameStamp* framestamp,
                                     osg::ref_ptr<osg::Referenced>& databaseRequestRef,
                                     const osg::Referenced* options)
+{
+    requestNodeFileImplementation(fileName, nodePath, priority, framestamp, databaseRequestRef, options, false);
+}
+
+bool DatabasePager::requestNodeFileImplementation(const std::string& fileName, osg::NodePath& nodePath,
+                                                  float priority, const osg::FrameStamp* framestamp,
+                                                  osg::ref_ptr<osg::Referenced>& databaseRequestRef,
+                                                  const osg::Referenced* options, bool prefetch)
 {
     osgDB::Options* loadOptions = dynamic_cast<osgDB::Options*>(const_cast<osg::Referenced*>(options));
     if (!loadOptions)
@@ -1366,20 +2097,20 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
     }
 
 
-    if (!_acceptNewRequests) return;
+    if (!_acceptNewRequests) return false;
 
 
     if (nodePath.empty())
     {
         OSG_NOTICE<<"Warning: DatabasePager::requestNodeFile(..) passed empty NodePath, so nowhere to attach new subgraph to."<<std::endl;
-        return;
+        return false;
     }
 
     osg::Group* group = nodePath.back()->asGroup();
     if (!group)
     {
         OSG_NOTICE<<"Warning: DatabasePager::requestNodeFile(..) passed NodePath without group as last node in path, so nowhere to attach new subgraph to."<<std::endl;
-        return;
+        return false;
     }
 
     osg::Node* terrain = 0;
@@ -1410,11 +2141,13 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
 
     // search to see if filename already exist in the file loaded list.
     bool foundEntry = false;
+    bool queued = false;
 
     if (databaseRequestRef.valid())
     {
         DatabaseRequest* databaseRequest = dynamic_cast<DatabaseRequest*>(databaseRequestRef.get());
         bool requeue = false;
+        bool reprioritize = false;
         if (databaseRequest)
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
@@ -1427,6 +2160,8 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
             {
                 OSG_INFO<<"DatabasePager::requestNodeFile("<<fileName<<") updating already assigned."<<std::endl;
 
+                reprioritize = databaseRequest->_timestampLastRequest != timestamp ||
+                               databaseRequest->_priorityLastRequest != priority;
 
                 databaseRequest->_valid = true;
                 databaseRequest->_frameNumberLastRequest = frameNumber;
@@ -1434,6 +2169,9 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                 databaseRequest->_priorityLastRequest = priority;
                 ++(databaseRequest->_numOfRequests);
 
+                // the cull traversal takes over the requests prefetched for it
+                if (!prefetch) databaseRequest->_prefetchOnly = false;
+
                 foundEntry = true;
 
                 if (databaseRequestRef->referenceCount()==1)
@@ -1447,20 +2185,35 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                     databaseRequest->_terrain = terrain;
                     databaseRequest->_loadOptions = loadOptions;
                     databaseRequest->_objectCache = 0;
+                    databaseRequest->_prefetchOnly = prefetch;
                     requeue = true;
                 }
 
             }
         }
         if (requeue)
-            _fileRequestQueue->add(databaseRequest);
+        {
+            ReadQueue* requestQueue = _useThreadPool ? getReadQueue(getRequestSource(fileName, loadOptions)) : _fileRequestQueue.get();
+            requestQueue->add(databaseRequest);
+            queued = true;
+        }
+        else if (reprioritize)
+        {
+            // the request may be waiting in any of the read queues, move it to its new place
+            _fileRequestQueue->updatePriority(databaseRequest);
+            _archiveRequestQueue->updatePriority(databaseRequest);
+            _httpRequestQueue->updatePriority(databaseRequest);
+        }
     }
 
     if (!foundEntry)
     {
         OSG_INFO<<"In DatabasePager::requestNodeFile("<<fileName<<")"<<std::endl;
 
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
+        // a file name always maps to the same source, so the queue lock also serializes requests of the same PagedLOD child
+        ReadQueue* requestQueue = _useThreadPool ? getReadQueue(getRequestSource(fileName, loadOptions)) : _fileRequestQueue.get();
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(requestQueue->_requestMutex);
 
         if (!databaseRequestRef.valid() || databaseRequestRef->referenceCount()==1)
         {
@@ -1480,8 +2233,10 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
             databaseRequest->_terrain = terrain;
             databaseRequest->_loadOptions = loadOptions;
             databaseRequest->_objectCache = 0;
+            databaseRequest->_prefetchOnly = prefetch;
 
-            _fileRequestQueue->addNoLock(databaseRequest.get());
+            requestQueue->addNoLock(databaseRequest.get());
+            queued = true;
         }
     }
 
@@ -1515,6 +2270,199 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
 #ifdef WITH_REQUESTNODEFILE_TIMING
     totalTime += osg::Timer::instance()->delta_m(start_tick, osg::Timer::instance()->tick());
 #endif
+
+    return queued;
+}
+
+void DatabasePager::prefetch(osg::Node* subgraph, const osg::Camera& camera, const osg::FrameStamp& frameStamp)
+{
+    if (!_doPrefetch || !subgraph || !_acceptNewRequests) return;
+
+    updatePrefetchRequests(frameStamp);
+
+    double time = frameStamp.getReferenceTime();
+
+    osg::Matrixd cameraMatrix = osg::Matrixd::inverse(camera.getViewMatrix());
+
+    CameraSample sample;
+    sample._time = time;
+    sample._eye = cameraMatrix.getTrans();
+    sample._rotation = cameraMatrix.getRotate();
+
+    // forget the cameras that are no longer prefetched for
+    for(CameraSamplesMap::iterator itr = _cameraSamples.begin();
+        itr != _cameraSamples.end();)
+    {
+        if (itr->first!=&camera && (itr->second.empty() || time-itr->second.back()._time>1.0)) _cameraSamples.erase(itr++);
+        else ++itr;
+    }
+
+    // estimate the motion over the last half second, starting afresh if the time has gone back
+    CameraSamples& samples = _cameraSamples[&camera];
+    if (!samples.empty() && samples.back()._time>=time) samples.clear();
+    samples.push_back(sample);
+    while(samples.size()>2 && (samples.size()>32 || time-samples.front()._time>0.5)) samples.pop_front();
+
+    if (samples.size()<2 || _numPrefetchSteps==0 || _prefetchTime<=0.0) return;
+
+    const CameraSample& first = samples.front();
+    double dt = time-first._time;
+
+    osg::Vec3d velocity = (sample._eye-first._eye)/dt;
+
+    double angle;
+    osg::Vec3d axis;
+    (first._rotation.inverse()*sample._rotation).getRotate(angle, axis);
+    if (angle>osg::PI) angle -= 2.0*osg::PI;
+    double angularVelocity = angle/dt;
+
+    // a still camera needs nothing the cull traversal doesn't request itself
+    if (velocity.length2()==0.0 && fabs(angle)<1e-6) return;
+
+    PrefetchVisitor pv(this, camera, frameStamp);
+    for(unsigned int i=1; i<=_numPrefetchSteps; ++i)
+    {
+        double t = _prefetchTime*static_cast<double>(i)/static_cast<double>(_numPrefetchSteps);
+
+        osg::Quat rotation = sample._rotation;
+        if (fabs(angle)>=1e-6)
+        {
+            rotation = rotation*osg::Quat(osg::clampBetween(angularVelocity*t, -osg::PI_2, osg::PI_2), axis);
+        }
+
+        pv.setViewMatrix(osg::Matrixd::inverse(osg::Matrixd::rotate(rotation)*osg::Matrixd::translate(sample._eye+velocity*t)));
+        subgraph->accept(pv);
+    }
+}
+
+void DatabasePager::requestPrefetch(osg::Group* group, unsigned int childNo, const std::string& fileName, osg::NodePath& nodePath,
+                                    float priority, const osg::FrameStamp& frameStamp,
+                                    osg::ref_ptr<osg::Referenced>& databaseRequestRef, const osg::Referenced* options)
+{
+    bool pending = false;
+    if (databaseRequestRef.valid() && databaseRequestRef->referenceCount()>1)
+    {
+        DatabaseRequest* databaseRequest = dynamic_cast<DatabaseRequest*>(databaseRequestRef.get());
+        if (databaseRequest)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+            if (databaseRequest->valid())
+            {
+                // leave the requests of the cull traversal be, along with those renewed by a nearer prediction
+                if (!databaseRequest->_prefetchOnly || databaseRequest->_frameNumberLastRequest==frameStamp.getFrameNumber()) return;
+
+                pending = true;
+            }
+        }
+    }
+
+    if (!pending)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+        if (_numPrefetchRequestsPending>=_maximumNumPrefetchRequests) return;
+    }
+
+    if (requestNodeFileImplementation(fileName, nodePath, priority, &frameStamp, databaseRequestRef, options, true))
+    {
+        PrefetchRequest prefetchRequest;
+        prefetchRequest._request = dynamic_cast<DatabaseRequest*>(databaseRequestRef.get());
+        prefetchRequest._group = group;
+        prefetchRequest._childNo = childNo;
+        prefetchRequest._frameNumberRequested = frameStamp.getFrameNumber();
+        prefetchRequest._merged = false;
+        prefetchRequest._frameNumberMerged = 0;
+        prefetchRequest._timeMerged = 0.0;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+        _prefetchRequests.push_back(prefetchRequest);
+        ++_numPrefetchRequestsPending;
+        ++_prefetchStatistics.numRequested;
+    }
+}
+
+void DatabasePager::updatePrefetchRequests(const osg::FrameStamp& frameStamp)
+{
+    unsigned int frameNumber = frameStamp.getFrameNumber();
+    double time = frameStamp.getReferenceTime();
+
+    // time allowed for the camera to reach a merged child, beyond the time it was predicted ahead
+    double timeToUse = _prefetchTime*2.0 + 1.0;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+
+    _numPrefetchRequestsPending = 0;
+
+    for(PrefetchRequestList::iterator itr = _prefetchRequests.begin();
+        itr != _prefetchRequests.end();)
+    {
+        osg::ref_ptr<osg::Group> group;
+        if (!itr->_group.lock(group))
+        {
+            // the subgraph has been removed, so there's nothing left to judge the request by
+            itr = _prefetchRequests.erase(itr);
+            continue;
+        }
+
+        bool hit = false;
+        bool miss = false;
+        bool redundant = false;
+
+        if (!itr->_merged)
+        {
+            osg::ref_ptr<DatabaseRequest> databaseRequest;
+            itr->_request.lock(databaseRequest);
+
+            if (databaseRequest.valid() && databaseRequest->valid() && !databaseRequest->_prefetchOnly)
+            {
+                // taken over by the cull traversal, which runs after prefetch() each frame
+                if (frameNumber-1 <= itr->_frameNumberRequested) redundant = true;
+                else hit = true;
+            }
+            else if (group->getNumChildren()>itr->_childNo)
+            {
+                itr->_merged = true;
+                itr->_frameNumberMerged = frameNumber;
+                itr->_timeMerged = time;
+            }
+            else if (!databaseRequest.valid() || !databaseRequest->valid() || frameNumber-databaseRequest->_frameNumberLastRequest>1)
+            {
+                miss = true;
+            }
+            else
+            {
+                ++_numPrefetchRequestsPending;
+            }
+        }
+
+        if (itr->_merged)
+        {
+            osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(group.get());
+            if (!plod) hit = true;
+            else if (itr->_childNo<plod->getNumFrameNumbers() && plod->getFrameNumber(itr->_childNo)>itr->_frameNumberMerged) hit = true;
+            else if (time-itr->_timeMerged>timeToUse) miss = true;
+        }
+
+        if (hit) ++_prefetchStatistics.numHits;
+        if (miss) ++_prefetchStatistics.numMisses;
+
+        if (hit || miss || redundant) itr = _prefetchRequests.erase(itr);
+        else ++itr;
+    }
+}
+
+DatabasePager::PrefetchStatistics DatabasePager::getPrefetchStatistics() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+    PrefetchStatistics statistics = _prefetchStatistics;
+    statistics.numPending = static_cast<unsigned int>(_prefetchRequests.size());
+    return statistics;
+}
+
+void DatabasePager::resetPrefetchStatistics()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+    _prefetchStatistics = PrefetchStatistics();
 }
 
 void DatabasePager::signalBeginFrame(const osg::FrameStamp* framestamp)
@@ -1549,6 +2497,10 @@ void DatabasePager::setDatabasePagerThreadPause(bool pause)
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
         _fileRequestQueue->updateBlock();
     }
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_archiveRequestQueue->_requestMutex);
+        _archiveRequestQueue->updateBlock();
+    }
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_httpRequestQueue->_requestMutex);
         _httpRequestQueue->updateBlock();
@@ -1631,8 +2583,15 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
         osg::ref_ptr<osg::Group> group;
         if (!databaseRequest->_groupExpired && databaseRequest->_group.lock(group))
         {
-            if (osgDB::Registry::instance()->getSharedStateManager())
-                osgDB::Registry::instance()->getSharedStateManager()->share(databaseRequest->_loadedModel.get());
+            SharedStateManager* sharedStateManager = osgDB::Registry::instance()->getSharedStateManager();
+            if (databaseRequest->_stateShared)
+            {
+                if (sharedStateManager) sharedStateManager->applyStateSetReplacements(databaseRequest->_stateSetReplacements);
+            }
+            else if (sharedStateManager)
+            {
+                sharedStateManager->share(databaseRequest->_loadedModel.get());
+            }
 
             osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(group.get());
             if (plod)
@@ -1687,6 +2646,8 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
         }
         // reset the loadedModel pointer
         databaseRequest->_loadedModel = 0;
+        databaseRequest->_stateShared = false;
+        databaseRequest->_stateSetReplacements.clear();
 
         // OSG_NOTICE<<"curr = "<<timeToMerge<<" min "<<getMinimumTimeToMergeTile()*1000.0<<" max = "<<getMaximumTimeToMergeTile()*1000.0<<" average = "<<getAverageTimToMergeTiles()*1000.0<<std::endl;
     }
@@ -1777,9 +2738,20 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
 
     if (!childrenRemoved.empty())
     {
-        // pass the objects across to the database pager delete list
-        if (_deleteRemovedSubgraphsInDatabaseThread)
+        if (_backgroundDeleteHandler)
+        {
+            // hand the objects to the background thread, which drops the last references to them
+            for(ObjectList::iterator itr = childrenRemoved.begin();
+                itr != childrenRemoved.end();
+                ++itr)
+            {
+                _backgroundDeleteHandler->requestRelease(itr->get());
+            }
+            childrenRemoved.clear();
+        }
+        else if (_deleteRemovedSubgraphsInDatabaseThread)
         {
+            // pass the objects across to the database pager delete list
             OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
             // splice transfers the entire list in constant time.
             _fileRequestQueue->_childrenToDeleteList.splice(
@@ -16,22 +16,173 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <osgDB/MemoryMappedFile>
+#include <osgDB/fstream>
+
+#include <osg/Timer>
+#include <osg/Math>
+#include <osg/ApplicationUsage>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Atomic>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#if defined(WIN32) && !defined(__CYGWIN__)
+    #include <windows.h>
+#endif
 
 using namespace osgDB;
 
+static osg::ApplicationUsageProxy FileCache_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FILE_CACHE_WRITE_BEHIND on/off","Write files to the FileCache on a background thread rather than on the thread that read them.");
+static osg::ApplicationUsageProxy FileCache_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FILE_CACHE_MAX_SIZE <megabytes>","Bound the size of the FileCache directory, removing the oldest files first.");
+
+static const char* s_objectTypeNames[] = { "Object", "Image", "HeightField", "Node", "Shader" };
+
+// temporary files are written next to the cache file, so the rename stays on the same file system
+static const char* s_temporaryFilePrefix = ".osgtmp_";
+
+static OpenThreads::Atomic s_temporaryFileCount;
+
+static std::string createTemporaryFileName(const std::string& cacheFileName)
+{
+    // the start time keeps names apart between processes sharing a cache, the count between threads
+    std::ostringstream name;
+    name<<s_temporaryFilePrefix<<std::hex<<osg::Timer::instance()->getStartTick()<<"_"<<++s_temporaryFileCount<<"_"<<osgDB::getSimpleFileName(cacheFileName);
+    return osgDB::concatPaths(osgDB::getFilePath(cacheFileName), name.str());
+}
+
+static bool renameFile(const std::string& from, const std::string& to)
+{
+#if defined(WIN32) && !defined(__CYGWIN__)
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING)!=0;
+#else
+    return ::rename(from.c_str(), to.c_str())==0;
+#endif
+}
+
+// Plugins set up their options from the file name when they write or read a file, so do the same for a cache file
+// that is encoded to or decoded from memory: the path of the file and the osg2 plugin's fileType of .osgt/.osgx/.osgb.
+static osg::ref_ptr<osgDB::Options> createStreamOptions(const std::string& cacheFileName, const osgDB::Options* options)
+{
+    osg::ref_ptr<osgDB::Options> local_opt = options ? options->cloneOptions() : new osgDB::Options;
+    local_opt->getDatabasePathList().push_front(osgDB::getFilePath(cacheFileName));
+
+    std::string ext = osgDB::getLowerCaseFileExtension(cacheFileName);
+    if (ext=="osgt") local_opt->setPluginStringData("fileType", "Ascii");
+    else if (ext=="osgx") local_opt->setPluginStringData("fileType", "XML");
+    else if (ext=="osgb") local_opt->setPluginStringData("fileType", "Binary");
+
+    return local_opt;
+}
+
+static uint64_t getCachedFileSize(const std::string& fileName)
+{
+    struct stat fileStat;
+    if (::stat(fileName.c_str(), &fileStat)!=0) return 0;
+    return static_cast<uint64_t>(fileStat.st_size);
+}
+
+// files of the cache directory by modification time, with their sizes
+typedef std::vector< std::pair< time_t, std::pair<std::string, uint64_t> > > CachedFileTimeList;
+
+static void collectCachedFiles(const std::string& directory, CachedFileTimeList& files)
+{
+    DirectoryContents contents = osgDB::getDirectoryContents(directory);
+    for(DirectoryContents::iterator itr = contents.begin(); itr != contents.end(); ++itr)
+    {
+        if (*itr=="." || *itr=="..") continue;
+
+        std::string fileName = osgDB::concatPaths(directory, *itr);
+        switch(osgDB::fileType(fileName))
+        {
+            case(DIRECTORY):
+                collectCachedFiles(fileName, files);
+                break;
+            case(REGULAR_FILE):
+            {
+                // temporary files are removed by the writer that created them
+                if (itr->compare(0, strlen(s_temporaryFilePrefix), s_temporaryFilePrefix)==0) continue;
+
+                struct stat fileStat;
+                if (::stat(fileName.c_str(), &fileStat)==0)
+                {
+                    files.push_back(std::make_pair(fileStat.st_mtime, std::make_pair(fileName, static_cast<uint64_t>(fileStat.st_size))));
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // FileCache
 //
+class FileCache::WriteBehindThread : public OpenThreads::Thread
+{
+public:
+    WriteBehindThread(FileCache* fileCache) : _fileCache(fileCache) {}
+
+    virtual void run() { _fileCache->writePendingWrites(); }
+
+protected:
+    FileCache* _fileCache;
+};
+
 FileCache::FileCache(const std::string& path):
     osg::Referenced(true),
-    _fileCachePath(path)
+    _fileCachePath(path),
+    _writeBehind(false),
+    _maximumWriteQueueSizeInBytes(64*1024*1024),
+    _writeQueueSizeInBytes(0),
+    _writeBehindThread(0),
+    _done(false),
+    _maximumSizeInBytes(0),
+    _cacheScanned(false),
+    _sequence(0)
 {
     OSG_INFO<<"Constructed FileCache : "<<path<<std::endl;
+
+    const char* ptr = 0;
+    if ((ptr = getenv("OSG_FILE_CACHE_WRITE_BEHIND")) != 0)
+    {
+        _writeBehind = strcmp(ptr,"OFF")!=0 && strcmp(ptr,"Off")!=0 && strcmp(ptr,"off")!=0;
+        OSG_INFO<<"FileCache : write behind = "<<_writeBehind<<std::endl;
+    }
+
+    if ((ptr = getenv("OSG_FILE_CACHE_MAX_SIZE")) != 0)
+    {
+        _maximumSizeInBytes = static_cast<uint64_t>(osg::asciiToDouble(ptr)*1024.0*1024.0);
+        OSG_INFO<<"FileCache : maximum size = "<<ptr<<"MB"<<std::endl;
+    }
 }
 
 FileCache::~FileCache()
 {
+    if (_writeBehindThread)
+    {
+        // the thread writes out what is still queued before it exits
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+            _done = true;
+            _writeCondition.broadcast();
+        }
+        _writeBehindThread->join();
+        delete _writeBehindThread;
+    }
+
     OSG_INFO<<"Destructed FileCache "<<std::endl;
 }
 
@@ -54,7 +205,15 @@ std::string FileCache::createCacheFileName(const std::string& originalFileName)
 
 bool FileCache::existsInCache(const std::string& originalFileName) const
 {
-    if (osgDB::fileExists(createCacheFileName(originalFileName)))
+    std::string cacheFileName = createCacheFileName(originalFileName);
+
+    bool pending = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+        pending = _pendingWrites.count(cacheFileName)!=0;
+    }
+
+    if (pending || osgDB::fileExists(cacheFileName))
     {
         return !isCachedFileBlackListed(originalFileName);
     }
@@ -63,195 +222,425 @@ bool FileCache::existsInCache(const std::string& originalFileName) const
 
 ReaderWriter::ReadResult FileCache::readObject(const std::string& originalFileName, const osgDB::Options* options) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
-    {
-        OSG_INFO<<"FileCache::readObjectFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readObject(cacheFileName, options);
-    }
-    else
-    {
-        return 0;
-    }
+    return readFromCache(OBJECT, originalFileName, options);
 }
 
 ReaderWriter::WriteResult FileCache::writeObject(const osg::Object& object, const std::string& originalFileName, const osgDB::Options* options) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
-    {
-        std::string path = osgDB::getFilePath(cacheFileName);
-
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
-        {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
-        }
-
-        OSG_INFO<<"FileCache::writeObjectToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeObject(object, cacheFileName, options);
-        if (result.success())
-        {
-            removeFileFromBlackListed(originalFileName);
-        }
-        return result;
-    }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
+    return writeToCache(OBJECT, object, originalFileName, options);
 }
 
 ReaderWriter::ReadResult FileCache::readImage(const std::string& originalFileName, const osgDB::Options* options) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
-    {
-        OSG_INFO<<"FileCache::readImageFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readImage(cacheFileName, options);
-    }
-    else
-    {
-        return 0;
-    }
+    return readFromCache(IMAGE, originalFileName, options);
 }
 
 ReaderWriter::WriteResult FileCache::writeImage(const osg::Image& image, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return writeToCache(IMAGE, image, originalFileName, options);
+}
+
+ReaderWriter::ReadResult FileCache::readHeightField(const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return readFromCache(HEIGHTFIELD, originalFileName, options);
+}
+
+ReaderWriter::WriteResult FileCache::writeHeightField(const osg::HeightField& hf, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return writeToCache(HEIGHTFIELD, hf, originalFileName, options);
+}
+
+ReaderWriter::ReadResult FileCache::readNode(const std::string& originalFileName, const osgDB::Options* options, bool buildKdTreeIfRequired) const
+{
+    return readFromCache(NODE, originalFileName, options, buildKdTreeIfRequired);
+}
+
+ReaderWriter::WriteResult FileCache::writeNode(const osg::Node& node, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return writeToCache(NODE, node, originalFileName, options);
+}
+
+ReaderWriter::ReadResult FileCache::readShader(const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return readFromCache(SHADER, originalFileName, options);
+}
+
+ReaderWriter::WriteResult FileCache::writeShader(const osg::Shader& shader, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return writeToCache(SHADER, shader, originalFileName, options);
+}
+
+ReaderWriter::ReadResult FileCache::readFromCache(ObjectType type, const std::string& originalFileName, const osgDB::Options* options, bool buildKdTreeIfRequired) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
+    if (cacheFileName.empty()) return 0;
+
+    osg::ref_ptr<PendingWrite> pendingWrite;
     {
-        std::string path = osgDB::getFilePath(cacheFileName);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+        PendingWriteMap::const_iterator itr = _pendingWrites.find(cacheFileName);
+        if (itr!=_pendingWrites.end()) pendingWrite = itr->second;
+    }
 
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
+    if (pendingWrite.valid())
+    {
+        ReaderWriter* rw = Registry::instance()->getReaderWriterForExtension(getLowerCaseFileExtension(cacheFileName));
+        if (rw)
         {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+            OSG_INFO<<"FileCache::read"<<s_objectTypeNames[type]<<"FromCache("<<originalFileName<<") from the write queue"<<std::endl;
+
+            MemoryStreamBuffer buffer(pendingWrite->_data.data(), pendingWrite->_data.size());
+            std::istream in(&buffer);
+
+            osg::ref_ptr<osgDB::Options> local_opt = createStreamOptions(cacheFileName, options);
+
+            ReaderWriter::ReadResult result;
+            switch(type)
+            {
+                case(OBJECT): result = rw->readObject(in, local_opt.get()); break;
+                case(IMAGE): result = rw->readImage(in, local_opt.get()); break;
+                case(HEIGHTFIELD): result = rw->readHeightField(in, local_opt.get()); break;
+                case(NODE): result = rw->readNode(in, local_opt.get()); break;
+                case(SHADER): result = rw->readShader(in, local_opt.get()); break;
+            }
+
+            if (result.success())
+            {
+                if (buildKdTreeIfRequired) Registry::instance()->_buildKdTreeIfRequired(result, options);
+                return result;
+            }
         }
+    }
 
-        OSG_INFO<<"FileCache::writeImageToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeImage(image, cacheFileName, options);
-        if (result.success())
+    if (osgDB::fileExists(cacheFileName))
+    {
+        OSG_INFO<<"FileCache::read"<<s_objectTypeNames[type]<<"FromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+        switch(type)
         {
-            removeFileFromBlackListed(originalFileName);
+            case(OBJECT): return osgDB::Registry::instance()->readObject(cacheFileName, options);
+            case(IMAGE): return osgDB::Registry::instance()->readImage(cacheFileName, options);
+            case(HEIGHTFIELD): return osgDB::Registry::instance()->readHeightField(cacheFileName, options);
+            case(NODE): return osgDB::Registry::instance()->readNode(cacheFileName, options, buildKdTreeIfRequired);
+            case(SHADER): return osgDB::Registry::instance()->readShader(cacheFileName, options);
         }
-        return result;
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
+
+    return 0;
 }
 
-ReaderWriter::ReadResult FileCache::readHeightField(const std::string& originalFileName, const osgDB::Options* options) const
+ReaderWriter::WriteResult FileCache::writeToCache(ObjectType type, const osg::Object& object, const std::string& originalFileName, const osgDB::Options* options) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    if (cacheFileName.empty()) return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
+
+    // a WriteFileCallback expects to be handed the file, so leave those writes to the Registry
+    bool writeBehind = _writeBehind &&
+                       !(options && options->getWriteFileCallback()) &&
+                       !Registry::instance()->getWriteFileCallback();
+
+    if (writeBehind)
+    {
+        ReaderWriter* rw = Registry::instance()->getReaderWriterForExtension(getLowerCaseFileExtension(cacheFileName));
+        if (rw)
+        {
+            std::ostringstream out(std::ios::out | std::ios::binary);
+
+            osg::ref_ptr<osgDB::Options> local_opt = createStreamOptions(cacheFileName, options);
+
+            ReaderWriter::WriteResult result;
+            switch(type)
+            {
+                case(OBJECT): result = rw->writeObject(object, out, local_opt.get()); break;
+                case(IMAGE): result = rw->writeImage(static_cast<const osg::Image&>(object), out, local_opt.get()); break;
+                case(HEIGHTFIELD): result = rw->writeHeightField(static_cast<const osg::HeightField&>(object), out, local_opt.get()); break;
+                case(NODE): result = rw->writeNode(static_cast<const osg::Node&>(object), out, local_opt.get()); break;
+                case(SHADER): result = rw->writeShader(static_cast<const osg::Shader&>(object), out, local_opt.get()); break;
+            }
+
+            if (result.success())
+            {
+                osg::ref_ptr<PendingWrite> pendingWrite = new PendingWrite;
+                pendingWrite->_cacheFileName = cacheFileName;
+                pendingWrite->_originalFileName = originalFileName;
+                pendingWrite->_data = out.str();
+
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+
+                    // wait for room in the queue, the data of a queued write of the same file is replaced so doesn't count
+                    PendingWriteQueue::iterator queuedItr = findQueuedWrite(cacheFileName);
+                    while(_writeQueueSizeInBytes>0 &&
+                          _writeQueueSizeInBytes+pendingWrite->_data.size() >
+                          _maximumWriteQueueSizeInBytes+(queuedItr!=_writeQueue.end() ? (*queuedItr)->_data.size() : 0))
+                    {
+                        _writeCondition.wait(&_writeMutex);
+                        queuedItr = findQueuedWrite(cacheFileName);
+                    }
+
+                    OSG_INFO<<"FileCache::write"<<s_objectTypeNames[type]<<"ToCache("<<originalFileName<<") queued as "<<cacheFileName<<std::endl;
+
+                    if (queuedItr!=_writeQueue.end())
+                    {
+                        // the older data hasn't been written yet, so write the newer in its place
+                        _writeQueueSizeInBytes -= (*queuedItr)->_data.size();
+                        *queuedItr = pendingWrite;
+                        ++_statistics.numCoalescedWrites;
+                    }
+                    else
+                    {
+                        // an older version of the file may be being written, in which case this one follows it
+                        _writeQueue.push_back(pendingWrite);
+                        ++_statistics.numQueuedWrites;
+                    }
+
+                    _pendingWrites[cacheFileName] = pendingWrite;
+                    _writeQueueSizeInBytes += pendingWrite->_data.size();
+
+                    if (!_writeBehindThread)
+                    {
+                        _writeBehindThread = new WriteBehindThread(const_cast<FileCache*>(this));
+                        _writeBehindThread->startThread();
+                    }
+
+                    _writeCondition.broadcast();
+                }
+
+                removeFileFromBlackListed(originalFileName);
+                return ReaderWriter::WriteResult::FILE_SAVED;
+            }
+
+            OSG_INFO<<"FileCache : "<<rw->className()<<" can't write "<<cacheFileName<<" to a stream, writing it directly."<<std::endl;
+        }
+    }
+
+    std::string path = osgDB::getFilePath(cacheFileName);
+
+    if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
     {
-        OSG_INFO<<"FileCache::readHeightFieldFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readHeightField(cacheFileName, options);
+        OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
+        return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
     }
-    else
+
+    OSG_INFO<<"FileCache::write"<<s_objectTypeNames[type]<<"ToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+
+    // write to a temporary file and rename it into place so readers never see a partially written file
+    std::string temporaryFileName = createTemporaryFileName(cacheFileName);
+
+    ReaderWriter::WriteResult result;
+    switch(type)
     {
-        return 0;
+        case(OBJECT): result = osgDB::Registry::instance()->writeObject(object, temporaryFileName, options); break;
+        case(IMAGE): result = osgDB::Registry::instance()->writeImage(static_cast<const osg::Image&>(object), temporaryFileName, options); break;
+        case(HEIGHTFIELD): result = osgDB::Registry::instance()->writeHeightField(static_cast<const osg::HeightField&>(object), temporaryFileName, options); break;
+        case(NODE): result = osgDB::Registry::instance()->writeNode(static_cast<const osg::Node&>(object), temporaryFileName, options); break;
+        case(SHADER): result = osgDB::Registry::instance()->writeShader(static_cast<const osg::Shader&>(object), temporaryFileName, options); break;
     }
-}
 
-ReaderWriter::WriteResult FileCache::writeHeightField(const osg::HeightField& hf, const std::string& originalFileName, const osgDB::Options* options) const
-{
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
+    if (result.success() && !renameFile(temporaryFileName, cacheFileName))
     {
-        std::string path = osgDB::getFilePath(cacheFileName);
+        OSG_NOTICE<<"FileCache : could not rename "<<temporaryFileName<<" to "<<cacheFileName<<std::endl;
+        result = ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+    }
 
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
-        {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
-        }
+    if (!result.success()) ::remove(temporaryFileName.c_str());
 
-        OSG_INFO<<"FileCache::writeHeightFieldToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeHeightField(hf, cacheFileName, options);
-        if (result.success())
-        {
-            removeFileFromBlackListed(originalFileName);
-        }
-        return result;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+        if (result.success()) ++_statistics.numWrites;
+        else ++_statistics.numFailedWrites;
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
+
+    if (result.success())
+    {
+        addToCacheSize(cacheFileName);
+        removeFileFromBlackListed(originalFileName);
+    }
+    return result;
 }
 
-ReaderWriter::ReadResult FileCache::readNode(const std::string& originalFileName, const osgDB::Options* options, bool buildKdTreeIfRequired) const
+bool FileCache::writeCacheFile(const std::string& cacheFileName, const std::string& data) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    std::string path = osgDB::getFilePath(cacheFileName);
+
+    if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
     {
-        OSG_INFO<<"FileCache::readNodeFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readNode(cacheFileName, options, buildKdTreeIfRequired);
+        OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
+        return false;
     }
-    else
+
+    std::string temporaryFileName = createTemporaryFileName(cacheFileName);
     {
-        return 0;
+        osgDB::ofstream fout(temporaryFileName.c_str(), std::ios::out | std::ios::binary);
+        if (fout) fout.write(data.data(), data.size());
+        if (!fout)
+        {
+            OSG_NOTICE<<"FileCache : could not write "<<temporaryFileName<<std::endl;
+            fout.close();
+            ::remove(temporaryFileName.c_str());
+            return false;
+        }
+    }
+
+    if (!renameFile(temporaryFileName, cacheFileName))
+    {
+        OSG_NOTICE<<"FileCache : could not rename "<<temporaryFileName<<" to "<<cacheFileName<<std::endl;
+        ::remove(temporaryFileName.c_str());
+        return false;
     }
+
+    OSG_INFO<<"FileCache : written "<<cacheFileName<<std::endl;
+    return true;
 }
 
-ReaderWriter::WriteResult FileCache::writeNode(const osg::Node& node, const std::string& originalFileName, const osgDB::Options* options) const
+void FileCache::writePendingWrites()
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
+    for(;;)
     {
-        std::string path = osgDB::getFilePath(cacheFileName);
-
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
+        osg::ref_ptr<PendingWrite> pendingWrite;
         {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+            while(_writeQueue.empty() && !_done) _writeCondition.wait(&_writeMutex);
+
+            // the queue is drained before the thread exits
+            if (_writeQueue.empty()) return;
+
+            pendingWrite = _writeQueue.front();
+            _writeQueue.pop_front();
         }
 
-        OSG_INFO<<"FileCache::writeNodeToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeNode(node, cacheFileName, options);
-        if (result.success())
+        bool written = writeCacheFile(pendingWrite->_cacheFileName, pendingWrite->_data);
+        if (written) addToCacheSize(pendingWrite->_cacheFileName);
+
         {
-            removeFileFromBlackListed(originalFileName);
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+
+            // only removed once the file is in place so readers find it either in memory or on disk,
+            // and left if a newer version of the file has been queued meanwhile
+            PendingWriteMap::iterator pitr = _pendingWrites.find(pendingWrite->_cacheFileName);
+            if (pitr!=_pendingWrites.end() && pitr->second==pendingWrite) _pendingWrites.erase(pitr);
+            _writeQueueSizeInBytes -= pendingWrite->_data.size();
+
+            if (written) ++_statistics.numWrites;
+            else ++_statistics.numFailedWrites;
+
+            _writeCondition.broadcast();
         }
-        return result;
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
 }
 
+FileCache::PendingWriteQueue::iterator FileCache::findQueuedWrite(const std::string& cacheFileName) const
+{
+    PendingWriteMap::const_iterator pitr = _pendingWrites.find(cacheFileName);
+    if (pitr==_pendingWrites.end()) return _writeQueue.end();
 
-ReaderWriter::ReadResult FileCache::readShader(const std::string& originalFileName, const osgDB::Options* options) const
+    // a pending write that isn't queued is being written
+    return std::find(_writeQueue.begin(), _writeQueue.end(), pitr->second);
+}
+
+void FileCache::setWriteBehind(bool flag)
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+    _writeBehind = flag;
+}
+
+void FileCache::setMaximumWriteQueueSizeInBytes(uint64_t size)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+    _maximumWriteQueueSizeInBytes = size;
+    _writeCondition.broadcast();
+}
+
+void FileCache::flush()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+    while(!_pendingWrites.empty()) _writeCondition.wait(&_writeMutex);
+}
+
+unsigned int FileCache::getNumPendingWrites() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+    return static_cast<unsigned int>(_pendingWrites.size());
+}
+
+FileCache::Statistics FileCache::getStatistics() const
+{
+    Statistics statistics;
     {
-        OSG_INFO<<"FileCache::readShaderFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readShader(cacheFileName, options);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_writeMutex);
+        statistics = _statistics;
     }
-    else
     {
-        return 0;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sizeMutex);
+        statistics.numEvictions = _statistics.numEvictions;
+        statistics.sizeInBytes = _statistics.sizeInBytes;
     }
+    return statistics;
 }
 
-ReaderWriter::WriteResult FileCache::writeShader(const osg::Shader& shader, const std::string& originalFileName, const osgDB::Options* options) const
+void FileCache::setMaximumSizeInBytes(uint64_t size)
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sizeMutex);
+    _maximumSizeInBytes = size;
+    if (_maximumSizeInBytes==0)
     {
-        std::string path = osgDB::getFilePath(cacheFileName);
+        // stop tracking, the directory is scanned again if the cache is bounded later on
+        _cacheScanned = false;
+        _cachedFiles.clear();
+        _cachedFileQueue.clear();
+        _statistics.sizeInBytes = 0;
+    }
+}
 
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
-        {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
-        }
+void FileCache::addToCacheSize(const std::string& cacheFileName) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sizeMutex);
+    if (_maximumSizeInBytes==0) return;
+
+    if (!_cacheScanned)
+    {
+        _cacheScanned = true;
+
+        CachedFileTimeList files;
+        collectCachedFiles(_fileCachePath, files);
+        std::sort(files.begin(), files.end());
 
-        OSG_INFO<<"FileCache::writeShaderToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeShader(shader, cacheFileName, options);
-        if (result.success())
+        OSG_INFO<<"FileCache : found "<<files.size()<<" files in "<<_fileCachePath<<std::endl;
+
+        for(CachedFileTimeList::iterator itr = files.begin(); itr != files.end(); ++itr)
         {
-            removeFileFromBlackListed(originalFileName);
+            CachedFile& cachedFile = _cachedFiles[itr->second.first];
+            cachedFile._sizeInBytes = itr->second.second;
+            cachedFile._sequence = ++_sequence;
+            _cachedFileQueue.push_back(std::make_pair(itr->second.first, cachedFile._sequence));
+            _statistics.sizeInBytes += cachedFile._sizeInBytes;
         }
-        return result;
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
-}
 
+    // a rewrite of a file replaces its size and moves it to the back of the queue
+    CachedFile& cachedFile = _cachedFiles[cacheFileName];
+    _statistics.sizeInBytes -= cachedFile._sizeInBytes;
+    cachedFile._sizeInBytes = getCachedFileSize(cacheFileName);
+    cachedFile._sequence = ++_sequence;
+    _cachedFileQueue.push_back(std::make_pair(cacheFileName, cachedFile._sequence));
+    _statistics.sizeInBytes += cachedFile._sizeInBytes;
+
+    // remove the oldest files, but never the one just written
+    while(_statistics.sizeInBytes>_maximumSizeInBytes && _cachedFileQueue.size()>1)
+    {
+        std::pair<std::string, unsigned int> oldest = _cachedFileQueue.front();
+        _cachedFileQueue.pop_front();
+
+        CachedFileMap::iterator itr = _cachedFiles.find(oldest.first);
+        if (itr==_cachedFiles.end() || itr->second._sequence!=oldest.second) continue;
+
+        OSG_INFO<<"FileCache : removing "<<oldest.first<<" to keep the cache within "<<_maximumSizeInBytes<<" bytes"<<std::endl;
+
+        ::remove(oldest.first.c_str());
+        _statistics.sizeInBytes -= itr->second._sizeInBytes;
+        ++_statistics.numEvictions;
+        _cachedFiles.erase(itr);
+    }
+}
 
 bool FileCache::isCachedFileBlackListed(const std::string& originalFileName) const
 {
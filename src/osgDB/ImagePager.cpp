@@ -16,19 +16,27 @@
 
 #include <osg/Notify>
 #include <osg/ImageSequence>
+#include <osg/ApplicationUsage>
+
+#include <stdlib.h>
+#include <sstream>
 
 using namespace osgDB;
 
+static osg::ApplicationUsageProxy ImagePager_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_IMAGE_THREADS <num>","Set the number of threads the ImagePager reads images with.");
+static osg::ApplicationUsageProxy ImagePager_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_IMAGE_PAGER_PRELOAD_FRAMES <num>","Set the number of frames of an ImageSequence requested ahead of the one shown.");
+
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  SortFileRequestFunctor
 //
+// sorts the latest required first, so the next request to read is taken from the back of the list
 struct ImagePager::SortFileRequestFunctor
 {
     bool operator() (const osg::ref_ptr<ImagePager::ImageRequest>& lhs,const osg::ref_ptr<ImagePager::ImageRequest>& rhs) const
     {
-        return (lhs->_timeToMergeBy < rhs->_timeToMergeBy);
+        return (lhs->_timeToMergeBy > rhs->_timeToMergeBy);
     }
 };
 
@@ -39,7 +47,10 @@ struct ImagePager::SortFileRequestFunctor
 //
 void ImagePager::RequestQueue::sort()
 {
+    if (_requestListSorted) return;
+
     std::sort(_requestList.begin(),_requestList.end(),SortFileRequestFunctor());
+    _requestListSorted = true;
 }
 
 unsigned int ImagePager::RequestQueue::size() const
@@ -83,6 +94,7 @@ void ImagePager::ReadQueue::add(ImagePager::ImageRequest* imageRequest)
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
     _requestList.push_back(imageRequest);
+    _requestListSorted = false;
     imageRequest->_requestQueue = this;
 
     OSG_INFO<<"ImagePager::ReadQueue::add("<<imageRequest->_fileName<<"), size()="<<_requestList.size()<<std::endl;
@@ -90,22 +102,84 @@ void ImagePager::ReadQueue::add(ImagePager::ImageRequest* imageRequest)
     updateBlock();
 }
 
-void ImagePager::ReadQueue::takeFirst(osg::ref_ptr<ImageRequest>& databaseRequest)
+bool ImagePager::ReadQueue::renew(ImageRequest* imageRequest, double timeToMergeBy, unsigned int frameNumber)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
-    if (!_requestList.empty())
+    if (imageRequest->_requestQueue!=this) return false;
+
+    imageRequest->_frameNumberLastRequest = frameNumber;
+    if (imageRequest->_timeToMergeBy!=timeToMergeBy)
     {
+        imageRequest->_timeToMergeBy = timeToMergeBy;
+        _requestListSorted = false;
+    }
+    return true;
+}
+
+void ImagePager::ReadQueue::takeFirst(osg::ref_ptr<ImageRequest>& databaseRequest)
+{
+    unsigned int numCancelled = 0;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
         sort();
 
-        OSG_INFO<<"ImagePager::ReadQueue::takeFirst(..), size()="<<_requestList.size()<<std::endl;
+        unsigned int frameNumber = _pager->_frameNumber;
+        bool checkTimes = _pager->_cancelLateRequests && _pager->_simulationTimeValid;
+        double latestUsefulTime = _pager->getCurrentSimulationTime();
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> statsLock(_pager->_statisticsMutex);
+            latestUsefulTime += _pager->_statistics.averageReadTime;
+        }
+
+        // Walk from the request required soonest. Requests that can't be read by their time are dropped if they
+        // weren't renewed in the last frame, and otherwise passed over for the first that can still make its time.
+        // Only when none can is the soonest read, such as the image of a paused ImageSequence.
+        int selected = -1;
+        for(int i=static_cast<int>(_requestList.size())-1; i>=0; --i)
+        {
+            ImageRequest* imageRequest = _requestList[i].get();
+
+            bool inTime = !checkTimes || imageRequest->_timeToMergeBy>=latestUsefulTime;
+            bool renewed = imageRequest->_frameNumberLastRequest+1>=frameNumber;
+
+            if (!imageRequest->_attachmentPoint.valid() || (!inTime && !renewed))
+            {
+                OSG_INFO<<"ImagePager::ReadQueue::takeFirst(..) cancelled "<<imageRequest->_fileName<<std::endl;
 
-        databaseRequest = _requestList.front();
-        databaseRequest->_requestQueue = 0;
-        _requestList.erase(_requestList.begin());
+                imageRequest->_requestQueue = 0;
+                _requestList.erase(_requestList.begin()+i);
+                if (selected>i) --selected;
+                ++numCancelled;
+                continue;
+            }
+
+            if (selected<0) selected = i;
+            if (inTime)
+            {
+                selected = i;
+                break;
+            }
+        }
+
+        if (selected>=0)
+        {
+            OSG_INFO<<"ImagePager::ReadQueue::takeFirst(..), size()="<<_requestList.size()<<std::endl;
+
+            databaseRequest = _requestList[selected];
+            databaseRequest->_requestQueue = 0;
+            _requestList.erase(_requestList.begin()+selected);
+        }
 
         updateBlock();
     }
+
+    if (numCancelled>0)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_pager->_statisticsMutex);
+        _pager->_statistics.numCancelled += numCancelled;
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -171,7 +245,7 @@ void ImagePager::signalBeginFrame(const osg::FrameStamp* framestamp)
     if (framestamp)
     {
         //OSG_INFO << "signalBeginFrame "<<framestamp->getFrameNumber()<<">>>>>>>>>>>>>>>>"<<std::endl;
-        _frameNumber.exchange(framestamp->getFrameNumber());
+        updateFrame(framestamp);
 
     } //else OSG_INFO << "signalBeginFrame >>>>>>>>>>>>>>>>"<<std::endl;
 }
@@ -211,7 +285,10 @@ void ImagePager::ImageThread::run()
         if (imageRequest.valid())
         {
             // OSG_NOTICE<<"doing readImageFile("<<imageRequest->_fileName<<") index to assign = "<<imageRequest->_attachmentIndex<<std::endl;
+            osg::Timer_t readStart = osg::Timer::instance()->tick();
             osg::ref_ptr<osg::Image> image = osgDB::readRefImageFile(imageRequest->_fileName, imageRequest->_readOptions.get());
+            _pager->recordCompletion(imageRequest.get(), image.valid(), osg::Timer::instance()->delta_s(readStart, osg::Timer::instance()->tick()));
+
             if (image.valid())
             {
                 // OSG_NOTICE<<"   successful readImageFile("<<imageRequest->_fileName<<") index to assign = "<<imageRequest->_attachmentIndex<<std::endl;
@@ -265,25 +342,129 @@ void ImagePager::ImageThread::run()
 // ImagePager
 //
 ImagePager::ImagePager():
-    _done(false)
+    _done(false),
+    _preLoadFrames(0),
+    _cancelLateRequests(true),
+    _simulationTime(0.0),
+    _simulationTimeTick(0),
+    _simulationTimeValid(false),
+    _totalLatency(0.0),
+    _totalReadTime(0.0)
 {
     _startThreadCalled = false;
     _databasePagerThreadPaused = false;
 
     _readQueue = new ReadQueue(this,"Image Queue");
     _completedQueue = new RequestQueue;
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 1"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 2"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 3"));
-#if 0
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 4"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 5"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 6"));
-#endif
+
+    unsigned int numThreads = 3;
+    const char* ptr = 0;
+    if ((ptr = getenv("OSG_NUM_IMAGE_THREADS")) != 0)
+    {
+        numThreads = osg::maximum(atoi(ptr), 1);
+    }
+    setUpThreads(numThreads);
+
+    if ((ptr = getenv("OSG_IMAGE_PAGER_PRELOAD_FRAMES")) != 0)
+    {
+        _preLoadFrames = osg::maximum(atoi(ptr), 0);
+    }
+
     // 1 second
     _preLoadTime = 1.0;
 }
 
+void ImagePager::setUpThreads(unsigned int totalNumThreads)
+{
+    // replace running threads with the new set, the queued requests stay in the read queue
+    bool restart = _startThreadCalled;
+    if (restart) cancel();
+
+    _imageThreads.clear();
+    for(unsigned int i=0; i<osg::maximum(totalNumThreads, 1u); ++i)
+    {
+        std::ostringstream name;
+        name<<"Image Thread "<<i+1;
+        _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, name.str()));
+    }
+
+    if (restart) startThreads();
+}
+
+void ImagePager::startThreads()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_run_mutex);
+
+    if (!_startThreadCalled)
+    {
+        _startThreadCalled = true;
+        _done = false;
+
+        for(ImageThreads::iterator itr = _imageThreads.begin();
+            itr != _imageThreads.end();
+            ++itr)
+        {
+            (*itr)->startThread();
+        }
+    }
+}
+
+void ImagePager::updateFrame(const osg::FrameStamp* framestamp)
+{
+    if (!framestamp) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_frameMutex);
+    if (!_simulationTimeValid || framestamp->getFrameNumber()>_frameNumber)
+    {
+        _frameNumber.exchange(framestamp->getFrameNumber());
+        _simulationTime = framestamp->getSimulationTime();
+        _simulationTimeTick = osg::Timer::instance()->tick();
+        _simulationTimeValid = true;
+    }
+}
+
+double ImagePager::getCurrentSimulationTime() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_frameMutex);
+    return _simulationTime + osg::Timer::instance()->delta_s(_simulationTimeTick, osg::Timer::instance()->tick());
+}
+
+void ImagePager::recordCompletion(const ImageRequest* imageRequest, bool success, double readTime)
+{
+    double latency = osg::Timer::instance()->delta_s(imageRequest->_requestTick, osg::Timer::instance()->tick());
+    bool late = _simulationTimeValid && getCurrentSimulationTime()>imageRequest->_timeToMergeBy;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+    if (!success)
+    {
+        ++_statistics.numFailed;
+        return;
+    }
+
+    ++_statistics.numCompleted;
+    if (late) ++_statistics.numLate;
+
+    _totalLatency += latency;
+    _totalReadTime += readTime;
+    _statistics.maximumLatency = osg::maximum(_statistics.maximumLatency, latency);
+    _statistics.averageLatency = _totalLatency/double(_statistics.numCompleted);
+    _statistics.averageReadTime = _totalReadTime/double(_statistics.numCompleted);
+}
+
+ImagePager::Statistics ImagePager::getStatistics() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+    return _statistics;
+}
+
+void ImagePager::resetStatistics()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+    _statistics = Statistics();
+    _totalLatency = 0.0;
+    _totalReadTime = 0.0;
+}
+
 ImagePager::~ImagePager()
 {
     cancel();
@@ -323,23 +504,32 @@ osg::ref_ptr<osg::Image> ImagePager::readRefImageFile(const std::string& fileNam
     return osgDB::readRefImageFile(fileName, readOptions);
 }
 
-void ImagePager::requestImageFile(const std::string& fileName, osg::Object* attachmentPoint, int attachmentIndex, double timeToMergeBy, const osg::FrameStamp* /*framestamp*/, osg::ref_ptr<osg::Referenced>& imageRequest, const osg::Referenced* options)
+void ImagePager::requestImageFile(const std::string& fileName, osg::Object* attachmentPoint, int attachmentIndex, double timeToMergeBy, const osg::FrameStamp* framestamp, osg::ref_ptr<osg::Referenced>& imageRequest, const osg::Referenced* options)
 {
+    updateFrame(framestamp);
+
     osgDB::Options* readOptions = dynamic_cast<osgDB::Options*>(const_cast<osg::Referenced*>(options));
     if (!readOptions)
     {
        readOptions = Registry::instance()->getOptions();
     }
 
-    bool alreadyAssigned = dynamic_cast<ImageRequest*>(imageRequest.get()) && (imageRequest->referenceCount()>1);
+    ImageRequest* existingRequest = dynamic_cast<ImageRequest*>(imageRequest.get());
+    bool alreadyAssigned = existingRequest && (imageRequest->referenceCount()>1);
     if (alreadyAssigned)
     {
         // OSG_NOTICE<<"ImagePager::requestImageFile("<<fileName<<") alreadyAssigned"<<std::endl;
+
+        // still queued, or being read, keep it up to date with when it's required
+        _readQueue->renew(existingRequest, timeToMergeBy, _frameNumber);
         return;
     }
 
     osg::ref_ptr<ImageRequest> request = new ImageRequest;
     request->_timeToMergeBy = timeToMergeBy;
+    request->_frameNumber = _frameNumber;
+    request->_frameNumberLastRequest = _frameNumber;
+    request->_requestTick = osg::Timer::instance()->tick();
     request->_fileName = fileName;
     request->_attachmentPoint = attachmentPoint;
     request->_attachmentIndex = attachmentIndex;
@@ -350,26 +540,14 @@ void ImagePager::requestImageFile(const std::string& fileName, osg::Object* atta
 
     // OSG_NOTICE<<"ImagePager::requestImageFile("<<fileName<<") new request."<<std::endl;
 
-    _readQueue->add(request.get());
-
-    if (!_startThreadCalled)
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_run_mutex);
-
-        if (!_startThreadCalled)
-        {
-            _startThreadCalled = true;
-            _done = false;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+        ++_statistics.numRequests;
+    }
 
-            for(ImageThreads::iterator itr = _imageThreads.begin();
-                itr != _imageThreads.end();
-                ++itr)
-            {
-                (*itr)->startThread();
-            }
+    _readQueue->add(request.get());
 
-        }
-    }
+    if (!_startThreadCalled) startThreads();
 }
 
 bool ImagePager::requiresUpdateSceneGraph() const
@@ -378,8 +556,10 @@ bool ImagePager::requiresUpdateSceneGraph() const
     return !(_completedQueue->_requestList.empty());
 }
 
-void ImagePager::updateSceneGraph(const osg::FrameStamp&)
+void ImagePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
 {
+    updateFrame(&frameStamp);
+
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_completedQueue->_requestMutex);
 
     for(RequestQueue::RequestList::iterator itr = _completedQueue->_requestList.begin();
@@ -1033,7 +1033,6 @@ void InputStream::decompress()
     std::string compressorName; *this >> compressorName;
     if ( compressorName!="0" )
     {
-        std::string data;
         _fields.push_back( "Decompression" );
 
         BaseCompressor* compressor = Registry::instance()->getObjectWrapperManager()->findCompressor(compressorName);
@@ -1043,11 +1042,23 @@ void InputStream::decompress()
             return;
         }
 
-        if ( !compressor->decompress(*(_in->getStream()), data) )
-            throwException( "InputStream: Failed to decompress stream." );
+        // prefer decompressing while reading, only fall back to decompressing everything up front
+        _dataDecompress = compressor->createDecompressionStream(*(_in->getStream()));
+        if ( _dataDecompress )
+        {
+            if ( !_dataDecompress->good() )
+                throwException( "InputStream: Failed to decompress stream." );
+        }
+        else
+        {
+            std::string data;
+            if ( !compressor->decompress(*(_in->getStream()), data) )
+                throwException( "InputStream: Failed to decompress stream." );
+            else
+                _dataDecompress = new std::stringstream(data);
+        }
         if ( getException() ) return;
 
-        _dataDecompress = new std::stringstream(data);
         _in->setStream( _dataDecompress );
         _fields.pop_back();
     }
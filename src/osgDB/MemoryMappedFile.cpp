@@ -0,0 +1,190 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2008 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/MemoryMappedFile>
+#include <osgDB/ConvertUTF>
+
+#include <osg/Config>
+#include <osg/Notify>
+#include <osg/ApplicationUsage>
+#include <osg/Math>
+
+#include <stdlib.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace osgDB;
+
+static osg::ApplicationUsageProxy MemoryMappedFile_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MEMORY_MAPPED_FILES <ON/OFF>","Set whether plugins may read files through memory mappings instead of file streams.");
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MemoryMappedFile
+//
+bool MemoryMappedFile::isDisabled()
+{
+    static bool s_disabled = false;
+    static bool s_initialized = false;
+    if (!s_initialized)
+    {
+        const char* str = getenv("OSG_MEMORY_MAPPED_FILES");
+        s_disabled = str && (strcmp(str,"off")==0 || strcmp(str,"OFF")==0 || strcmp(str,"no")==0 || strcmp(str,"NO")==0);
+        s_initialized = true;
+    }
+    return s_disabled;
+}
+
+MemoryMappedFile::MemoryMappedFile(const std::string& fileName, const char* data, size_t size, void* handle):
+    osg::Referenced(true),
+    _fileName(fileName),
+    _data(data),
+    _size(size),
+    _handle(handle)
+{
+}
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+
+MemoryMappedFile* MemoryMappedFile::open(const std::string& fileName)
+{
+#ifdef OSG_USE_UTF8_FILENAME
+    HANDLE file = CreateFileW(convertUTF8toUTF16(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#endif
+    if (file==INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart==0 || static_cast<unsigned long long>(size.QuadPart)>static_cast<size_t>(-1))
+    {
+        CloseHandle(file);
+        return 0;
+    }
+
+    // the mapping keeps the file open, so the handle isn't needed past this point
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return 0;
+
+    const char* data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return 0;
+    }
+
+    return new MemoryMappedFile(fileName, data, static_cast<size_t>(size.QuadPart), mapping);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    UnmapViewOfFile(_data);
+    CloseHandle(static_cast<HANDLE>(_handle));
+}
+
+#else
+
+MemoryMappedFile* MemoryMappedFile::open(const std::string& fileName)
+{
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd<0) return 0;
+
+    struct stat status;
+    if (fstat(fd, &status)!=0 || !S_ISREG(status.st_mode) || status.st_size==0)
+    {
+        ::close(fd);
+        return 0;
+    }
+
+    void* data = mmap(0, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data==MAP_FAILED)
+    {
+        OSG_INFO<<"MemoryMappedFile::open("<<fileName<<") mmap failed."<<std::endl;
+        return 0;
+    }
+
+    return new MemoryMappedFile(fileName, static_cast<const char*>(data), static_cast<size_t>(status.st_size), 0);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    munmap(const_cast<char*>(_data), _size);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MemoryStreamBuffer
+//
+MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_t size):
+    _begin(const_cast<char*>(data)),
+    _end(const_cast<char*>(data)+size)
+{
+    // the get area is never written to, std::streambuf just doesn't have a const one
+    setg(_begin, _begin, _end);
+}
+
+std::streamsize MemoryStreamBuffer::xsgetn(char* s, std::streamsize n)
+{
+    size_t size = osg::minimum(static_cast<size_t>(n), remaining());
+    read(s, size);
+    return static_cast<std::streamsize>(size);
+}
+
+std::streamsize MemoryStreamBuffer::showmanyc()
+{
+    return remaining()>0 ? static_cast<std::streamsize>(remaining()) : -1;
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which)
+{
+    if ((which & std::ios_base::in)==0) return pos_type(off_type(-1));
+
+    char* base = way==std::ios_base::beg ? _begin : (way==std::ios_base::end ? _end : gptr());
+    if (off < _begin-base || off > _end-base) return pos_type(off_type(-1));
+
+    setg(_begin, base+off, _end);
+    return pos_type(off_type(gptr()-_begin));
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// imappedstream
+//
+imappedstream::imappedstream(MemoryMappedFile* file):
+    std::istream(0),
+    _file(file),
+    _buffer(file->data(), file->size())
+{
+    rdbuf(&_buffer);
+}
+
+imappedstream::~imappedstream()
+{
+}
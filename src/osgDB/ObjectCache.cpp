@@ -14,189 +14,519 @@
 #include <osgDB/ObjectCache>
 #include <osgDB/Options>
 
+#include <osg/Geometry>
+#include <osg/Texture>
+
+#include <set>
+
 using namespace osgDB;
 
-bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair& lhs, const ObjectCache::FileNameOptionsPair& rhs) const
+namespace
+{
+
+// sums the data of the geometries, primitive sets and texture images below a node, counting shared data once
+class EstimateSizeVisitor : public osg::NodeVisitor
 {
-    // check if filename are the same
-    if (lhs.first < rhs.first) return true;
-    if (rhs.first < lhs.first) return false;
+public:
+    EstimateSizeVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _sizeInBytes(0) {}
+
+    virtual void apply(osg::Node& node)
+    {
+        if (node.getStateSet()) apply(*node.getStateSet());
+        traverse(node);
+    }
+
+    virtual void apply(osg::Drawable& drawable)
+    {
+        if (drawable.getStateSet()) apply(*drawable.getStateSet());
+
+        osg::Geometry* geometry = drawable.asGeometry();
+        if (!geometry) return;
+
+        osg::Geometry::ArrayList arrays;
+        geometry->getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+            itr != arrays.end();
+            ++itr)
+        {
+            add(itr->get());
+        }
 
-    // check if Options pointers are the same.
-    if (lhs.second == rhs.second) return false;
+        for(unsigned int i=0; i<geometry->getNumPrimitiveSets(); ++i)
+        {
+            add(geometry->getPrimitiveSet(i)->getDrawElements());
+        }
+    }
 
-    // need to compare Options pointers
-    if (lhs.second.valid() && rhs.second.valid())
+    void apply(osg::StateSet& stateSet)
     {
-        // lhs & rhs have valid Options objects
-        return *lhs.second < *rhs.second;
+        for(unsigned int unit=0; unit<stateSet.getNumTextureAttributeLists(); ++unit)
+        {
+            const osg::Texture* texture = dynamic_cast<const osg::Texture*>(stateSet.getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+            if (!texture) continue;
+
+            for(unsigned int i=0; i<texture->getNumImages(); ++i)
+            {
+                add(texture->getImage(i));
+            }
+        }
     }
 
-    // finally use pointer comparison, expecting at least one will be NULL pointer
-    return lhs.second < rhs.second;
+    void add(const osg::BufferData* data)
+    {
+        if (data && _counted.insert(data).second) _sizeInBytes += data->getTotalDataSize();
+    }
+
+    uint64_t                        _sizeInBytes;
+    std::set<const osg::BufferData*> _counted;
+};
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // ObjectCache
 //
+ObjectCache::Shard::Shard():
+    _numEntries(0),
+    _sizeInBytes(0),
+    _numHits(0),
+    _numMisses(0),
+    _numInsertions(0),
+    _numEvictions(0),
+    _numExpired(0)
+{
+    _lruHead._lruPrev = &_lruHead;
+    _lruHead._lruNext = &_lruHead;
+}
+
 ObjectCache::ObjectCache():
     osg::Referenced(true)
 {
-//    OSG_NOTICE<<"Constructed ObjectCache"<<std::endl;
+    init(16);
+}
+
+ObjectCache::ObjectCache(unsigned int numShards):
+    osg::Referenced(true)
+{
+    init(numShards);
+}
+
+void ObjectCache::init(unsigned int numShards)
+{
+    _evictionPolicy = LRU;
+    _maximumSizeInBytes = 0;
+
+    numShards = osg::maximum(numShards, 1u);
+    for(unsigned int i=0; i<numShards; ++i)
+    {
+        _shards.push_back(new Shard);
+    }
 }
 
 ObjectCache::~ObjectCache()
 {
-//    OSG_NOTICE<<"Destructed ObjectCache"<<std::endl;
+    for(std::vector<Shard*>::iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
+    {
+        clearNoLock(**itr);
+        delete *itr;
+    }
 }
 
-void ObjectCache::addObjectCache(ObjectCache* objectCache)
+unsigned int ObjectCache::hash(const std::string& fileName)
 {
-    // don't allow a cache to be added to itself.
-    if (objectCache==this) return;
+    // FNV-1a
+    unsigned int h = 2166136261u;
+    for(std::string::const_iterator itr = fileName.begin(); itr != fileName.end(); ++itr)
+    {
+        h = (h ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return h;
+}
 
-    // lock both ObjectCache to prevent their contents from being modified by other threads while we merge.
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(_objectCacheMutex);
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(objectCache->_objectCacheMutex);
+ObjectCache::Entry* ObjectCache::findNoLock(Shard& shard, unsigned int h, const std::string& fileName, const osgDB::Options* options)
+{
+    if (shard._buckets.empty()) return 0;
 
-    OSG_DEBUG<<"Inserting objects to main ObjectCache "<<objectCache->_objectCache.size()<<std::endl;
+    for(Entry* entry = shard._buckets[(h / _shards.size()) % shard._buckets.size()]; entry; entry = entry->_hashNext)
+    {
+        if (entry->_hash!=h || entry->_fileName!=fileName) continue;
 
-    _objectCache.insert(objectCache->_objectCache.begin(), objectCache->_objectCache.end());
+        if (entry->_options.valid())
+        {
+            if (options && *(entry->_options)==*options) return entry;
+        }
+        else if (!options) return entry;
+    }
+    return 0;
 }
 
+void ObjectCache::insertNoLock(Shard& shard, Entry* entry)
+{
+    // keep the chains short, the low bits of the hash select the shard so the bucket uses the rest
+    if (shard._numEntries >= shard._buckets.size())
+    {
+        std::vector<Entry*> buckets(osg::maximum<size_t>(shard._buckets.size()*2, 16), static_cast<Entry*>(0));
+        for(std::vector<Entry*>::iterator itr = shard._buckets.begin(); itr != shard._buckets.end(); ++itr)
+        {
+            for(Entry* e = *itr; e; )
+            {
+                Entry* next = e->_hashNext;
+                Entry*& head = buckets[(e->_hash / _shards.size()) % buckets.size()];
+                e->_hashNext = head;
+                head = e;
+                e = next;
+            }
+        }
+        shard._buckets.swap(buckets);
+    }
+
+    Entry*& head = shard._buckets[(entry->_hash / _shards.size()) % shard._buckets.size()];
+    entry->_hashNext = head;
+    head = entry;
 
-void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
+    entry->_lruPrev = &shard._lruHead;
+    entry->_lruNext = shard._lruHead._lruNext;
+    entry->_lruNext->_lruPrev = entry;
+    shard._lruHead._lruNext = entry;
+
+    ++shard._numEntries;
+    shard._sizeInBytes += entry->_sizeInBytes;
+}
+
+void ObjectCache::removeNoLock(Shard& shard, Entry* entry)
 {
-    if (!object) return;
+    for(Entry** link = &shard._buckets[(entry->_hash / _shards.size()) % shard._buckets.size()]; *link; link = &((*link)->_hashNext))
+    {
+        if (*link==entry)
+        {
+            *link = entry->_hashNext;
+            break;
+        }
+    }
 
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[FileNameOptionsPair(filename, options ? osg::clone(options) : 0)] = ObjectTimeStampPair(object,timestamp);
-    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+    entry->_lruPrev->_lruNext = entry->_lruNext;
+    entry->_lruNext->_lruPrev = entry->_lruPrev;
+
+    --shard._numEntries;
+    shard._sizeInBytes -= entry->_sizeInBytes;
+
+    delete entry;
 }
 
-ObjectCache::ObjectCacheMap::iterator ObjectCache::find(const std::string& fileName, const osgDB::Options* options)
+void ObjectCache::touchNoLock(Shard& shard, Entry* entry)
 {
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    if (shard._lruHead._lruNext==entry) return;
+
+    entry->_lruPrev->_lruNext = entry->_lruNext;
+    entry->_lruNext->_lruPrev = entry->_lruPrev;
+
+    entry->_lruPrev = &shard._lruHead;
+    entry->_lruNext = shard._lruHead._lruNext;
+    entry->_lruNext->_lruPrev = entry;
+    shard._lruHead._lruNext = entry;
+}
+
+void ObjectCache::evictNoLock(Shard& shard)
+{
+    if (_maximumSizeInBytes==0) return;
+
+    uint64_t shardBudget = _maximumSizeInBytes / _shards.size();
+
+    // walk from the least recently used end, skipping objects still in use elsewhere
+    Entry* cursor = shard._lruHead._lruPrev;
+    while(shard._sizeInBytes > shardBudget && cursor!=&shard._lruHead)
     {
-        if (itr->first.first==fileName)
+        if (cursor->_object->referenceCount()>1)
+        {
+            cursor = cursor->_lruPrev;
+            continue;
+        }
+
+        Entry* victim = cursor;
+        if (_evictionPolicy==COST_AWARE_LRU)
         {
-            if (itr->first.second.valid())
+            unsigned int numCandidates = 7;
+            for(Entry* candidate = cursor->_lruPrev; candidate!=&shard._lruHead && numCandidates>0; candidate = candidate->_lruPrev)
             {
-                if (options && *(itr->first.second)==*options) return itr;
+                if (candidate->_object->referenceCount()>1) continue;
+
+                if (candidate->_sizeInBytes > victim->_sizeInBytes) victim = candidate;
+                --numCandidates;
             }
-            else if (!options) return itr;
         }
+
+        if (victim==cursor) cursor = cursor->_lruPrev;
+
+        OSG_DEBUG<<"Evicting "<<victim->_fileName<<" ("<<victim->_sizeInBytes<<" bytes) from ObjectCache "<<this<<std::endl;
+
+        removeNoLock(shard, victim);
+        ++shard._numEvictions;
     }
-    return _objectCache.end();
 }
 
+void ObjectCache::clearNoLock(Shard& shard)
+{
+    for(Entry* entry = shard._lruHead._lruNext; entry!=&shard._lruHead; )
+    {
+        Entry* next = entry->_lruNext;
+        delete entry;
+        entry = next;
+    }
 
-osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+    shard._lruHead._lruPrev = &shard._lruHead;
+    shard._lruHead._lruNext = &shard._lruHead;
+    shard._buckets.clear();
+    shard._numEntries = 0;
+    shard._sizeInBytes = 0;
+}
+
+void ObjectCache::setMaximumSizeInBytes(uint64_t size)
+{
+    _maximumSizeInBytes = size;
+
+    for(std::vector<Shard*>::iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->_mutex);
+        evictNoLock(**itr);
+    }
+}
+
+ObjectCache::Statistics ObjectCache::getStatistics() const
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    Statistics statistics;
+    for(std::vector<Shard*>::const_iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
     {
-        osg::ref_ptr<const osgDB::Options> o = itr->first.second;
-        if (o.valid())
+        Shard& shard = **itr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        statistics.numObjects += shard._numEntries;
+        statistics.sizeInBytes += shard._sizeInBytes;
+        statistics.numHits += shard._numHits;
+        statistics.numMisses += shard._numMisses;
+        statistics.numInsertions += shard._numInsertions;
+        statistics.numEvictions += shard._numEvictions;
+        statistics.numExpired += shard._numExpired;
+    }
+    return statistics;
+}
+
+void ObjectCache::resetStatistics()
+{
+    for(std::vector<Shard*>::iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
+    {
+        Shard& shard = **itr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        shard._numHits = 0;
+        shard._numMisses = 0;
+        shard._numInsertions = 0;
+        shard._numEvictions = 0;
+        shard._numExpired = 0;
+    }
+}
+
+uint64_t ObjectCache::estimateSizeInBytes(const osg::Object* object) const
+{
+    const osg::BufferData* bufferData = dynamic_cast<const osg::BufferData*>(object);
+    if (bufferData) return bufferData->getTotalDataSize();
+
+    const osg::Node* node = dynamic_cast<const osg::Node*>(object);
+    if (node)
+    {
+        EstimateSizeVisitor esv;
+        const_cast<osg::Node*>(node)->accept(esv);
+        return esv._sizeInBytes;
+    }
+
+    return 0;
+}
+
+void ObjectCache::addObjectCache(ObjectCache* objectCache)
+{
+    // don't allow a cache to be added to itself.
+    if (objectCache==this) return;
+
+    // copy the entries out shard by shard, so that no two cache locks are held at once.
+    for(std::vector<Shard*>::iterator itr = objectCache->_shards.begin();
+        itr != objectCache->_shards.end();
+        ++itr)
+    {
+        std::vector<Entry> entries;
         {
-            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< o->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->_mutex);
+            for(Entry* entry = (*itr)->_lruHead._lruPrev; entry!=&(*itr)->_lruHead; entry = entry->_lruPrev)
+            {
+                entries.push_back(*entry);
+            }
         }
-        else
+
+        OSG_DEBUG<<"Inserting objects to main ObjectCache "<<entries.size()<<std::endl;
+
+        // least recently used first, so the order is kept in this cache
+        for(std::vector<Entry>::iterator eitr = entries.begin();
+            eitr != entries.end();
+            ++eitr)
         {
-            OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
+            Shard& shard = getShard(eitr->_hash);
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+            // entries already cached are kept, like std::map::insert
+            if (findNoLock(shard, eitr->_hash, eitr->_fileName, eitr->_options.get())) continue;
+
+            insertNoLock(shard, new Entry(*eitr));
+            ++shard._numInsertions;
+            evictNoLock(shard);
         }
-        return itr->second.first.get();
     }
-    else return 0;
+}
+
+
+void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
+{
+    if (!object) return;
+
+    Entry* entry = new Entry;
+    entry->_fileName = filename;
+    entry->_options = options ? osg::clone(options) : 0;
+    entry->_object = object;
+    entry->_timeStamp = timestamp;
+    entry->_sizeInBytes = estimateSizeInBytes(object);
+    entry->_hash = hash(filename);
+
+    Shard& shard = getShard(entry->_hash);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+    Entry* previous = findNoLock(shard, entry->_hash, filename, options);
+    if (previous) removeNoLock(shard, previous);
+
+    insertNoLock(shard, entry);
+    ++shard._numInsertions;
+    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+
+    evictNoLock(shard);
+}
+
+osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+{
+    return getRefFromObjectCache(fileName, options).get();
 }
 
 osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    unsigned int h = hash(fileName);
+    Shard& shard = getShard(h);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    Entry* entry = findNoLock(shard, h, fileName, options);
+    if (entry)
     {
-        osg::ref_ptr<const osgDB::Options> o = itr->first.second;
-        if (o.valid())
+        if (entry->_options.valid())
         {
-            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< o->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
+            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< entry->_options->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
         }
         else
         {
             OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
         }
-        return itr->second.first.get();
+
+        touchNoLock(shard, entry);
+        ++shard._numHits;
+        return entry->_object.get();
+    }
+    else
+    {
+        ++shard._numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
+    for(std::vector<Shard*>::iterator itr = _shards.begin();
+        itr != _shards.end();
         ++itr)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Shard& shard = **itr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(Entry* entry = shard._lruHead._lruNext; entry!=&shard._lruHead; entry = entry->_lruNext)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            // if ref count is greater the 1 the object has an external reference.
+            if (entry->_object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                entry->_timeStamp = referenceTime;
+            }
         }
     }
 }
 
 void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // Remove expired entries from object cache
-    ObjectCacheMap::iterator oitr = _objectCache.begin();
-    while(oitr != _objectCache.end())
+    for(std::vector<Shard*>::iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
     {
-        if (oitr->second.second<=expiryTime)
-        {
-#if __cplusplus > 199711L
-            oitr = _objectCache.erase(oitr);
-#else
-            _objectCache.erase(oitr++);
-#endif
-        }
-        else
+        Shard& shard = **itr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // Remove expired entries from object cache
+        for(Entry* entry = shard._lruHead._lruNext; entry!=&shard._lruHead; )
         {
-            ++oitr;
+            Entry* next = entry->_lruNext;
+            if (entry->_timeStamp<=expiryTime)
+            {
+                removeNoLock(shard, entry);
+                ++shard._numExpired;
+            }
+            entry = next;
         }
     }
 }
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    unsigned int h = hash(fileName);
+    Shard& shard = getShard(h);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    Entry* entry = findNoLock(shard, h, fileName, options);
+    if (entry) removeNoLock(shard, entry);
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for(std::vector<Shard*>::iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->_mutex);
+        clearNoLock(**itr);
+    }
 }
 
 void ObjectCache::releaseGLObjects(osg::State* state)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
+    for(std::vector<Shard*>::iterator itr = _shards.begin();
+        itr != _shards.end();
         ++itr)
     {
-        osg::Object* object = itr->second.first.get();
-        object->releaseGLObjects(state);
+        Shard& shard = **itr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        for(Entry* entry = shard._lruHead._lruNext; entry!=&shard._lruHead; entry = entry->_lruNext)
+        {
+            entry->_object->releaseGLObjects(state);
+        }
     }
 }
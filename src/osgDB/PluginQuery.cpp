@@ -11,6 +11,7 @@
 
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <osgDB/fstream>
 #include <osg/Version>
 
 #include <osgDB/PluginQuery>
@@ -187,3 +188,77 @@ bool osgDB::outputPluginDetails(std::ostream& out, const std::string& fileName)
     }
 }
 
+
+bool osgDB::writePluginManifest(const std::string& fileName)
+{
+    typedef std::map<std::string, std::string> ExtensionLibraryMap;
+    ExtensionLibraryMap extensionLibraryMap;
+
+    std::string pluginDirectoryName = std::string("osgPlugins-")+std::string(osgGetVersion())+std::string("/");
+
+    FileNameList plugins = listAllAvailablePlugins();
+    for(FileNameList::iterator itr = plugins.begin();
+        itr != plugins.end();
+        ++itr)
+    {
+        ReaderWriterInfoList infoList;
+        if (!queryPlugin(*itr, infoList)) continue;
+
+        // libraries are named relative to the library path, as Registry::createLibraryNameForExtension() names them
+        std::string libraryName = pluginDirectoryName + getSimpleFileName(*itr);
+
+        // libraries without ReaderWriters, such as the serializers looked up as serializers_<library>, are listed under
+        // the name they are looked up by so that they can be preloaded too
+        if (infoList.empty())
+        {
+            std::string name = getNameLessExtension(getSimpleFileName(*itr));
+            if (name.compare(0, 6, "osgdb_")==0) name.erase(0, 6);
+            if (!name.empty() && getSimpleFileName(Registry::instance()->createLibraryNameForExtension(name))==getSimpleFileName(libraryName))
+            {
+                extensionLibraryMap.insert(ExtensionLibraryMap::value_type(name, libraryName));
+            }
+            continue;
+        }
+
+        for(ReaderWriterInfoList::iterator rwi_itr = infoList.begin();
+            rwi_itr != infoList.end();
+            ++rwi_itr)
+        {
+            const ReaderWriter::FormatDescriptionMap& extensions = (*rwi_itr)->extensions;
+            for(ReaderWriter::FormatDescriptionMap::const_iterator fdm_itr = extensions.begin();
+                fdm_itr != extensions.end();
+                ++fdm_itr)
+            {
+                std::string ext = convertToLowerCase(fdm_itr->first);
+
+                ExtensionLibraryMap::iterator eitr = extensionLibraryMap.find(ext);
+                if (eitr==extensionLibraryMap.end())
+                {
+                    extensionLibraryMap[ext] = libraryName;
+                }
+                else if (eitr->second!=libraryName &&
+                         getSimpleFileName(Registry::instance()->createLibraryNameForExtension(ext))==getSimpleFileName(libraryName))
+                {
+                    eitr->second = libraryName;
+                }
+            }
+        }
+    }
+
+    osgDB::ofstream fout(fileName.c_str());
+    if (!fout)
+    {
+        OSG_WARN<<"Can't write plugin manifest \""<<fileName<<"\"."<<std::endl;
+        return false;
+    }
+
+    fout<<"# OpenSceneGraph "<<osgGetVersion()<<" plugin manifest, <extension> <library>"<<std::endl;
+    for(ExtensionLibraryMap::iterator itr = extensionLibraryMap.begin();
+        itr != extensionLibraryMap.end();
+        ++itr)
+    {
+        fout<<itr->first<<" "<<itr->second<<std::endl;
+    }
+
+    return fout.good();
+}
@@ -23,12 +23,23 @@
 #include <osg/Texture2D>
 #include <osg/TextureRectangle>
 
+#include <osg/ApplicationUsage>
+
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+#include <map>
+#include <stdlib.h>
+
 using namespace osg;
 using namespace osgDB;
 
+static osg::ApplicationUsageProxy ReadFile_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_READ_FILE_THREADS <num>","Set the number of threads that read the files of a multi-file load, by default readRefNodeFiles() reads them in turn.");
+
 #ifdef OSG_PROVIDE_READFILE
 Object* osgDB::readObjectFile(const std::string& filename,const Options* options)
 {
@@ -141,25 +152,155 @@ osg::ref_ptr<osg::Script> osgDB::readRefScriptFile(const std::string& filename,c
     return NULL;
 }
 
-osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,const Options* options)
+namespace
 {
-    typedef std::vector< osg::ref_ptr<osg::Node> > NodeList;
-    NodeList nodeList;
 
-    for(std::vector<std::string>::iterator itr=fileList.begin();
-        itr!=fileList.end();
-        ++itr)
+// The files of a readNodeFilesConcurrently() call, handed out in turn to the threads reading them.
+class ConcurrentNodeFileReads
+{
+public:
+    ConcurrentNodeFileReads(const std::vector<std::string>& fileList, const std::vector<unsigned int>& indices,
+                            ReadResultList& results, const Options* options):
+        _fileList(fileList),
+        _indices(indices),
+        _results(results),
+        _options(options),
+        _next(0) {}
+
+    void readFiles()
     {
-        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile( *itr , options );
+        for(;;)
+        {
+            unsigned int index;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+                if (_next>=_indices.size()) return;
+                index = _indices[_next++];
+            }
+
+            // each file has a result of its own, so it's written without the lock
+            _results[index] = Registry::instance()->readNode(_fileList[index], _options);
+        }
+    }
+
+protected:
+
+    const std::vector<std::string>&     _fileList;
+    const std::vector<unsigned int>&    _indices;
+    ReadResultList&                     _results;
+    const Options*                      _options;
+
+    OpenThreads::Mutex                  _mutex;
+    unsigned int                        _next;
+};
 
-        if( node != (osg::Node *)0L )
+class ReadFileThread : public OpenThreads::Thread
+{
+public:
+    ReadFileThread(ConcurrentNodeFileReads& reads): _reads(reads) {}
+
+    virtual void run() { _reads.readFiles(); }
+
+protected:
+    ConcurrentNodeFileReads& _reads;
+};
+
+// The number of threads set by OSG_NUM_READ_FILE_THREADS, or else defaultNumThreads.
+unsigned int getNumReadFileThreads(unsigned int defaultNumThreads)
+{
+    const char* str = getenv("OSG_NUM_READ_FILE_THREADS");
+    unsigned int numThreads = str ? static_cast<unsigned int>(atoi(str)) : 0;
+    return numThreads>0 ? numThreads : defaultNumThreads;
+}
+
+// Add the nodes of the files that could be read to nodeList, in the order of fileList, warning of the others.
+template<class NodeList>
+void readNodesFromFileList(const std::vector<std::string>& fileList, const Options* options, unsigned int numThreads, NodeList& nodeList)
+{
+    ReadResultList results = readNodeFilesConcurrently(fileList, options, numThreads);
+
+    for(unsigned int i=0; i<results.size(); ++i)
+    {
+        ReaderWriter::ReadResult& rr = results[i];
+        if (rr.validNode())
         {
-            if (node->getName().empty()) node->setName( *itr );
+            osg::ref_ptr<osg::Node> node = rr.getNode();
+            if (node->getName().empty()) node->setName( fileList[i] );
             nodeList.push_back(node);
         }
+        else if (!rr.success())
+        {
+            OSG_WARN << "Error reading file " << fileList[i] << ": " << rr.statusMessage() << std::endl;
+        }
+    }
+}
+
+}
+
+ReadResultList osgDB::readNodeFilesConcurrently(const std::vector<std::string>& fileList,const Options* options,unsigned int numThreads)
+{
+    ReadResultList results(fileList.size());
+
+    // when nodes are cached a file listed again would be given the cached node anyway, so it's read once and the
+    // entries share the result, otherwise each entry is read into a subgraph of its own as by readRefNodeFile()
+    bool shareDuplicates = options && (options->getObjectCacheHint() & Options::CACHE_NODES)!=0 &&
+                           (options->getObjectCache() || Registry::instance()->getObjectCache());
+
+    typedef std::map<std::string, unsigned int> FirstIndexMap;
+    FirstIndexMap firstIndices;
+    std::vector<unsigned int> indices;
+    for(unsigned int i=0; i<fileList.size(); ++i)
+    {
+        if (!shareDuplicates || firstIndices.insert(FirstIndexMap::value_type(fileList[i], i)).second) indices.push_back(i);
+    }
 
+    if (numThreads==0) numThreads = getNumReadFileThreads(static_cast<unsigned int>(OpenThreads::GetNumberOfProcessors()));
+    numThreads = osg::minimum(numThreads, static_cast<unsigned int>(indices.size()));
+
+    ConcurrentNodeFileReads reads(fileList, indices, results, options);
+
+    // the calling thread reads alongside the others
+    std::vector<ReadFileThread*> threads;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        threads.push_back(new ReadFileThread(reads));
+        threads.back()->start();
     }
 
+    reads.readFiles();
+
+    for(std::vector<ReadFileThread*>::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+
+    if (shareDuplicates)
+    {
+        for(unsigned int i=0; i<fileList.size(); ++i)
+        {
+            unsigned int first = firstIndices[fileList[i]];
+            if (first!=i) results[i] = results[first];
+        }
+    }
+
+    return results;
+}
+
+osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,const Options* options)
+{
+    return readRefNodeFiles(fileList, options, getNumReadFileThreads(1));
+}
+
+osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,const Options* options,unsigned int numThreads)
+{
+    typedef std::vector< osg::ref_ptr<osg::Node> > NodeList;
+    NodeList nodeList;
+
+    readNodesFromFileList(fileList, options, numThreads, nodeList);
+
     if (nodeList.empty())
     {
         return NULL;
@@ -185,6 +326,11 @@ osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,co
 }
 
 osg::ref_ptr<Node> osgDB::readRefNodeFiles(osg::ArgumentParser& arguments,const Options* options)
+{
+    return readRefNodeFiles(arguments, options, getNumReadFileThreads(1));
+}
+
+osg::ref_ptr<Node> osgDB::readRefNodeFiles(osg::ArgumentParser& arguments,const Options* options,unsigned int numThreads)
 {
 
     typedef std::vector< osg::ref_ptr<osg::Node> > NodeList;
@@ -258,22 +404,18 @@ osg::ref_ptr<Node> osgDB::readRefNodeFiles(osg::ArgumentParser& arguments,const
     }
 
     // note currently doesn't delete the loaded file entries from the command line yet...
+    std::vector<std::string> fileList;
     for(int pos=1;pos<arguments.argc();++pos)
     {
         if (!arguments.isOption(pos))
         {
             // not an option so assume string is a filename.
-            osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile( arguments[pos], options);
-
-            if(node)
-            {
-                if (node->getName().empty()) node->setName( arguments[pos] );
-                nodeList.push_back(node);
-            }
-
+            fileList.push_back(arguments[pos]);
         }
     }
 
+    readNodesFromFileList(fileList, options, numThreads, nodeList);
+
     if (nodeList.empty())
     {
         return NULL;
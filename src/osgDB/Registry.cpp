@@ -25,12 +25,15 @@
 #include <osg/Version>
 #include <osg/Timer>
 
+#include <OpenThreads/Thread>
+
 #include <osgDB/Registry>
 #include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/FileNameUtils>
 #include <osgDB/fstream>
 #include <osgDB/Archive>
+#include <osgDB/BackgroundDeleteHandler>
 
 #include <algorithm>
 #include <set>
@@ -63,18 +66,24 @@ static osg::ApplicationUsageProxy Registry_e1(osg::ApplicationUsage::ENVIRONMENT
 #endif
 
 static osg::ApplicationUsageProxy Registry_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUILD_KDTREES on/off","Enable/disable the automatic building of KdTrees for each loaded Geometry.");
+static osg::ApplicationUsageProxy Registry_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OBJECT_CACHE_MAX_SIZE <megabytes>","Bound the estimated memory held by the objects of the Registry ObjectCache, evicting least recently used objects.");
+static osg::ApplicationUsageProxy Registry_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PLUGIN_MANIFEST <file>","Manifest mapping file extensions to the plugins reading them, written by osgconv --plugin-manifest, in place of osgPlugins-<version>/osgdb_plugins.manifest.");
 
 
 // from MimeTypes.cpp
 extern const char* builtinMimeTypeExtMappings[];
 
 
+// Walks the ReaderWriters of the current snapshot without locking. Once the end is reached a newer snapshot,
+// published by plugins loaded in the meantime, is picked up and walked for the ReaderWriters not tried yet.
 class Registry::AvailableReaderWriterIterator
 {
 public:
-    AvailableReaderWriterIterator(Registry::ReaderWriterList& rwList, OpenThreads::ReentrantMutex& pluginMutex):
-        _rwList(rwList),
-        _pluginMutex(pluginMutex) {}
+    AvailableReaderWriterIterator(Registry& registry):
+        _registry(registry),
+        _snapshot(registry.getReaderWriterSnapshot()),
+        _index(0),
+        _resumed(false) {}
 
 
     ReaderWriter& operator * () { return *get(); }
@@ -84,7 +93,8 @@ public:
 
     void operator ++()
     {
-        _rwUsed.insert(get());
+        _rwUsed.push_back(get());
+        ++_index;
     }
 
 
@@ -92,23 +102,33 @@ protected:
 
     AvailableReaderWriterIterator& operator = (const AvailableReaderWriterIterator&) { return *this; }
 
-    Registry::ReaderWriterList&     _rwList;
-    OpenThreads::ReentrantMutex&    _pluginMutex;
+    Registry&                                   _registry;
+    const Registry::ReaderWriterSnapshot*       _snapshot;
+    unsigned int                                _index;
+    bool                                        _resumed;
+
+    std::vector<ReaderWriter*>                  _rwUsed;
 
-    std::set<ReaderWriter*>         _rwUsed;
+    bool used(ReaderWriter* rw) const
+    {
+        return _resumed && std::find(_rwUsed.begin(), _rwUsed.end(), rw)!=_rwUsed.end();
+    }
 
     ReaderWriter* get()
     {
-        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
-        Registry::ReaderWriterList::iterator itr=_rwList.begin();
-        for(;itr!=_rwList.end();++itr)
+        for(;;)
         {
-            if (_rwUsed.find(itr->get())==_rwUsed.end())
-            {
-                return itr->get();
-            }
+            while(_index<_snapshot->_rwList.size() && used(_snapshot->_rwList[_index])) ++_index;
+
+            if (_index<_snapshot->_rwList.size()) return _snapshot->_rwList[_index];
+
+            const Registry::ReaderWriterSnapshot* latest = _registry.getReaderWriterSnapshot();
+            if (latest==_snapshot) return 0;
+
+            _snapshot = latest;
+            _index = 0;
+            _resumed = true;
         }
-        return 0;
     }
 
 };
@@ -224,6 +244,8 @@ Registry::Registry()
     // comment out because it was causing problems under OSX - causing it to crash osgconv when constructing ostream in osg::notify().
     // OSG_INFO << "Constructing osg::Registry"<<std::endl;
 
+    updateReaderWriterSnapshot();
+
     _buildKdTreesHint = Options::NO_PREFERENCE;
     _kdTreeBuilder = new osg::KdTreeBuilder;
 
@@ -252,10 +274,19 @@ Registry::Registry()
 
     // assign ObjectCache.
     _objectCache = new ObjectCache;
+    if( (ptr = getenv("OSG_OBJECT_CACHE_MAX_SIZE")) != 0)
+    {
+        _objectCache->setMaximumSizeInBytes(static_cast<uint64_t>(osg::asciiToDouble(ptr)*1024.0*1024.0));
+        OSG_INFO<<"Registry : ObjectCache maximum size = "<<ptr<<"MB"<<std::endl;
+    }
 
     _createNodeFromImage = false;
     _openingLibrary = false;
 
+    _pluginManifestRead = false;
+    _pluginPreloadActive = false;
+    _pluginPreloadThread = 0;
+
     // add default osga archive extension
     _archiveExtList.push_back("osga");
     _archiveExtList.push_back("zip");
@@ -482,12 +513,28 @@ Registry::Registry()
 Registry::~Registry()
 {
     destruct();
+
+    delete static_cast<ReaderWriterSnapshot*>(_rwSnapshot.get());
+    for(std::vector<ReaderWriterSnapshot*>::iterator itr = _retiredReaderWriterSnapshots.begin();
+        itr != _retiredReaderWriterSnapshots.end();
+        ++itr)
+    {
+        delete *itr;
+    }
 }
 
 void Registry::destruct()
 {
     // OSG_NOTICE<<"Registry::destruct()"<<std::endl;
 
+    // finish loading the plugin being preloaded before the libraries are closed
+    stopPreloadingPlugins();
+
+    // delete the objects held by a BackgroundDeleteHandler while the plugins that created them are still
+    // loaded, the objects released from here on are then deleted straight away
+    BackgroundDeleteHandler* backgroundDeleteHandler = dynamic_cast<BackgroundDeleteHandler*>(osg::Referenced::getDeleteHandler());
+    if (backgroundDeleteHandler) backgroundDeleteHandler->shutdown();
+
     // clean up the SharedStateManager
     _sharedStateManager = 0;
 
@@ -614,6 +661,7 @@ void Registry::addReaderWriter(ReaderWriter* rw)
 
     _rwList.push_back(rw);
 
+    updateReaderWriterSnapshot();
 }
 
 
@@ -629,10 +677,53 @@ void Registry::removeReaderWriter(ReaderWriter* rw)
     if (rwitr!=_rwList.end())
     {
         _rwList.erase(rwitr);
+
+        updateReaderWriterSnapshot();
     }
 
 }
 
+void Registry::updateReaderWriterSnapshot()
+{
+    ReaderWriterSnapshot* snapshot = new ReaderWriterSnapshot;
+    for(ReaderWriterList::iterator itr = _rwList.begin();
+        itr != _rwList.end();
+        ++itr)
+    {
+        snapshot->_rwList.push_back(itr->get());
+    }
+
+    // index every advertised extension by the first ReaderWriter accepting it, as the linear search would find
+    for(ReaderWriterList::iterator itr = _rwList.begin();
+        itr != _rwList.end();
+        ++itr)
+    {
+        const ReaderWriter::FormatDescriptionMap& extensions = (*itr)->supportedExtensions();
+        for(ReaderWriter::FormatDescriptionMap::const_iterator eitr = extensions.begin();
+            eitr != extensions.end();
+            ++eitr)
+        {
+            // keyed in lower case as lookups are, acceptsExtension() compares case insensitively
+            std::string lowercase_ext = convertToLowerCase(eitr->first);
+            if (snapshot->_extensionMap.count(lowercase_ext)!=0) continue;
+
+            for(ReaderWriterList::iterator ritr = _rwList.begin(); ritr != _rwList.end(); ++ritr)
+            {
+                if ((*ritr)->acceptsExtension(lowercase_ext))
+                {
+                    snapshot->_extensionMap[lowercase_ext] = ritr->get();
+                    break;
+                }
+            }
+        }
+    }
+
+    // writers are serialized by the _pluginMutex so the exchange can't fail
+    ReaderWriterSnapshot* previous = static_cast<ReaderWriterSnapshot*>(_rwSnapshot.get());
+    _rwSnapshot.assign(snapshot, previous);
+    if (previous) _retiredReaderWriterSnapshots.push_back(previous);
+}
+
 ImageProcessor* Registry::getImageProcessor()
 {
     {
@@ -751,6 +842,217 @@ bool Registry::readPluginAliasConfigurationFile( const std::string& file )
     return true;
 }
 
+bool Registry::readPluginManifest( const std::string& file )
+{
+    std::string fileName = osgDB::findDataFile( file );
+    if (fileName.empty())
+    {
+        OSG_NOTIFY( osg::WARN) << "Can't find plugin manifest \"" << file << "\"." << std::endl;
+        return false;
+    }
+
+    osgDB::ifstream ifs;
+    ifs.open( fileName.c_str() );
+    if (!ifs.good())
+    {
+        OSG_NOTIFY( osg::WARN) << "Can't open plugin manifest \"" << fileName << "\"." << std::endl;
+        return false;
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
+
+    _pluginManifestRead = true;
+
+    int lineNum( 0 );
+    while (ifs.good())
+    {
+        std::string raw;
+        ++lineNum;
+        std::getline( ifs, raw );
+        std::string ln = trim( raw );
+        if (ln.empty()) continue;
+        if (ln[0] == '#') continue;
+
+        std::string::size_type spIdx = ln.find_first_of( " \t" );
+        if (spIdx == ln.npos)
+        {
+            OSG_NOTIFY( osg::WARN) << file << ", line " << lineNum << ": Syntax error: missing space in \"" << raw << "\"." << std::endl;
+            continue;
+        }
+
+        const std::string ext = convertToLowerCase( trim( ln.substr( 0, spIdx ) ) );
+        const std::string libraryName = trim( ln.substr( spIdx+1 ) );
+        _pluginManifest[ext] = libraryName;
+    }
+
+    OSG_INFO<<"Registry : read plugin manifest "<<fileName<<", "<<_pluginManifest.size()<<" extensions"<<std::endl;
+
+    return true;
+}
+
+void Registry::initPluginManifest()
+{
+    if (_pluginManifestRead) return;
+    _pluginManifestRead = true;
+
+    const char* manifest = getenv("OSG_PLUGIN_MANIFEST");
+    if (manifest)
+    {
+        readPluginManifest(manifest);
+        return;
+    }
+
+    std::string fileName = findLibraryFile(std::string("osgPlugins-")+std::string(osgGetVersion())+std::string("/osgdb_plugins.manifest"), getOptions(), CASE_SENSITIVE);
+    if (!fileName.empty()) readPluginManifest(fileName);
+}
+
+std::string Registry::getPluginManifestLibrary(const std::string& ext)
+{
+    OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
+
+    initPluginManifest();
+
+    ExtensionAliasMap::iterator itr = _pluginManifest.find(convertToLowerCase(ext));
+    return (itr!=_pluginManifest.end()) ? itr->second : std::string();
+}
+
+class Registry::PluginPreloadThread : public OpenThreads::Thread
+{
+    public:
+
+        PluginPreloadThread(Registry* registry):
+            _registry(registry) {}
+
+        virtual void run()
+        {
+            std::string libraryName;
+            while(_registry->takeNextPluginToPreload(libraryName))
+            {
+                osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+                LoadStatus status = _registry->loadLibrary(libraryName);
+                if (status==LOADED)
+                {
+                    OSG_INFO<<"Registry : preloaded "<<libraryName<<" in "<<osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick())<<"ms"<<std::endl;
+                }
+                else if (status==NOT_LOADED)
+                {
+                    OSG_INFO<<"Registry : could not preload "<<libraryName<<std::endl;
+                }
+            }
+        }
+
+    protected:
+
+        Registry* _registry;
+};
+
+void Registry::preloadPlugins(const std::vector<std::string>& extensions)
+{
+    std::vector<std::string> libraryNames;
+    if (extensions.empty())
+    {
+        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
+
+        initPluginManifest();
+
+        std::set<std::string> uniqueNames;
+        for(ExtensionAliasMap::iterator itr = _pluginManifest.begin();
+            itr != _pluginManifest.end();
+            ++itr)
+        {
+            if (uniqueNames.insert(itr->second).second) libraryNames.push_back(itr->second);
+        }
+
+        if (libraryNames.empty())
+        {
+            OSG_NOTICE<<"Registry::preloadPlugins() no plugin manifest to preload the plugins of."<<std::endl;
+            return;
+        }
+    }
+    else
+    {
+        // skip the extensions a loaded ReaderWriter already advertises
+        const ReaderWriterSnapshot* snapshot = getReaderWriterSnapshot();
+        for(std::vector<std::string>::const_iterator itr = extensions.begin();
+            itr != extensions.end();
+            ++itr)
+        {
+            if (itr->empty() || snapshot->_extensionMap.count(convertToLowerCase(*itr))!=0) continue;
+
+            libraryNames.push_back(createLibraryNameForExtension(*itr));
+        }
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_pluginPreloadMutex);
+
+    for(std::vector<std::string>::iterator itr = libraryNames.begin();
+        itr != libraryNames.end();
+        ++itr)
+    {
+        if (std::find(_pluginPreloadQueue.begin(), _pluginPreloadQueue.end(), *itr)==_pluginPreloadQueue.end())
+        {
+            _pluginPreloadQueue.push_back(*itr);
+        }
+    }
+
+    if (_pluginPreloadQueue.empty() || _pluginPreloadActive) return;
+
+    // a previous thread has run out of plugins to load and is exiting, or has exited already
+    if (_pluginPreloadThread)
+    {
+        _pluginPreloadThread->join();
+        delete _pluginPreloadThread;
+    }
+
+    _pluginPreloadActive = true;
+    _pluginPreloadThread = new PluginPreloadThread(this);
+    _pluginPreloadThread->start();
+}
+
+bool Registry::takeNextPluginToPreload(std::string& libraryName)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_pluginPreloadMutex);
+
+    if (_pluginPreloadQueue.empty())
+    {
+        _pluginPreloadActive = false;
+        _pluginPreloadCondition.broadcast();
+        return false;
+    }
+
+    libraryName = _pluginPreloadQueue.front();
+    _pluginPreloadQueue.pop_front();
+    return true;
+}
+
+void Registry::waitForPreloadedPlugins()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_pluginPreloadMutex);
+    while(_pluginPreloadActive)
+    {
+        _pluginPreloadCondition.wait(&_pluginPreloadMutex);
+    }
+}
+
+void Registry::stopPreloadingPlugins()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_pluginPreloadMutex);
+        _pluginPreloadQueue.clear();
+    }
+
+    waitForPreloadedPlugins();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_pluginPreloadMutex);
+    if (_pluginPreloadThread)
+    {
+        _pluginPreloadThread->join();
+        delete _pluginPreloadThread;
+        _pluginPreloadThread = 0;
+    }
+}
+
 std::string Registry::trim( const std::string& str )
 {
     if (!str.size()) return str;
@@ -779,6 +1081,9 @@ std::string Registry::createLibraryNameForExtension(const std::string& ext)
     ExtensionAliasMap::iterator itr=_extAliasMap.find(lowercase_ext);
     if (itr!=_extAliasMap.end() && ext != itr->second) return createLibraryNameForExtension(itr->second);
 
+    std::string manifestLibrary = getPluginManifestLibrary(lowercase_ext);
+    if (!manifestLibrary.empty()) return manifestLibrary;
+
     std::string prepend = std::string("osgPlugins-")+std::string(osgGetVersion())+std::string("/");
 
 #if defined(__CYGWIN__)
@@ -870,18 +1175,34 @@ DynamicLibrary* Registry::getLibrary(const std::string& fileName)
 
 ReaderWriter* Registry::getReaderWriterForExtension(const std::string& ext)
 {
+    // first attempt one of the installed loaders, without locking
+    const ReaderWriterSnapshot* snapshot = getReaderWriterSnapshot();
+
+    ReaderWriterSnapshot::ExtensionMap::const_iterator eitr = snapshot->_extensionMap.find(convertToLowerCase(ext));
+    if (eitr!=snapshot->_extensionMap.end()) return eitr->second;
+
+    // ReaderWriters may accept extensions they don't advertise
+    for(ReaderWriterSnapshot::List::const_iterator itr = snapshot->_rwList.begin();
+        itr != snapshot->_rwList.end();
+        ++itr)
+    {
+        if((*itr)->acceptsExtension(ext)) return *itr;
+    }
+
     // record the existing reader writer.
-    std::set<ReaderWriter*> rwOriginal;
+    std::set<ReaderWriter*> rwOriginal(snapshot->_rwList.begin(), snapshot->_rwList.end());
 
     OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
 
-    // first attempt one of the installed loaders
+    // another thread may have loaded the plugin since the snapshot was taken
     for(ReaderWriterList::iterator itr=_rwList.begin();
         itr!=_rwList.end();
         ++itr)
     {
-        rwOriginal.insert(itr->get());
-        if((*itr)->acceptsExtension(ext)) return (*itr).get();
+        if (rwOriginal.find(itr->get())==rwOriginal.end())
+        {
+            if((*itr)->acceptsExtension(ext)) return (*itr).get();
+        }
     }
 
     // now look for a plug-in to load the file.
@@ -1187,7 +1508,7 @@ ReaderWriter::ReadResult Registry::read(const ReadFunctor& readFunctor)
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(*this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::ReadResult rr = readFunctor.doRead(*itr);
@@ -1343,7 +1664,7 @@ ReaderWriter::WriteResult Registry::writeObjectImplementation(const Object& obj,
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(*this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeObject(obj,fileName,options);
@@ -1389,7 +1710,7 @@ ReaderWriter::WriteResult Registry::writeImageImplementation(const Image& image,
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(*this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeImage(image,fileName,options);
@@ -1434,7 +1755,7 @@ ReaderWriter::WriteResult Registry::writeHeightFieldImplementation(const HeightF
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(*this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeHeightField(HeightField,fileName,options);
@@ -1491,7 +1812,7 @@ ReaderWriter::WriteResult Registry::writeNodeImplementation(const Node& node,con
     Results results;
 
     // first attempt to write the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(*this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeNode(node,fileName,options);
@@ -1537,7 +1858,7 @@ ReaderWriter::WriteResult Registry::writeShaderImplementation(const Shader& shad
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(*this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeShader(shader,fileName,options);
@@ -1584,7 +1905,7 @@ ReaderWriter::WriteResult Registry::writeScriptImplementation(const Script& imag
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(*this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeScript(image,fileName,options);
@@ -1717,8 +2038,10 @@ bool Registry::isProtocolRegistered(const std::string& protocol)
 
 void Registry::getReaderWriterListForProtocol(const std::string& protocol, ReaderWriterList& results) const
 {
-    for(ReaderWriterList::const_iterator i = _rwList.begin(); i != _rwList.end(); ++i)
-    {        if ((*i)->acceptsProtocol(protocol))
+    const ReaderWriterSnapshot* snapshot = getReaderWriterSnapshot();
+    for(ReaderWriterSnapshot::List::const_iterator i = snapshot->_rwList.begin(); i != snapshot->_rwList.end(); ++i)
+    {
+        if ((*i)->acceptsProtocol(protocol))
             results.push_back(*i);
     }
 }
@@ -12,15 +12,266 @@
 */
 
 #include <osg/Timer>
+#include <osg/Texture>
+#include <osg/Material>
+#include <osg/ApplicationUsage>
 #include <osgDB/SharedStateManager>
 
+#include <string.h>
+#include <stdlib.h>
+
 using namespace osgDB;
 
+static osg::ApplicationUsageProxy SharedStateManager_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_SHARE_STATE_CONCURRENTLY <ON/OFF>","Switch on or off the sharing of the state of loaded subgraphs on the database pager threads rather than the update thread.");
+
+namespace
+{
+    typedef std::map<const osg::StateAttribute*, unsigned int> AttributeHashMap;
+
+    inline void hashCombine(unsigned int& seed, unsigned int value)
+    {
+        seed ^= value + 0x9e3779b9 + (seed<<6) + (seed>>2);
+    }
+
+    // FNV-1a
+    inline unsigned int hashString(const std::string& str)
+    {
+        unsigned int hash = 2166136261u;
+        for(std::string::const_iterator itr = str.begin(); itr != str.end(); ++itr)
+        {
+            hash ^= static_cast<unsigned char>(*itr);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    inline unsigned int hashFloat(float value)
+    {
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline void hashCombine(unsigned int& seed, const osg::Vec4& value)
+    {
+        for(unsigned int i=0; i<4; ++i) hashCombine(seed, hashFloat(value[i]));
+    }
+
+    // Image::compare() only tests the buffer pointers when one of the file names is empty, hashing the file name when
+    // there is one and the pointer otherwise misses the odd pair that compare equal through the other, which only loses a share
+    unsigned int hashImage(const osg::Image& image)
+    {
+        unsigned int hash = image.getFileName().empty() ?
+            static_cast<unsigned int>(reinterpret_cast<size_t>(image.data())) : hashString(image.getFileName());
+
+        hashCombine(hash, image.s());
+        hashCombine(hash, image.t());
+        hashCombine(hash, image.getInternalTextureFormat());
+        hashCombine(hash, image.getPixelFormat());
+        hashCombine(hash, image.getDataType());
+        hashCombine(hash, image.getPacking());
+        hashCombine(hash, image.getModifiedCount());
+        return hash;
+    }
+
+    unsigned int hashAttribute(const osg::StateAttribute& attribute)
+    {
+        unsigned int hash = hashString(attribute.className());
+        hashCombine(hash, hashString(attribute.libraryName()));
+        hashCombine(hash, attribute.getType());
+
+        const osg::Texture* texture = attribute.asTexture();
+        if (texture)
+        {
+            hashCombine(hash, texture->getWrap(osg::Texture::WRAP_S));
+            hashCombine(hash, texture->getWrap(osg::Texture::WRAP_T));
+            hashCombine(hash, texture->getWrap(osg::Texture::WRAP_R));
+            hashCombine(hash, texture->getFilter(osg::Texture::MIN_FILTER));
+            hashCombine(hash, texture->getFilter(osg::Texture::MAG_FILTER));
+            hashCombine(hash, texture->getInternalFormatMode());
+
+            for(unsigned int i=0; i<texture->getNumImages(); ++i)
+            {
+                const osg::Image* image = texture->getImage(i);
+                hashCombine(hash, image ? hashImage(*image) : 0u);
+            }
+            return hash;
+        }
+
+        const osg::Material* material = dynamic_cast<const osg::Material*>(&attribute);
+        if (material)
+        {
+            hashCombine(hash, material->getColorMode());
+            hashCombine(hash, material->getAmbient(osg::Material::FRONT));
+            hashCombine(hash, material->getAmbient(osg::Material::BACK));
+            hashCombine(hash, material->getDiffuse(osg::Material::FRONT));
+            hashCombine(hash, material->getDiffuse(osg::Material::BACK));
+            hashCombine(hash, material->getSpecular(osg::Material::FRONT));
+            hashCombine(hash, material->getSpecular(osg::Material::BACK));
+            hashCombine(hash, material->getEmission(osg::Material::FRONT));
+            hashCombine(hash, material->getEmission(osg::Material::BACK));
+            hashCombine(hash, hashFloat(material->getShininess(osg::Material::FRONT)));
+            hashCombine(hash, hashFloat(material->getShininess(osg::Material::BACK)));
+        }
+
+        return hash;
+    }
+
+    // attributeHashes, when set, holds the hashes of the attributes already seen in this share pass
+    unsigned int hashAttribute(const osg::StateAttribute& attribute, AttributeHashMap* attributeHashes)
+    {
+        if (!attributeHashes) return hashAttribute(attribute);
+
+        AttributeHashMap::iterator itr = attributeHashes->find(&attribute);
+        if (itr != attributeHashes->end()) return itr->second;
+
+        unsigned int hash = hashAttribute(attribute);
+        (*attributeHashes)[&attribute] = hash;
+        return hash;
+    }
+
+    void hashAttributeList(unsigned int& hash, const osg::StateSet::AttributeList& attributeList, AttributeHashMap* attributeHashes)
+    {
+        for(osg::StateSet::AttributeList::const_iterator itr = attributeList.begin(); itr != attributeList.end(); ++itr)
+        {
+            hashCombine(hash, itr->first.first);
+            hashCombine(hash, itr->first.second);
+            hashCombine(hash, itr->second.first.valid() ? hashAttribute(*(itr->second.first), attributeHashes) : 0u);
+            hashCombine(hash, itr->second.second);
+        }
+    }
+
+    void hashModeList(unsigned int& hash, const osg::StateSet::ModeList& modeList)
+    {
+        for(osg::StateSet::ModeList::const_iterator itr = modeList.begin(); itr != modeList.end(); ++itr)
+        {
+            hashCombine(hash, itr->first);
+            hashCombine(hash, itr->second);
+        }
+    }
+
+    // covers everything StateSet::compare(rhs, true) tests except the contents of the uniforms
+    unsigned int hashStateSet(const osg::StateSet& stateSet, AttributeHashMap* attributeHashes)
+    {
+        const osg::StateSet::TextureAttributeList& textureAttributeList = stateSet.getTextureAttributeList();
+        const osg::StateSet::TextureModeList& textureModeList = stateSet.getTextureModeList();
+
+        unsigned int hash = 0;
+        hashCombine(hash, static_cast<unsigned int>(textureAttributeList.size()));
+        hashCombine(hash, static_cast<unsigned int>(textureModeList.size()));
+        hashCombine(hash, static_cast<unsigned int>(stateSet.getAttributeList().size()));
+        hashCombine(hash, static_cast<unsigned int>(stateSet.getModeList().size()));
+        hashCombine(hash, static_cast<unsigned int>(stateSet.getUniformList().size()));
+        hashCombine(hash, static_cast<unsigned int>(stateSet.getDefineList().size()));
+
+        hashCombine(hash, stateSet.getRenderBinMode());
+        if (stateSet.getRenderBinMode() != osg::StateSet::INHERIT_RENDERBIN_DETAILS)
+        {
+            hashCombine(hash, static_cast<unsigned int>(stateSet.getBinNumber()));
+            hashCombine(hash, hashString(stateSet.getBinName()));
+        }
+
+        for(unsigned int unit=0; unit<textureAttributeList.size(); ++unit)
+        {
+            hashAttributeList(hash, textureAttributeList[unit], attributeHashes);
+        }
+
+        hashAttributeList(hash, stateSet.getAttributeList(), attributeHashes);
+
+        for(unsigned int unit=0; unit<textureModeList.size(); ++unit)
+        {
+            hashModeList(hash, textureModeList[unit]);
+        }
+
+        hashModeList(hash, stateSet.getModeList());
+
+        const osg::StateSet::UniformList& uniformList = stateSet.getUniformList();
+        for(osg::StateSet::UniformList::const_iterator itr = uniformList.begin(); itr != uniformList.end(); ++itr)
+        {
+            hashCombine(hash, hashString(itr->first));
+            hashCombine(hash, itr->second.second);
+        }
+
+        const osg::StateSet::DefineList& defineList = stateSet.getDefineList();
+        for(osg::StateSet::DefineList::const_iterator itr = defineList.begin(); itr != defineList.end(); ++itr)
+        {
+            hashCombine(hash, hashString(itr->first));
+            hashCombine(hash, hashString(itr->second.first));
+            hashCombine(hash, itr->second.second);
+        }
+
+        return hash;
+    }
+
+    inline bool isEqual(const osg::StateAttribute& lhs, const osg::StateAttribute& rhs) { return lhs.compare(rhs)==0; }
+    inline bool isEqual(const osg::StateSet& lhs, const osg::StateSet& rhs) { return lhs.compare(rhs, true)==0; }
+
+    // the caller holds the lock of the shard objects belongs to
+    template<class T>
+    T* findInBucket(std::multimap< unsigned int, osg::ref_ptr<T> >& objects, const T* object, unsigned int hash)
+    {
+        typedef typename std::multimap< unsigned int, osg::ref_ptr<T> >::iterator iterator;
+        std::pair<iterator, iterator> range = objects.equal_range(hash);
+        for(iterator itr = range.first; itr != range.second; ++itr)
+        {
+            if (itr->second.get()==object || isEqual(*(itr->second), *object)) return itr->second.get();
+        }
+        return 0;
+    }
+
+    template<class T>
+    void pruneBucket(std::multimap< unsigned int, osg::ref_ptr<T> >& objects)
+    {
+        typedef typename std::multimap< unsigned int, osg::ref_ptr<T> >::iterator iterator;
+        for(iterator itr = objects.begin(); itr != objects.end();)
+        {
+            if (itr->second->referenceCount()<=1)
+                objects.erase(itr++);
+            else
+                ++itr;
+        }
+    }
+}
+
+//----------------------------------------------------------------
+// SharedStateManager::ShareVisitor
+//----------------------------------------------------------------
+class SharedStateManager::ShareVisitor : public osg::NodeVisitor
+{
+public:
+    ShareVisitor(SharedStateManager* manager, ShareContext& context):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _manager(manager),
+        _context(context)
+    {
+        setTraversalMask(manager->getTraversalMask());
+        setNodeMaskOverride(manager->getNodeMaskOverride());
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        osg::StateSet* ss = node.getStateSet();
+        if(ss) _manager->process(_context, ss, &node);
+        traverse(node);
+    }
+
+protected:
+    SharedStateManager* _manager;
+    ShareContext&       _context;
+};
+
 SharedStateManager::SharedStateManager(unsigned int mode):
-    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _concurrentSharing(false)
 {
     setShareMode(mode);
-    _mutex=0;
+
+    const char* str = 0;
+    if( (str = getenv("OSG_SHARE_STATE_CONCURRENTLY")) != 0)
+    {
+        _concurrentSharing = strcmp(str,"yes")==0 || strcmp(str,"YES")==0 ||
+                             strcmp(str,"on")==0 || strcmp(str,"ON")==0;
+    }
 }
 
 void SharedStateManager::setShareMode(unsigned int mode)
@@ -36,30 +287,34 @@ void SharedStateManager::setShareMode(unsigned int mode)
     _shareStateSet[osg::Object::UNSPECIFIED] =  (_shareMode & SHARE_UNSPECIFIED_STATESETS)!=0;
 }
 
+unsigned int SharedStateManager::computeHash(const osg::StateSet& stateSet)
+{
+    return hashStateSet(stateSet, 0);
+}
+
+unsigned int SharedStateManager::computeHash(const osg::StateAttribute& attribute)
+{
+    return hashAttribute(attribute);
+}
+
 //----------------------------------------------------------------
 // SharedStateManager::prune
 //----------------------------------------------------------------
 void SharedStateManager::prune()
 {
-    StateSetSet::iterator sitr;
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-    for(sitr=_sharedStateSetList.begin(); sitr!=_sharedStateSetList.end();)
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if ((*sitr)->referenceCount()<=1)
-            _sharedStateSetList.erase(sitr++);
-        else
-            ++sitr;
+        StateSetTable::Shard& shard = _sharedStateSetList._shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        pruneBucket(shard._objects);
     }
 
-    TextureSet::iterator titr;
-    for(titr=_sharedTextureList.begin(); titr!=_sharedTextureList.end();)
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if ((*titr)->referenceCount()<=1)
-            _sharedTextureList.erase(titr++);
-        else
-            ++titr;
+        TextureTable::Shard& shard = _sharedTextureList._shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        pruneBucket(shard._objects);
     }
-
 }
 
 
@@ -68,19 +323,30 @@ void SharedStateManager::prune()
 //----------------------------------------------------------------
 void SharedStateManager::share(osg::Node *node, OpenThreads::Mutex *mt)
 {
-//    const osg::Timer& timer = *osg::Timer::instance();
-//    osg::Timer_t start_tick = timer.tick();
-
-    _mutex = mt;
-    node->accept(*this);
-    tmpSharedTextureList.clear();
-    tmpSharedStateSetList.clear();
-    _mutex = 0;
-
-//    osg::Timer_t end_tick = timer.tick();
-//     std::cout << "SHARING TIME = "<<timer.delta_m(start_tick,end_tick)<<"ms"<<std::endl;
-//     std::cout << "   _sharedStateSetList.size() = "<<_sharedStateSetList.size()<<std::endl;
-//     std::cout << "   _sharedTextureList.size() = "<<_sharedTextureList.size()<<std::endl;
+    ShareContext context(mt);
+    ShareVisitor shareVisitor(this, context);
+    node->accept(shareVisitor);
+}
+
+void SharedStateManager::share(osg::Node *node, StateSetReplacementList& replacements)
+{
+    ShareContext context(0, &replacements);
+    ShareVisitor shareVisitor(this, context);
+    node->accept(shareVisitor);
+}
+
+void SharedStateManager::applyStateSetReplacements(StateSetReplacementList& replacements, OpenThreads::Mutex *mt)
+{
+    if (replacements.empty()) return;
+
+    if (mt) mt->lock();
+    for(StateSetReplacementList::iterator itr = replacements.begin(); itr != replacements.end(); ++itr)
+    {
+        itr->first->setStateSet(itr->second.get());
+    }
+    if (mt) mt->unlock();
+
+    replacements.clear();
 }
 
 
@@ -90,7 +356,7 @@ void SharedStateManager::share(osg::Node *node, OpenThreads::Mutex *mt)
 void SharedStateManager::apply(osg::Node& node)
 {
     osg::StateSet* ss = node.getStateSet();
-    if(ss) process(ss, &node);
+    if(ss) process(_context, ss, &node);
     traverse(node);
 }
 
@@ -98,8 +364,7 @@ bool SharedStateManager::isShared(osg::StateSet* ss)
 {
     if (shareStateSet(ss->getDataVariance()))
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-        return find(ss) != 0;
+        return find(ss, computeHash(*ss)).valid();
     }
     else
         return false;
@@ -109,8 +374,7 @@ bool SharedStateManager::isShared(osg::Texture* texture)
 {
     if (shareTexture(texture->getDataVariance()))
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-        return find(texture) != 0;
+        return find(texture, computeHash(*texture)).valid();
     }
     else
         return false;
@@ -119,44 +383,67 @@ bool SharedStateManager::isShared(osg::Texture* texture)
 //----------------------------------------------------------------
 // SharedStateManager::find
 //----------------------------------------------------------------
-//
-// The find methods don't need to lock _listMutex because the thread
-// from which they are called is doing the writing to the lists.
-osg::StateSet *SharedStateManager::find(osg::StateSet *ss)
+osg::ref_ptr<osg::StateSet> SharedStateManager::find(osg::StateSet *ss, unsigned int hash)
 {
-    StateSetSet::iterator result
-        = _sharedStateSetList.find(osg::ref_ptr<osg::StateSet>(ss));
-    if (result == _sharedStateSetList.end())
-        return NULL;
-    else
-        return result->get();
+    StateSetTable::Shard& shard = _sharedStateSetList.getShard(hash);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    return osg::ref_ptr<osg::StateSet>(findInBucket(shard._objects, ss, hash));
 }
 
-osg::StateAttribute *SharedStateManager::find(osg::StateAttribute *sa)
+osg::ref_ptr<osg::StateAttribute> SharedStateManager::find(osg::StateAttribute *sa, unsigned int hash)
 {
-    TextureSet::iterator result
-        = _sharedTextureList.find(osg::ref_ptr<osg::StateAttribute>(sa));
-    if (result == _sharedTextureList.end())
-        return NULL;
-    else
-        return result->get();
+    TextureTable::Shard& shard = _sharedTextureList.getShard(hash);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    return osg::ref_ptr<osg::StateAttribute>(findInBucket(shard._objects, sa, hash));
+}
+
+osg::ref_ptr<osg::StateSet> SharedStateManager::findOrInsert(osg::StateSet *ss, unsigned int hash)
+{
+    StateSetTable::Shard& shard = _sharedStateSetList.getShard(hash);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    osg::StateSet* result = findInBucket(shard._objects, ss, hash);
+    if (result) return osg::ref_ptr<osg::StateSet>(result);
+
+    shard._objects.insert(StateSetTable::ObjectMap::value_type(hash, ss));
+    return osg::ref_ptr<osg::StateSet>(ss);
+}
+
+osg::ref_ptr<osg::StateAttribute> SharedStateManager::findOrInsert(osg::StateAttribute *sa, unsigned int hash)
+{
+    TextureTable::Shard& shard = _sharedTextureList.getShard(hash);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    osg::StateAttribute* result = findInBucket(shard._objects, sa, hash);
+    if (result) return osg::ref_ptr<osg::StateAttribute>(result);
+
+    shard._objects.insert(TextureTable::ObjectMap::value_type(hash, sa));
+    return osg::ref_ptr<osg::StateAttribute>(sa);
 }
 
 
 //----------------------------------------------------------------
 // SharedStateManager::setStateSet
 //----------------------------------------------------------------
-void SharedStateManager::setStateSet(osg::StateSet* ss, osg::Object* object)
+void SharedStateManager::setStateSet(ShareContext& context, osg::StateSet* ss, osg::Object* object)
 {
     osg::Node* node = dynamic_cast<osg::Node*>(object);
-    if (node) node->setStateSet(ss);
+    if (!node) return;
+
+    if (context._replacements)
+    {
+        context._replacements->push_back(StateSetReplacementList::value_type(node, ss));
+        return;
+    }
+
+    if (context._mutex) context._mutex->lock();
+    node->setStateSet(ss);
+    if (context._mutex) context._mutex->unlock();
 }
 
 
 //----------------------------------------------------------------
 // SharedStateManager::shareTextures
 //----------------------------------------------------------------
-void SharedStateManager::shareTextures(osg::StateSet* ss)
+void SharedStateManager::shareTextures(ShareContext& context, osg::StateSet* ss)
 {
     const osg::StateSet::TextureAttributeList& texAttributes = ss->getTextureAttributeList();
     for(unsigned int unit=0;unit<texAttributes.size();++unit)
@@ -169,38 +456,39 @@ void SharedStateManager::shareTextures(osg::StateSet* ss)
         // Valid Texture to be shared
         if(texture && shareTexture(texture->getDataVariance()))
         {
-            TextureTextureSharePairMap::iterator titr = tmpSharedTextureList.find(texture);
-            if(titr==tmpSharedTextureList.end())
+            TextureTextureSharePairMap::iterator titr = context.tmpSharedTextureList.find(texture);
+            if(titr==context.tmpSharedTextureList.end())
             {
                 // Texture is not in tmp list:
                 // First time it appears in this file, search Texture in sharedAttributeList
-                osg::StateAttribute* textureFromSharedList = find(texture);
-                if(textureFromSharedList)
+                // and add it there if it isn't yet, in one step so that other threads sharing
+                // at the same time settle on the same Texture.
+                unsigned int hash = hashAttribute(*texture, &context.attributeHashes);
+                osg::ref_ptr<osg::StateAttribute> textureFromSharedList = findOrInsert(texture, hash);
+                if(textureFromSharedList!=texture)
                 {
                     // Texture is in sharedAttributeList:
                     // Share now. Required to be shared all next times
-                    if(_mutex) _mutex->lock();
+                    if(context._mutex) context._mutex->lock();
                     pair->first = textureFromSharedList;
-                    if(_mutex) _mutex->unlock();
-                    tmpSharedTextureList[texture] = TextureSharePair(textureFromSharedList, true);
+                    if(context._mutex) context._mutex->unlock();
+                    context.tmpSharedTextureList[texture] = TextureSharePair(textureFromSharedList.get(), true);
+                    context.attributeHashes[textureFromSharedList.get()] = hash;
                 }
                 else
                 {
-                    // Texture is not in _sharedAttributeList:
-                    // Add to _sharedAttributeList. Not needed to be
-                    // shared all next times.
-                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedTextureList.insert(texture);
-                    tmpSharedTextureList[texture] = TextureSharePair(texture, false);
+                    // Texture was not in _sharedAttributeList and has been added:
+                    // Not needed to be shared all next times.
+                    context.tmpSharedTextureList[texture] = TextureSharePair(texture, false);
                 }
             }
             else if(titr->second.second)
             {
                 // Texture is in tmpSharedAttributeList and share flag is on:
                 // It should be shared
-                if(_mutex) _mutex->lock();
+                if(context._mutex) context._mutex->lock();
                 pair->first = titr->second.first;
-                if(_mutex) _mutex->unlock();
+                if(context._mutex) context._mutex->unlock();
             }
         }
     }
@@ -210,80 +498,83 @@ void SharedStateManager::shareTextures(osg::StateSet* ss)
 //----------------------------------------------------------------
 // SharedStateManager::process
 //----------------------------------------------------------------
-void SharedStateManager::process(osg::StateSet* ss, osg::Object* parent)
+void SharedStateManager::process(ShareContext& context, osg::StateSet* ss, osg::Object* parent)
 {
     // Valid StateSet to be shared
     if (shareStateSet(ss->getDataVariance()))
     {
-        StateSetStateSetSharePairMap::iterator sitr = tmpSharedStateSetList.find(ss);
-        if (sitr==tmpSharedStateSetList.end())
+        StateSetStateSetSharePairMap::iterator sitr = context.tmpSharedStateSetList.find(ss);
+        if (sitr==context.tmpSharedStateSetList.end())
         {
             // StateSet is not in tmp list:
             // First time it appears in this file, search StateSet in sharedObjectList
-            osg::StateSet *ssFromSharedList = find(ss);
-            if (ssFromSharedList)
+            unsigned int hash = hashStateSet(*ss, &context.attributeHashes);
+            osg::ref_ptr<osg::StateSet> ssFromSharedList = find(ss, hash);
+            if (!ssFromSharedList)
+            {
+                // StateSet is not in sharedStateSetList:
+                // Only in this case sharing textures is also required, done before the StateSet
+                // is added to sharedStateSetList where other threads may compare against it.
+                if (_shareMode & (SHARE_DYNAMIC_TEXTURES | SHARE_STATIC_TEXTURES | SHARE_UNSPECIFIED_TEXTURES))
+                {
+                    shareTextures(context, ss);
+                }
+
+                // Another thread may have added an equal StateSet meanwhile.
+                ssFromSharedList = findOrInsert(ss, hash);
+            }
+
+            if (ssFromSharedList!=ss)
             {
                 // StateSet is in sharedStateSetList:
                 // Share now. Required to be shared all next times
-                if (_mutex) _mutex->lock();
-                setStateSet(ssFromSharedList, parent);
-                if (_mutex) _mutex->unlock();
-                tmpSharedStateSetList[ss] = StateSetSharePair(ssFromSharedList, true);
+                setStateSet(context, ssFromSharedList.get(), parent);
+                context.tmpSharedStateSetList[ss] = StateSetSharePair(ssFromSharedList.get(), true);
             }
             else
             {
-                // StateSet is not in sharedStateSetList:
-                // Add to sharedStateSetList. Not needed to be shared all next times.
-                {
-                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedStateSetList.insert(ss);
-                    tmpSharedStateSetList[ss]
-                        = StateSetSharePair(ss, false);
-                }
-                // Only in this case sharing textures is also required
-                if (_shareMode & (SHARE_DYNAMIC_TEXTURES | SHARE_STATIC_TEXTURES | SHARE_UNSPECIFIED_TEXTURES))
-                {
-                    shareTextures(ss);
-                }
+                // StateSet has been added to sharedStateSetList:
+                // Not needed to be shared all next times.
+                context.tmpSharedStateSetList[ss] = StateSetSharePair(ss, false);
             }
         }
         else if (sitr->second.second)
         {
             // StateSet is in tmpSharedStateSetList and share flag is on:
             // It should be shared
-            if(_mutex) _mutex->lock();
-            setStateSet(sitr->second.first, parent);
-            if(_mutex) _mutex->unlock();
+            setStateSet(context, sitr->second.first, parent);
         }
     }
     else if (_shareMode & (SHARE_DYNAMIC_TEXTURES | SHARE_STATIC_TEXTURES | SHARE_UNSPECIFIED_TEXTURES))
     {
-        shareTextures(ss);
+        shareTextures(context, ss);
     }
 }
 
 void SharedStateManager::releaseGLObjects(osg::State* state) const
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        TextureSet::const_iterator it;
-        for ( it = _sharedTextureList.begin(); it != _sharedTextureList.end(); ++it )
+        const TextureTable::Shard& shard = _sharedTextureList._shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        for(TextureTable::ObjectMap::const_iterator it = shard._objects.begin(); it != shard._objects.end(); ++it)
         {
-            if ( it->valid() )
+            if ( it->second.valid() )
             {
-                it->get()->releaseGLObjects(state);
+                it->second->releaseGLObjects(state);
             }
         }
     }
 
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        StateSetSet::const_iterator it;
-        for( it = _sharedStateSetList.begin(); it != _sharedStateSetList.end(); ++it )
+        const StateSetTable::Shard& shard = _sharedStateSetList._shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        for(StateSetTable::ObjectMap::const_iterator it = shard._objects.begin(); it != shard._objects.end(); ++it)
         {
-            if ( it->valid() )
+            if ( it->second.valid() )
             {
-                it->get()->releaseGLObjects(state);
+                it->second->releaseGLObjects(state);
             }
         }
     }
@@ -0,0 +1,267 @@
+// AOA round trip benchmark. Writes a generated scene through the same passes as ReaderWriterAOA::writeNode,
+// reads it back and reports the time of every phase as json: seconds, MB/s of the written files,
+// objects/s of the generated scene (nodes and drawables) and the peak resident set of the process.
+//
+// usage: aoa_roundtrip_bench [--meshes N] [--depth N] [--lods N] [--vertices N] [--vertex-format pntc]
+//                            [--draw-arrays] [--materials N] [--lights N] [--seed N] [--iterations N]
+//                            [--config aoa.config.json] [--materials-file file.csv] [--output dir] [--json report.json]
+//
+// The configs are read from the working directory by default, the same way the plugin does.
+
+#include "synthetic_scene.h"
+
+#include "aoa_to_osg.h"
+#include "aurora_aoa_reader.h"
+#include "aurora_aoa_writer.h"
+#include "fix_materials_visitor.h"
+#include "flatten_transforms.h"
+#include "lights_generation_visitor.h"
+#include "material_loader.h"
+#include "plugin_config.h"
+#include "write_aoa_visitor.h"
+
+#include <osg/ArgumentParser>
+#include <osg/MatrixTransform>
+#include <osg/Timer>
+
+#include <fstream>
+#include <iostream>
+#include <functional>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using namespace aurora;
+
+namespace
+{
+
+struct phase_report
+{
+    string name;
+    double best_s        = 0;
+    double mean_s        = 0;
+    double mb_per_s      = 0;
+    double objects_per_s = 0;
+
+    REFL_INNER(phase_report)
+        REFL_ENTRY(name)
+        REFL_ENTRY(best_s)
+        REFL_ENTRY(mean_s)
+        REFL_ENTRY(mb_per_s)
+        REFL_ENTRY(objects_per_s)
+    REFL_END()
+};
+
+struct benchmark_report
+{
+    synthetic_scene_params scene;
+    unsigned               iterations = 0;
+    size_t                 objects    = 0;
+    size_t                 aoa_bytes  = 0;
+    size_t                 aod_bytes  = 0;
+    vector<phase_report>   phases;
+    double                 peak_rss_mb = 0;
+
+    REFL_INNER(benchmark_report)
+        REFL_ENTRY(scene)
+        REFL_ENTRY(iterations)
+        REFL_ENTRY(objects)
+        REFL_ENTRY(aoa_bytes)
+        REFL_ENTRY(aod_bytes)
+        REFL_ENTRY(phases)
+        REFL_ENTRY(peak_rss_mb)
+    REFL_END()
+};
+
+double peak_rss_mb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return double(counters.PeakWorkingSetSize) / (1024 * 1024);
+#else
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    // kilobytes on linux
+    return double(usage.ru_maxrss) / 1024;
+#endif
+}
+
+// accumulates the durations of a phase over iterations
+struct phase_timer
+{
+    string         name;
+    vector<double> seconds;
+
+    void run(std::function<void()> const& f)
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        f();
+        seconds.push_back(osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()));
+    }
+
+    phase_report report(size_t bytes, size_t objects) const
+    {
+        phase_report result;
+        result.name = name;
+        result.best_s = *std::min_element(seconds.begin(), seconds.end());
+
+        for(auto s : seconds)
+            result.mean_s += s;
+        result.mean_s /= seconds.size();
+
+        if(result.best_s > 0)
+        {
+            result.mb_per_s = double(bytes) / (1024 * 1024) / result.best_s;
+            result.objects_per_s = double(objects) / result.best_s;
+        }
+        return result;
+    }
+};
+
+size_t file_size(fs::path const& path)
+{
+    boost::system::error_code ec;
+    auto size = fs::file_size(path, ec);
+    return ec ? 0 : size_t(size);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    synthetic_scene_params scene_params;
+    arguments.read("--meshes", scene_params.mesh_count);
+    arguments.read("--depth", scene_params.depth);
+    arguments.read("--lods", scene_params.lods);
+    arguments.read("--vertices", scene_params.vertices);
+    arguments.read("--vertex-format", scene_params.vertex_format);
+    arguments.read("--materials", scene_params.material_count);
+    arguments.read("--lights", scene_params.light_count);
+    arguments.read("--seed", scene_params.seed);
+    scene_params.draw_arrays = arguments.read("--draw-arrays");
+
+    unsigned iterations = 3;
+    arguments.read("--iterations", iterations);
+    iterations = std::max(iterations, 1u);
+
+    string config_path = "aoa.config.json";
+    string materials_file;
+    string output_dir = "aoa_bench_output";
+    string json_path;
+    arguments.read("--config", config_path);
+    arguments.read("--materials-file", materials_file);
+    arguments.read("--output", output_dir);
+    arguments.read("--json", json_path);
+
+    try
+    {
+        auto& config = get_config(config_path);
+        material_loader mat_loader(materials_file);
+
+        fs::create_directories(output_dir);
+        auto aoa_path = fs::absolute(fs::path(output_dir) / "synthetic.aoa");
+
+        phase_timer fix_materials    { "fix_materials_visitor" };
+        phase_timer generate_lights  { "lights_generation_visitor" };
+        phase_timer flatten          { "flatten_transforms" };
+        phase_timer write_visitor    { "write_aoa_visitor" };
+        phase_timer save_data        { "aoa_writer::save_data" };
+        phase_timer read             { "read_aoa" };
+        phase_timer convert          { "aoa_to_osg" };
+
+        size_t objects = 0;
+        for(unsigned i = 0; i < iterations; ++i)
+        {
+            // the write passes modify the scene, so every iteration starts from a fresh one
+            osg::ref_ptr<osg::Node> scene = generate_synthetic_scene(scene_params);
+            objects = count_scene_objects(*scene);
+
+            osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(config.get_full_transform());
+            transform->addChild(scene);
+            osg::Node& osg_root = *transform;
+
+            aoa_writer file_writer(aoa_path.string());
+
+            fix_materials.run([&]()
+            {
+                fix_materials_visitor v(mat_loader, fs::path(materials_file).parent_path().string());
+                osg_root.accept(v);
+            });
+
+            generate_lights.run([&]()
+            {
+                lights_generation_visitor v(file_writer);
+                osg_root.accept(v);
+                v.generate_lights();
+            });
+
+            flatten.run([&]() { flatten_transforms(osg_root, config.index_mesh); });
+
+            write_aoa_visitor write_aoa_v(mat_loader, file_writer);
+            write_visitor.run([&]()
+            {
+                osg_root.accept(write_aoa_v);
+                write_aoa_v.finish_root_node();
+            });
+
+            save_data.run([&]() { file_writer.save_data(); });
+
+            read.run([&]()
+            {
+                auto aoa = read_aoa(aoa_path.string());
+                if(aoa.nodes.empty())
+                    throw std::runtime_error("no nodes read back from " + aoa_path.string());
+            });
+
+            convert.run([&]()
+            {
+                if(!aoa_to_osg(aoa_path.string()))
+                    throw std::runtime_error("failed to convert " + aoa_path.string());
+            });
+        }
+
+        benchmark_report report;
+        report.scene      = scene_params;
+        report.iterations = iterations;
+        report.objects    = objects;
+        report.aoa_bytes  = file_size(aoa_path);
+        report.aod_bytes  = file_size(fs::path(aoa_path).replace_extension("aod"));
+
+        size_t total_bytes = report.aoa_bytes + report.aod_bytes;
+        for(auto const* phase : { &fix_materials, &generate_lights, &flatten, &write_visitor, &save_data })
+            report.phases.push_back(phase->report(total_bytes, objects));
+        // only the text part is parsed by read_aoa
+        report.phases.push_back(read.report(report.aoa_bytes, objects));
+        report.phases.push_back(convert.report(total_bytes, objects));
+
+        report.peak_rss_mb = peak_rss_mb();
+
+        if(json_path.empty())
+        {
+            json_io::data_to_stream(std::cout, report, true);
+            std::cout << std::endl;
+        }
+        else
+        {
+            std::ofstream out(json_path);
+            json_io::data_to_stream(out, report, true);
+        }
+    }
+    catch(std::exception const& e)
+    {
+        std::cerr << "aoa_roundtrip_bench: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Microbenchmark for the vertex attribute decode kernels (attribute_decode.h).
+// Decodes a synthetic interleaved vertex stream with every kernel and reports vertices per second
+// for the scalar fallback and the batch path.
+//
+// usage: aoa_attribute_decode_bench [--vertices N] [--iterations N]
+
+#include "attribute_decode.h"
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <functional>
+
+using namespace aurora;
+
+namespace
+{
+
+// position (float3), normal (10_10_10_2), uv (half2), color (half4), tangent (10_10_10_2)
+constexpr unsigned position_offset = 0;
+constexpr unsigned normal_offset   = 12;
+constexpr unsigned uv_offset       = 16;
+constexpr unsigned color_offset    = 20;
+constexpr unsigned tangent_offset  = 28;
+constexpr unsigned vertex_stride   = 32;
+
+using kernel_t = std::function<void(const char*, size_t, unsigned, float*)>;
+
+double run(kernel_t const& kernel, const char* src, size_t count, unsigned stride, float* dst, unsigned iterations)
+{
+    // warm up caches and page in the destination
+    kernel(src, count, stride, dst);
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for(unsigned i = 0; i < iterations; ++i)
+        kernel(src, count, stride, dst);
+    double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    return double(count) * iterations / seconds;
+}
+
+void report(std::string const& name, double scalar_vps, double batch_vps)
+{
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(1) << scalar_vps / 1e6 << " Mvert/s"
+              << std::setw(14) << batch_vps / 1e6 << " Mvert/s"
+              << std::setw(10) << std::setprecision(2) << batch_vps / scalar_vps << "x" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    unsigned num_vertices = 1 << 20;
+    unsigned iterations = 50;
+    arguments.read("--vertices", num_vertices);
+    arguments.read("--iterations", iterations);
+
+    std::vector<char> interleaved(size_t(num_vertices) * vertex_stride);
+    std::vector<char> packed_positions(size_t(num_vertices) * 3 * sizeof(float));
+    std::vector<float> out(size_t(num_vertices) * 4 + 1);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+    for(size_t i = 0; i < num_vertices; ++i)
+    {
+        char* v = interleaved.data() + i * vertex_stride;
+        for(unsigned j = 0; j < 3; ++j)
+        {
+            float f = dist(rng);
+            memcpy(v + position_offset + j * sizeof(float), &f, sizeof(f));
+        }
+        for(unsigned j = 0; j < 6; ++j)
+        {
+            uint16_t h = uint16_t(Packed::ToPacked<F16_M_BITS, F16_E_BITS, F16_S_MASK>(dist(rng) * 0.001f));
+            memcpy(v + uv_offset + j * sizeof(uint16_t), &h, sizeof(h));
+        }
+        uint32_t n = rng(), t = rng();
+        memcpy(v + normal_offset, &n, sizeof(n));
+        memcpy(v + tangent_offset, &t, sizeof(t));
+        memcpy(packed_positions.data() + i * 3 * sizeof(float), v + position_offset, 3 * sizeof(float));
+    }
+
+    std::cout << num_vertices << " vertices, stride " << vertex_stride << " bytes, " << iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(24) << "attribute" << std::right << std::setw(22) << "scalar" << std::setw(22) << "batch" << std::setw(11) << "speedup" << std::endl;
+
+    const char* base = interleaved.data();
+
+    report("float3 (interleaved)",
+        run([](const char* s, size_t c, unsigned st, float* d) { attribute_decode::scalar::copy<float, 3>(s, c, st, d); }, base + position_offset, num_vertices, vertex_stride, out.data(), iterations),
+        run([](const char* s, size_t c, unsigned st, float* d) { attribute_decode::copy<float, 3>(s, c, st, d); }, base + position_offset, num_vertices, vertex_stride, out.data(), iterations));
+
+    report("float3 (packed)",
+        run([](const char* s, size_t c, unsigned st, float* d) { attribute_decode::scalar::copy<float, 3>(s, c, st, d); }, packed_positions.data(), num_vertices, 3 * sizeof(float), out.data(), iterations),
+        run([](const char* s, size_t c, unsigned st, float* d) { attribute_decode::copy<float, 3>(s, c, st, d); }, packed_positions.data(), num_vertices, 3 * sizeof(float), out.data(), iterations));
+
+    report("half2",
+        run(attribute_decode::scalar::half_to_float<2>, base + uv_offset, num_vertices, vertex_stride, out.data(), iterations),
+        run(attribute_decode::half_to_float<2>, base + uv_offset, num_vertices, vertex_stride, out.data(), iterations));
+
+    report("half4",
+        run(attribute_decode::scalar::half_to_float<4>, base + color_offset, num_vertices, vertex_stride, out.data(), iterations),
+        run(attribute_decode::half_to_float<4>, base + color_offset, num_vertices, vertex_stride, out.data(), iterations));
+
+    report("10_10_10_2",
+        run(attribute_decode::scalar::unpack_10_10_10_2, base + normal_offset, num_vertices, vertex_stride, out.data(), iterations),
+        run(attribute_decode::unpack_10_10_10_2, base + normal_offset, num_vertices, vertex_stride, out.data(), iterations));
+
+    return 0;
+}
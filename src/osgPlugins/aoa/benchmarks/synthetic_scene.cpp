@@ -0,0 +1,253 @@
+#include "synthetic_scene.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/LOD>
+#include <osg/Material>
+#include <osg/MatrixTransform>
+#include <osg/Texture2D>
+
+#include <cmath>
+#include <random>
+#include <type_traits>
+
+namespace aurora
+{
+
+namespace
+{
+
+struct scene_builder
+{
+    explicit scene_builder(synthetic_scene_params const& params)
+        : params_(params)
+        , rng_(params.seed)
+        , has_normals_(params.vertex_format.find('n') != string::npos)
+        , has_texcoords_(params.vertex_format.find('t') != string::npos)
+        , has_colors_(params.vertex_format.find('c') != string::npos)
+    {
+        for(unsigned i = 0; i < std::max(params.material_count, 1u); ++i)
+            state_sets_.push_back(create_state_set(i));
+    }
+
+    osg::ref_ptr<osg::Node> build()
+    {
+        // the lights generation rules match paths below a node named like the source fbx
+        osg::ref_ptr<osg::Group> root = new osg::Group;
+        root->setName("synthetic.fbx");
+
+        unsigned lods = std::max(params_.lods, 1u);
+        unsigned objects = params_.mesh_count / lods;
+        for(unsigned i = 0; i < objects; ++i)
+        {
+            osg::Group* parent = root.get();
+            for(unsigned d = 0; d < params_.depth; ++d)
+            {
+                osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(random_transform());
+                transform->setName("transform_" + std::to_string(i) + "_" + std::to_string(d));
+                parent->addChild(transform);
+                parent = transform.get();
+            }
+
+            parent->addChild(create_object(i, lods));
+        }
+
+        if(params_.light_count > 0)
+            root->addChild(create_lights());
+
+        return root;
+    }
+
+private:
+    osg::Matrix random_transform()
+    {
+        std::uniform_real_distribution<float> offset(-100.f, 100.f);
+        std::uniform_real_distribution<float> angle(0.f, float(osg::PI) * 2.f);
+
+        return osg::Matrix::rotate(angle(rng_), osg::Z_AXIS) * osg::Matrix::translate(offset(rng_), offset(rng_), offset(rng_) * 0.1f);
+    }
+
+    osg::ref_ptr<osg::StateSet> create_state_set(unsigned index)
+    {
+        osg::ref_ptr<osg::Material> material = new osg::Material;
+        material->setName("synthetic_material_" + std::to_string(index));
+
+        // only the file name is used by the writer, pixels are never read
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->setFileName("synthetic_" + std::to_string(index) + ".dds");
+
+        osg::ref_ptr<osg::StateSet> state_set = new osg::StateSet;
+        state_set->setAttribute(material);
+        state_set->setTextureAttributeAndModes(0, new osg::Texture2D(image));
+        return state_set;
+    }
+
+    osg::ref_ptr<osg::Node> create_object(unsigned index, unsigned lods)
+    {
+        string name = "object_" + std::to_string(index);
+
+        if(lods == 1)
+            return create_mesh(name, params_.vertices, index);
+
+        osg::ref_ptr<osg::LOD> lod = new osg::LOD;
+        lod->setName(name);
+
+        unsigned vertices = params_.vertices;
+        float range = 0.f;
+        for(unsigned l = 0; l < lods; ++l)
+        {
+            float next_range = l + 1 == lods ? 1e5f : range + 250.f * (l + 1);
+            lod->addChild(create_mesh(name + "_lod" + std::to_string(l), vertices, index), range, next_range);
+            range = next_range;
+            vertices = std::max(vertices / 4, 4u);
+        }
+
+        return lod;
+    }
+
+    // side x side grid of vertices with a random height field
+    osg::ref_ptr<osg::Geode> create_mesh(string const& name, unsigned vertices, unsigned material_index)
+    {
+        unsigned side = std::max(unsigned(std::sqrt(float(vertices))), 2u);
+        std::uniform_real_distribution<float> height(-1.f, 1.f);
+
+        osg::ref_ptr<osg::Vec3Array> positions = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> normals   = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;
+        osg::ref_ptr<osg::Vec4Array> colors    = new osg::Vec4Array;
+
+        for(unsigned y = 0; y < side; ++y)
+        {
+            for(unsigned x = 0; x < side; ++x)
+            {
+                float u = float(x) / (side - 1), v = float(y) / (side - 1);
+                positions->push_back(osg::Vec3(u * 10.f, v * 10.f, height(rng_)));
+                normals->push_back(osg::Vec3(0.f, 0.f, 1.f));
+                texcoords->push_back(osg::Vec2(u, v));
+                colors->push_back(osg::Vec4(u, v, 1.f, 1.f));
+            }
+        }
+
+        vector<unsigned> indices;
+        for(unsigned y = 0; y + 1 < side; ++y)
+        {
+            for(unsigned x = 0; x + 1 < side; ++x)
+            {
+                unsigned i = y * side + x;
+                unsigned quad[] = { i, i + 1, i + side + 1, i, i + side + 1, i + side };
+                indices.insert(indices.end(), std::begin(quad), std::end(quad));
+            }
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setName(name);
+        geometry->setStateSet(state_sets_[material_index % state_sets_.size()].get());
+
+        if(params_.draw_arrays)
+        {
+            // unshared vertices, INDEX_MESH of the write path merges them back
+            auto expand = [&indices](auto const& src)
+            {
+                osg::ref_ptr<std::decay_t<decltype(*src)>> dst = new std::decay_t<decltype(*src)>;
+                for(auto i : indices)
+                    dst->push_back((*src)[i]);
+                return dst;
+            };
+
+            positions = expand(positions);
+            normals   = expand(normals);
+            texcoords = expand(texcoords);
+            colors    = expand(colors);
+
+            geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, GLsizei(indices.size())));
+        }
+        else if(positions->size() <= 0xffff)
+        {
+            geometry->addPrimitiveSet(new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLES, indices.begin(), indices.end()));
+        }
+        else
+        {
+            geometry->addPrimitiveSet(new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, indices.begin(), indices.end()));
+        }
+
+        geometry->setVertexArray(positions);
+        if(has_normals_)
+            geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+        if(has_texcoords_)
+            geometry->setTexCoordArray(0, texcoords, osg::Array::BIND_PER_VERTEX);
+        if(has_colors_)
+            geometry->setColorArray(colors, osg::Array::BIND_PER_VERTEX);
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->setName(name);
+        geode->addDrawable(geometry);
+        return geode;
+    }
+
+    // VPP01 / osevie / PRIBLIG_light / <light>, each light is a transform and a geode with the same name
+    osg::ref_ptr<osg::Node> create_lights()
+    {
+        osg::ref_ptr<osg::Group> runway = new osg::Group;
+        runway->setName("VPP01");
+        osg::ref_ptr<osg::Group> center = new osg::Group;
+        center->setName("osevie");
+        osg::ref_ptr<osg::Group> lights = new osg::Group;
+        lights->setName("PRIBLIG_light");
+
+        runway->addChild(center);
+        center->addChild(lights);
+
+        for(unsigned i = 0; i < params_.light_count; ++i)
+        {
+            string name = "light_" + std::to_string(i);
+
+            osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(osg::Matrix::translate(0.f, i * 15.f, 0.f));
+            transform->setName(name);
+
+            auto geode = create_mesh(name, 4, 0);
+            transform->addChild(geode);
+            lights->addChild(transform);
+        }
+
+        return runway;
+    }
+
+private:
+    synthetic_scene_params const&       params_;
+    std::mt19937                        rng_;
+    bool                                has_normals_;
+    bool                                has_texcoords_;
+    bool                                has_colors_;
+    vector<osg::ref_ptr<osg::StateSet>> state_sets_;
+};
+
+struct count_objects_visitor : osg::NodeVisitor
+{
+    count_objects_visitor()
+        : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {}
+
+    void apply(osg::Node& node) override
+    {
+        count++;
+        traverse(node);
+    }
+
+    size_t count = 0;
+};
+
+}
+
+osg::ref_ptr<osg::Node> generate_synthetic_scene(synthetic_scene_params const& params)
+{
+    return scene_builder(params).build();
+}
+
+size_t count_scene_objects(osg::Node& root)
+{
+    count_objects_visitor v;
+    root.accept(v);
+    return v.count;
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "json_io.h"
+
+#include <osg/Node>
+
+namespace aurora
+{
+
+// Shape of a generated scene. Every mesh is a tessellated grid under a chain of MatrixTransforms,
+// so the write path has transforms to flatten, materials to resolve and LODs to convert like a real export.
+struct synthetic_scene_params
+{
+    // meshes (geodes), each LOD level counts as a separate mesh
+    unsigned mesh_count     = 1000;
+    // MatrixTransforms between the root and a mesh
+    unsigned depth          = 4;
+    // levels of osg::LOD per object, 1 - no LOD nodes
+    unsigned lods           = 1;
+    // vertices of the finest level, coarser levels get a quarter each
+    unsigned vertices       = 1024;
+    // p - position, n - normal, t - texcoord, c - color
+    string   vertex_format  = "pnt";
+    // triangles as DrawArrays, to be indexed by the optimizer
+    bool     draw_arrays    = false;
+    // distinct osg::Materials with a texture each
+    unsigned material_count = 16;
+    // runway light geodes matched by the "AV_RUNWAY01" rules of the default aoa.config.json
+    unsigned light_count    = 0;
+    unsigned seed           = 42;
+
+    REFL_INNER(synthetic_scene_params)
+        REFL_ENTRY(mesh_count)
+        REFL_ENTRY(depth)
+        REFL_ENTRY(lods)
+        REFL_ENTRY(vertices)
+        REFL_ENTRY(vertex_format)
+        REFL_ENTRY(draw_arrays)
+        REFL_ENTRY(material_count)
+        REFL_ENTRY(light_count)
+        REFL_ENTRY(seed)
+    REFL_END()
+};
+
+osg::ref_ptr<osg::Node> generate_synthetic_scene(synthetic_scene_params const& params);
+
+// nodes and drawables of the subgraph
+size_t count_scene_objects(osg::Node& root);
+
+}
@@ -1,8 +1,36 @@
 #pragma once
 
+namespace osgDB
+{
+class Options;
+}
+
 namespace aurora
 {
 
-osg::ref_ptr<osg::Node> aoa_to_osg(string const& path);
+struct phase_stats;
+
+// node mask of the collision proxies. Intersection visitors whose traversal mask includes it (the default one does)
+// test the proxy instead of the visual geometry of nodes that have one, a mask without it tests the visual geometry only.
+// Meshes of nodes without a collision volume are always tested.
+const unsigned collision_proxy_node_mask = 0x00100000;
+
+struct read_options
+{
+    // CONTROL_LOD nodes are converted to osg::PagedLOD, their levels are read by the DatabasePager
+    // from "<aoa path>.<node name>.aoalod" pseudo files when they come into range
+    bool paged_lods        = false;
+    // collision meshes are converted to hidden KdTree-accelerated geometry masked with collision_proxy_node_mask
+    bool collision_proxies = false;
+    // open_document and convert phases are recorded here if set
+    phase_stats* stats     = nullptr;
+    // options of the read, paged LOD levels are read with a copy of them (plugin data included)
+    osgDB::Options const* db_options = nullptr;
+};
+
+osg::ref_ptr<osg::Node> aoa_to_osg(string const& path, read_options const& options = read_options());
+
+// reads the subgraph of a single paged LOD level
+osg::ref_ptr<osg::Node> aoa_lod_to_osg(string const& pseudo_file_name, read_options const& options = read_options());
 
-}
\ No newline at end of file
+}
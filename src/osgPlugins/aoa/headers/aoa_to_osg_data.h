@@ -2,6 +2,7 @@
 
 #include "aurora_format.h"
 #include "packed.h"
+#include "attribute_decode.h"
 #include "geometry/half.h"
 #include <osg/Array>
 
@@ -40,21 +41,10 @@ struct simple_array_to_osg
     template<class It>
     osg::ref_ptr<osg::Array> operator()(It b, It e, unsigned offset, unsigned stride)
     {
-        using raw_data_type = Type (*)[Size];
         auto len = std::distance(b, e) / stride;
         auto result = create_osg_array<Type, Size>(len);
-        auto result_data = (raw_data_type)(result->getDataPointer());
-        std::advance(b, offset);
-        //unsigned i = 0;
-        for(unsigned i = 0; i < len; std::advance(b, std::min(stride, unsigned(std::distance(b, e)))), i++)
-        {
-            const Type* val = reinterpret_cast<const Type*>(&(*b));
-            for(unsigned j = 0; j < Size; j++)
-            {
-                result_data[i][j] = val[j];
-            }
-        }
-        //assert(i == result->getNumElements());
+        if(len > 0)
+            attribute_decode::copy<Type, Size>(&(*b) + offset, len, stride, (Type*)(result->getDataPointer()));
         return result;
     }
 };
@@ -65,20 +55,10 @@ struct half_array_to_osg
     template<class It>
     osg::ref_ptr<osg::Array> operator()(It b, It e, unsigned offset, unsigned stride)
     {
-        using raw_data_type = float(*)[Size];
-        auto result = create_osg_array<float, Size>(std::distance(b, e) / stride);
-        auto result_data = (raw_data_type)(result->getDataPointer());
-        std::advance(b, offset);
-        unsigned i = 0;
-        for(; b < e; std::advance(b, std::min(stride, unsigned(std::distance(b, e)))), i++)
-        {
-            const geom::half* val = reinterpret_cast<const geom::half*>(&(*b));
-            for(unsigned j = 0; j < Size; j++)
-            {
-                result_data[i][j] = val[j];
-            }
-        }
-        assert(i == result->getNumElements());
+        auto len = std::distance(b, e) / stride;
+        auto result = create_osg_array<float, Size>(len);
+        if(len > 0)
+            attribute_decode::half_to_float<Size>(&(*b) + offset, len, stride, (float*)(result->getDataPointer()));
         return result;
     }
 };
@@ -87,17 +67,9 @@ template<class It>
 osg::ref_ptr<osg::Array> uint_10_10_10_2_to_osg(It b, It e, unsigned offset, unsigned stride)
 {
     auto len = std::distance(b, e) / stride;
-    auto result = new osg::Vec3Array(len);
-    std::advance(b, offset);
-    for(unsigned i = 0; i < len; std::advance(b, std::min(stride, unsigned(std::distance(b,e)))), i++)
-    {
-        unsigned val = *reinterpret_cast<const unsigned*>(&(*b));
-        Packed::float4 unpacked = Packed::int_to_sf4<10, 10, 10, 2>(val);
-        (*result)[i][0] = unpacked.v[0];
-        (*result)[i][1] = unpacked.v[1];
-        (*result)[i][2] = unpacked.v[2];
-    }
-    //assert(i == result->getNumElements());
+    osg::ref_ptr<osg::Vec3Array> result = new osg::Vec3Array(len);
+    if(len > 0)
+        attribute_decode::unpack_10_10_10_2(&(*b) + offset, len, stride, (float*)(result->getDataPointer()));
     return result;
 }
 
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "packed.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Batch decode kernels for interleaved vertex streams of the aod data buffer.
+// Every kernel takes a pointer to the first element of the attribute, number of vertices
+// and the vertex stride in bytes, and writes tightly packed floats (or Type) to dst.
+
+namespace aurora
+{
+namespace attribute_decode
+{
+
+// number of vertices gathered into the staging buffer at once
+constexpr size_t batch_size = 256;
+
+inline uint32_t load_u32(const char* src)
+{
+    uint32_t result;
+    memcpy(&result, src, sizeof(result));
+    return result;
+}
+
+namespace scalar
+{
+
+template<class Type, unsigned Size>
+void copy(const char* src, size_t count, unsigned stride, Type* dst)
+{
+    for(size_t i = 0; i < count; ++i, src += stride, dst += Size)
+    {
+        const Type* val = reinterpret_cast<const Type*>(src);
+        for(unsigned j = 0; j < Size; j++)
+            dst[j] = val[j];
+    }
+}
+
+template<unsigned Size>
+void half_to_float(const char* src, size_t count, unsigned stride, float* dst)
+{
+    for(size_t i = 0; i < count; ++i, src += stride, dst += Size)
+    {
+        const uint16_t* val = reinterpret_cast<const uint16_t*>(src);
+        for(unsigned j = 0; j < Size; j++)
+            dst[j] = Packed::FromPacked<F16_M_BITS, F16_E_BITS, F16_S_MASK>(val[j]);
+    }
+}
+
+// signed normalized 10_10_10_2, alpha is dropped
+inline void unpack_10_10_10_2(const char* src, size_t count, unsigned stride, float* dst)
+{
+    for(size_t i = 0; i < count; ++i, src += stride, dst += 3)
+    {
+        uint32_t p = load_u32(src);
+        dst[0] = std::max(float(int32_t(p << 22) >> 22) * (1.f / 511.f), -1.f);
+        dst[1] = std::max(float(int32_t(p << 12) >> 22) * (1.f / 511.f), -1.f);
+        dst[2] = std::max(float(int32_t(p <<  2) >> 22) * (1.f / 511.f), -1.f);
+    }
+}
+
+}
+
+// plain copy: one memcpy for tightly packed streams, fixed-size memcpy per vertex otherwise
+template<class Type, unsigned Size>
+void copy(const char* src, size_t count, unsigned stride, Type* dst)
+{
+    constexpr size_t vertex_size = Size * sizeof(Type);
+
+    if(stride == vertex_size)
+    {
+        memcpy(dst, src, count * vertex_size);
+        return;
+    }
+
+    for(size_t i = 0; i < count; ++i, src += stride, dst += Size)
+        memcpy(dst, src, vertex_size);
+}
+
+// gathers the halves of up to batch_size vertices into a staging buffer and converts them with F16C
+template<unsigned Size>
+void half_to_float(const char* src, size_t count, unsigned stride, float* dst)
+{
+#if( ENGINE_INTRINSIC >= ENGINE_INTRINSIC_AVX1 )
+
+    constexpr size_t vertex_size = Size * sizeof(uint16_t);
+    alignas(ENGINE_ALIGN_CPU) uint16_t staging[batch_size * Size];
+
+    while(count > 0)
+    {
+        size_t n = std::min(count, batch_size);
+        size_t num_halves = n * Size;
+
+        const uint16_t* halves = staging;
+        if(stride == vertex_size)
+        {
+            halves = reinterpret_cast<const uint16_t*>(src);
+        }
+        else
+        {
+            const char* s = src;
+            for(size_t i = 0; i < n; ++i, s += stride)
+                memcpy(staging + i * Size, s, vertex_size);
+        }
+
+        size_t k = 0;
+        for(; k + 8 <= num_halves; k += 8)
+            _mm256_storeu_ps(dst + k, _mm256_cvtph_ps(_mm_loadu_si128((const v4i*)(halves + k))));
+
+        for(; k < num_halves; ++k)
+            dst[k] = Packed::FromPacked<F16_M_BITS, F16_E_BITS, F16_S_MASK>(halves[k]);
+
+        src   += n * stride;
+        dst   += num_halves;
+        count -= n;
+    }
+
+#else
+
+    scalar::half_to_float<Size>(src, count, stride, dst);
+
+#endif
+}
+
+// unpacks four vertices per iteration, all three channels are sign-extended in vector registers
+inline void unpack_10_10_10_2(const char* src, size_t count, unsigned stride, float* dst)
+{
+    const v4f scale     = _mm_set1_ps(1.0f / 511.0f);
+    const v4f min_value = _mm_set1_ps(-1.0f);
+
+    size_t i = 0;
+
+    // every group writes one float past its last vertex (the w lane), so the last vertex is always left to the tail
+    for(; i + 4 < count; i += 4, src += 4 * stride, dst += 12)
+    {
+        v4i p = _mm_setr_epi32(load_u32(src), load_u32(src + stride), load_u32(src + 2 * stride), load_u32(src + 3 * stride));
+
+        v4f x = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(p, 22), 22)), scale), min_value);
+        v4f y = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(p, 12), 22)), scale), min_value);
+        v4f z = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(p,  2), 22)), scale), min_value);
+        v4f w = _mm_setzero_ps();
+
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        // stores overlap by one float, each one fixes the w lane written by the previous one
+        _mm_storeu_ps(dst + 0, x);
+        _mm_storeu_ps(dst + 3, y);
+        _mm_storeu_ps(dst + 6, z);
+        _mm_storeu_ps(dst + 9, w);
+    }
+
+    scalar::unpack_10_10_10_2(src, count - i, stride, dst);
+}
+
+}
+}
@@ -1,9 +1,17 @@
 #pragma once
 #include "aurora_format.h"
+#include "tree.h"
 
 namespace aurora
 {
 
+using dict_t = ::tree;
+
+// tokenizes the text of an aoa file into a tree of #FIELD keys and values
+dict_t aoa_to_dict(std::istream& in);
+dict_t aoa_to_dict(std::string const& path);
+
+refl::aurora_format dict_to_aoa(dict_t const& aoa_dict);
 refl::aurora_format read_aoa(std::string const& path);
 
 }
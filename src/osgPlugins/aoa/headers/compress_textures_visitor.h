@@ -0,0 +1,31 @@
+#pragma once
+
+#include <osg/NodeVisitor>
+#include <osg/Image>
+
+namespace aurora
+{
+
+// CPU texture stage of the export: collects the images of all textures, generates mipmaps,
+// compresses them to BC1/BC3/BC5 on a pool of threads and writes them as DDS named by content hash,
+// so an image shared by several objects (or loaded twice from different files) is processed once.
+struct compress_textures_visitor: osg::NodeVisitor
+{
+    compress_textures_visitor()
+        : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {}
+
+    virtual void apply(osg::Node& node) override;
+
+    // file names of the processed images are replaced by the names of the written files (relative to dir),
+    // returns the number of written textures
+    size_t write(string const& dir, unsigned num_threads);
+
+private:
+    void apply(osg::StateSet& stateset);
+
+    // image -> texture unit it was first found on
+    std::map<osg::ref_ptr<osg::Image>, unsigned> images_;
+};
+
+}
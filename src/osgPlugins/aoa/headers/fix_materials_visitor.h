@@ -13,6 +13,9 @@ struct fix_materials_visitor: osg::NodeVisitor
 
     void apply(osg::Geometry& g) override;
 
+    // geometries with a material
+    size_t material_count() const;
+
 private:
     struct impl;
     std::unique_ptr<impl> pimpl_;
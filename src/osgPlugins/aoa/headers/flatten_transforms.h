@@ -0,0 +1,14 @@
+#pragma once
+#include <osg/Node>
+
+namespace aurora
+{
+
+struct phase_stats;
+
+// Bakes transforms into geometry before the scene is written: makes all transforms static,
+// drops transforms left without children and runs the optimizer (FLATTEN_STATIC_TRANSFORMS, INDEX_MESH on request).
+// The three steps are recorded as separate phases.
+void flatten_transforms(osg::Node& root, bool index_mesh, phase_stats* stats = nullptr);
+
+}
@@ -16,6 +16,8 @@ struct lights_generation_visitor: osg::NodeVisitor
 
     void apply(osg::Geode &geode);
     void generate_lights();
+    // light drawables found by apply()
+    size_t light_count() const;
 
 private:
     void remove_light_nodes();
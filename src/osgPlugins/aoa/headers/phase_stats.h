@@ -0,0 +1,73 @@
+#pragma once
+
+#include "json_io.h"
+
+#include <osg/Timer>
+
+namespace osgDB
+{
+class Options;
+}
+
+namespace aurora
+{
+
+// Wall time and item counts of the read and write phases of the plugin.
+// Items are what the phase works on: geometries, textures, light drawables, transforms, chunks, bytes.
+struct phase_stats
+{
+    struct phase
+    {
+        string name;
+        double seconds = 0;
+        size_t items   = 0;
+
+        REFL_INNER(phase)
+            REFL_ENTRY(name)
+            REFL_ENTRY(seconds)
+            REFL_ENTRY(items)
+        REFL_END()
+    };
+
+    // "read" or "write"
+    string              operation;
+    string              file;
+    vector<phase>       phases;
+    // totals that do not belong to a single phase: faces, vertices, file sizes
+    map<string, size_t> counters;
+
+    double total_seconds() const;
+
+    REFL_INNER(phase_stats)
+        REFL_ENTRY(operation)
+        REFL_ENTRY(file)
+        REFL_ENTRY(phases)
+        REFL_ENTRY(counters)
+    REFL_END()
+};
+
+// Runs the phase and records it if stats are collected, f returns the number of processed items.
+template<typename F>
+void measure_phase(phase_stats* stats, string const& name, F&& f)
+{
+    if(!stats)
+    {
+        f();
+        return;
+    }
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    size_t items = f();
+    stats->phases.push_back({ name, osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()), items });
+}
+
+// Plugin data of osgDB::Options the stats are published to: a phase_stats_receiver*, kept alive by the caller.
+const char* const phase_stats_plugin_data = "aoaPhaseStats";
+
+// logs the stats with OSG_INFO and publishes them to the phase_stats_receiver of the options, if there is one
+void publish_phase_stats(phase_stats const& stats, osgDB::Options const* options);
+
+// json report, the same layout as phase_stats
+void write_phase_stats(phase_stats const& stats, string const& path);
+
+}
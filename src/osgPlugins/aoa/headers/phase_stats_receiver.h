@@ -0,0 +1,42 @@
+#pragma once
+
+#include <osg/Referenced>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace aurora
+{
+
+// Receives the stats of the reads and writes of the AOA plugin, set as the "aoaPhaseStats" plugin data of osgDB::Options.
+// The DatabasePager hands one Options to all its threads, so publish() may be called by several reads at once and locks;
+// derive and override publish() to forward the stats elsewhere. Header only, so applications can include it without
+// linking to the plugin.
+struct phase_stats_receiver : osg::Referenced
+{
+    // "<operation>.<phase>.seconds", "<operation>.<phase>.items", "<operation>.<counter>" and "<operation>.files",
+    // summed over all the reads and writes published so far
+    typedef std::map<std::string, double> values_t;
+
+    virtual void publish(values_t const& values)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto const& v : values)
+            values_[v.first] += v.second;
+    }
+
+    values_t values() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return values_;
+    }
+
+protected:
+    ~phase_stats_receiver() override {}
+
+    mutable std::mutex mutex_;
+    values_t           values_;
+};
+
+}
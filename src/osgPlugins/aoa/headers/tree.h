@@ -41,6 +41,11 @@ struct tree
         return children_.empty();
     }
 
+    std::multimap<key_t, tree> const& children() const
+    {
+        return children_;
+    }
+
 private:
     data_t data_;
     std::multimap<key_t, tree> children_;
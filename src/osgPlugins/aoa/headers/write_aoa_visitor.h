@@ -23,9 +23,16 @@ struct write_aoa_visitor : osg::NodeVisitor
     void apply(osg::LightSource& light_source) override;
     void apply(osg::LOD& lod) override;
 
+    // sets the bounds of the root node from the collected chunks
+    void finish_root_node();
+    // finish_root_node() and aoa_writer::save_data()
     void write_aoa();
     void write_debug_obj_file(string file_name) const;
 
+    size_t num_chunks()   const { return chunks_.size(); }
+    size_t num_faces()    const { return faces_.size(); }
+    size_t num_vertices() const { return verticies_.size(); }
+
 private:
     aoa_writer::node_ptr current_node() { return aoa_nodes_stack_.top(); }
     auto create_node_scope(osg::Node& n);
@@ -6,7 +6,6 @@
 #include <boost/tokenizer.hpp>
 
 #include <osg/Notify>
-#include <osg/NodeVisitor>
 #include <osg/MatrixTransform>
 
 #include <osgDB/Registry>
@@ -14,78 +13,37 @@
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
-#include <osgUtil/Optimizer>
-
 #include "write_aoa_visitor.h"
 #include "aurora_aoa_writer.h"
 #include "convert_textures_visitor.h"
+#include "compress_textures_visitor.h"
 #include "fix_materials_visitor.h"
 #include "lights_generation_visitor.h"
 #include "material_loader.h"
 #include "debug_utils.h"
 #include "plugin_config.h"
 #include "aoa_to_osg.h"
+#include "flatten_transforms.h"
+#include "phase_stats.h"
 
 #include <filesystem>
+#include <thread>
 
 using namespace aurora;
 
-struct make_transforms_static_visitor: osg::NodeVisitor
-{
-    make_transforms_static_visitor()
-        : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
-    {}
-
-
-    void apply(osg::Node& node) override
-    {
-        traverse(node);
-    }
-
-    void apply(osg::Transform& t) override
-    {
-        t.setDataVariance(osg::Object::DataVariance::STATIC);
-        traverse(t);
-    }
-};
-
-struct remove_hanging_transforms_visitor : osg::NodeVisitor
-{
-    remove_hanging_transforms_visitor()
-        : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
-    {}
-
-    void apply(osg::Group& n) override
-    {
-        if(n.getNumChildren() == 0)
-            nodes_to_remove_.insert(&n);
-        else 
-            traverse(n);
-    }
-
-    bool remove_hanging_transforms()
-    {
-        for(auto& t: nodes_to_remove_)
-        {
-            assert(t->getNumParents() == 1);
-            t->getParent(0)->removeChild(t.get());
-        }
-
-        bool sts = nodes_to_remove_.size() != 0;
-        nodes_to_remove_.clear();
-        return sts;
-    }
-
-private:
-    std::set<osg::ref_ptr<osg::Node>> nodes_to_remove_;
-};
-
 class ReaderWriterAOA : public osgDB::ReaderWriter
 {
 public:
     ReaderWriterAOA()
     {
         supportsExtension("aoa","Aurora engine format");
+        supportsExtension("aoalod","Aurora engine format: LOD level of an aoa file (pseudo loader for paged LODs)");
+        supportsOption("aoaPagedLOD", "(Read option) Import LODs as osg::PagedLOD, LOD levels are decoded by the DatabasePager when they come into range");
+        supportsOption("--aoa-compress-textures", "(Write option) Generate mipmaps and compress textures to BC1/BC3/BC5 DDS files named by content hash");
+        supportsOption("--aoa-texture-threads <n>", "(Write option) Number of threads used to compress textures, all cores by default");
+        supportsOption("--aoa-stats-report", "(Write option) Write per-phase timings and counters to <name>.write_stats.json next to the output");
+        supportsOption("aoaStatsReport", "(Read option) Write per-phase timings and counters to <name>.read_stats.json next to the input");
+        supportsOption("aoaCollisionProxies", "(Read option) Import collision meshes as hidden KdTree-accelerated geometry with node mask 0x00100000. Intersection visitors including this bit in their traversal mask, the default one included, test the proxies and skip the visual geometry of nodes that have them; clear the bit to test the visual geometry. Nodes without a collision volume keep their visual geometry for intersections");
         //supportsOption("scgConfig=<dir>","Path to config file");
         //supportsOption("noTesselateLargePolygons","Do not do the default tesselation of large polygons");
         //supportsOption("noTriStripPolygons","Do not do the default tri stripping of polygons");
@@ -104,22 +62,79 @@ public:
 
     const char* className() const override { return "Aurora engine AOA Writer"; }
 
-    ReadResult readNode(const std::string& file_name, const Options* /*options*/) const override
+    static bool has_option(const Options* options, std::string const& name)
+    {
+        if(!options)
+            return false;
+
+        std::istringstream iss(options->getOptionString());
+        std::string opt;
+        while(iss >> opt)
+        {
+            if(opt == name)
+                return true;
+        }
+        return false;
+    }
+
+    static size_t file_size(std::string const& path)
+    {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        return ec ? 0 : size_t(size);
+    }
+
+    static aurora::read_options read_options_from(const Options* options)
     {
-        if(!std::filesystem::exists(file_name))
+        aurora::read_options result;
+        result.paged_lods        = has_option(options, "aoaPagedLOD");
+        result.collision_proxies = has_option(options, "aoaCollisionProxies");
+        result.db_options        = options;
+        return result;
+    }
+
+    ReadResult readNode(const std::string& file_name, const Options* options) const override
+    {
+        std::string ext = osgDB::getLowerCaseFileExtension(file_name);
+        if(!acceptsExtension(ext))
+            return ReadResult(ReadResult::FILE_NOT_HANDLED);
+
+        phase_stats stats;
+        stats.operation = "read";
+        stats.file = file_name;
+
+        auto options_with_stats = read_options_from(options);
+        options_with_stats.stats = &stats;
+
+        osg::ref_ptr<osg::Node> osg_root;
+        if(ext == "aoalod")
+        {
+            osg_root = aurora::aoa_lod_to_osg(file_name, options_with_stats);
+            if(!osg_root) return ReadResult(ReadResult::FILE_NOT_FOUND);
+        }
+        else if(!std::filesystem::exists(file_name))
+        {
             return ReadResult(ReadResult::FILE_NOT_FOUND);
+        }
         else
         {
-            auto osg_root = aurora::aoa_to_osg(file_name);
+            osg_root = aurora::aoa_to_osg(std::filesystem::absolute(file_name).string(), options_with_stats);
             if(!osg_root) return osg_root;
 
             // convert all textures to some format
             //aurora::convert_textures_visitor texture_visitor("dds");
             //osg_root->accept(texture_visitor);
             //texture_visitor.write(osgDB::getFilePath(file_name));
+        }
 
-            return osg_root;
+        publish_phase_stats(stats, options);
+        if(has_option(options, "aoaStatsReport"))
+        {
+            // paged LOD levels get "<aoa path>.<node name>.read_stats.json"
+            write_phase_stats(stats, fs::path(file_name).replace_extension("read_stats.json").string());
         }
+
+        return osg_root;
     }
 
     ReadResult readNode(std::istream& /*fin*/, const Options* /*options*/) const override
@@ -190,39 +205,72 @@ public:
             OSG_INFO << "flip Y and Z: " << config.flip_YZ << "\n";
             //////////////////////////////////////////////
 
-            fix_materials_visitor fix_mats_vis(mat_loader, fs::path(materials_file).parent_path().string());
-            osg_root.accept(fix_mats_vis);
+            phase_stats stats;
+            stats.operation = "write";
+            stats.file = file_name;
+
+            measure_phase(&stats, "fix_materials", [&]()
+            {
+                fix_materials_visitor fix_mats_vis(mat_loader, fs::path(materials_file).parent_path().string());
+                osg_root.accept(fix_mats_vis);
+                return fix_mats_vis.material_count();
+            });
 
             // convert all textures to some format
             //aurora::convert_textures_visitor texture_visitor("dds");
             //osg_root.accept(texture_visitor);
             //texture_visitor.write(osgDB::getFilePath(file_name));
 
-            aurora::aoa_writer file_writer(file_name);
-            lights_generation_visitor generate_lights_v(file_writer);
-            osg_root.accept(generate_lights_v);
-            generate_lights_v.generate_lights();
+            // compress textures into the image folder the reader looks in, materials get the names of the compressed files
+            if(arguments.read("--aoa-compress-textures"))
+            {
+                unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+                arguments.read("--aoa-texture-threads", num_threads);
 
-            // apply transforms from ancestor nodes to geometry
-            // optimizer will only do this for transform nodes whose data variance is STATIC so we set it here 
-            make_transforms_static_visitor make_tranforms_static;
-            osg_root.accept(make_tranforms_static);
+                measure_phase(&stats, "compress_textures", [&]()
+                {
+                    aurora::compress_textures_visitor compress_textures_v;
+                    osg_root.accept(compress_textures_v);
+                    return compress_textures_v.write(fs::path(file_name).replace_extension("img").string(), num_threads);
+                });
+            }
 
-            // remove leaf Transform nodes because otherwise the optimizer will not be able to flatten all transforms properly
-            remove_hanging_transforms_visitor remove_hanging_tv;
-            
-            do osg_root.accept(remove_hanging_tv);
-            while(remove_hanging_tv.remove_hanging_transforms());
+            aurora::aoa_writer file_writer(file_name);
+            measure_phase(&stats, "lights_generation", [&]()
+            {
+                lights_generation_visitor generate_lights_v(file_writer);
+                osg_root.accept(generate_lights_v);
+                generate_lights_v.generate_lights();
+                return generate_lights_v.light_count();
+            });
 
-            // run the optimizer
-            osgUtil::Optimizer optimizer;
-            optimizer.optimize(&osg_root, osgUtil::Optimizer::FLATTEN_STATIC_TRANSFORMS | (config.index_mesh ? osgUtil::Optimizer::INDEX_MESH : 0));
+            flatten_transforms(osg_root, config.index_mesh, &stats);
 
             OSG_INFO << "Writing node to AOA file " << file_name << std::endl;
 
             aurora::write_aoa_visitor write_aoa_v(mat_loader, file_writer);
-            osg_root.accept(write_aoa_v);
-            write_aoa_v.write_aoa();
+            measure_phase(&stats, "collect_chunks", [&]()
+            {
+                osg_root.accept(write_aoa_v);
+                write_aoa_v.finish_root_node();
+                return write_aoa_v.num_chunks();
+            });
+
+            stats.counters["faces"]    = write_aoa_v.num_faces();
+            stats.counters["vertices"] = write_aoa_v.num_vertices();
+
+            // items are the written bytes
+            measure_phase(&stats, "save_data", [&]()
+            {
+                file_writer.save_data();
+                stats.counters["aoa_bytes"] = file_size(file_name);
+                stats.counters["aod_bytes"] = file_size(fs::path(file_name).replace_extension("aod").string());
+                return stats.counters["aoa_bytes"] + stats.counters["aod_bytes"];
+            });
+
+            publish_phase_stats(stats, options);
+            if(arguments.read("--aoa-stats-report"))
+                write_phase_stats(stats, fs::path(file_name).replace_extension("write_stats.json").string());
 
 
             // ======================= DEBUG OUTPUT ============================
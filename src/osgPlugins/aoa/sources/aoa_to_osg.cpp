@@ -1,17 +1,28 @@
 #include "aurora_format.h"
 #include "aurora_aoa_reader.h"
 #include "aoa_to_osg_data.h"
+#include "aoa_to_osg.h"
+#include "phase_stats.h"
 
 #include <osg/Group>
 #include <osg/Geometry>
+#include <osg/KdTree>
 #include <osg/LOD>
+#include <osg/PagedLOD>
+#include <osg/observer_ptr>
 #include <osg/PrimitiveSet>
 #include <osg/Texture2D>
 #include <osg/Texture3D>
 #include <osgDB/ReadFile>
+#include <osgDB/Options>
+#include <osgDB/FileNameUtils>
 #include <osg/TexEnvCombine>
 #include <filesystem>
 #include <optional>
+#include <mutex>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 using std::filesystem::path;
 
@@ -58,24 +69,208 @@ struct osg_node_cmp
     }
 };
 
+bool compareChar(char c1, char c2)
+{
+    if(c1 == c2)
+        return true;
+    else if(std::toupper(c1) == std::toupper(c2))
+        return true;
+    return false;
+}
+
+/*
+ * Case Insensitive String Comparision
+ */
+bool caseInSensStringCompare(std::string const& str1, std::string const&str2)
+{
+    return ((str1.size() == str2.size()) &&
+             std::equal(str1.begin(), str1.end(), str2.begin(), &compareChar));
+}
+
+// Parsed aoa description together with the memory mapped aod data buffer.
+// It is shared by the main read and by all paged LOD reads of the same file,
+// so the description is parsed once and buffer pages are only touched when a stream is decoded.
+struct aoa_document: osg::Referenced
+{
+    explicit aoa_document(string const& aoa_path)
+        : file_path(aoa_path)
+        , aoa(read_aoa(aoa_path))
+        , nodes(aoa.nodes.begin(), aoa.nodes.end())
+    {
+        root_name = std::filesystem::path(aoa_path).stem().string();
+
+        bool found = false;
+        for(auto const& n : nodes)
+        {
+            if(caseInSensStringCompare(n.name, root_name))
+            {
+                root_name = n.name;
+                found = true;
+                break;
+            }
+        }
+
+        assert(found);
+
+        auto buffer_path = path(aoa_path).parent_path() / string(aoa.buffer_data.data_buffer_file);
+        if(std::filesystem::exists(buffer_path) && std::filesystem::file_size(buffer_path) > 0)
+        {
+            using namespace boost::interprocess;
+            file_ = file_mapping(buffer_path.string().c_str(), read_only);
+            region_ = mapped_region(file_, read_only);
+        }
+    }
+
+    const char* data() const
+    {
+        return static_cast<const char*>(region_.get_address());
+    }
+
+    size_t size() const
+    {
+        return region_.get_size();
+    }
+
+    refl::node const& root_node() const
+    {
+        return *nodes.find(root_name);
+    }
+
+    // bounding box of all meshes below the node in the node's own frame, computed from the description only
+    osg::BoundingBox get_subtree_bbox(string const& name) const
+    {
+        osg::BoundingBox result;
+        auto it = nodes.find(name);
+        if(it == nodes.end())
+            return result;
+
+        if(it->mesh)
+        {
+            auto const& rect = it->mesh->bbox.rect;
+            result.expandBy(osg::Vec3(rect.lo().x, rect.lo().y, rect.lo().z));
+            result.expandBy(osg::Vec3(rect.hi().x, rect.hi().y, rect.hi().z));
+        }
+
+        for(auto const& c: it->children.children)
+        {
+            auto child_bbox = get_subtree_bbox(c);
+            if(!child_bbox.valid())
+                continue;
+
+            auto child = nodes.find(c);
+            osg::Matrix m = child != nodes.end() ? static_node_matrix(*child) : osg::Matrix();
+            for(unsigned i = 0; i < 8; ++i)
+                result.expandBy(child_bbox.corner(i) * m);
+        }
+
+        return result;
+    }
+
+    // placement of the node in its parent's frame, taken from the first keys of the position and rotation controllers
+    static osg::Matrix static_node_matrix(refl::node const& n)
+    {
+        osg::Matrix result;
+        if(n.controllers.control_rot && !n.controllers.control_rot->keys.empty())
+        {
+            auto const& [key, x, y, z, w] = n.controllers.control_rot->keys.front();
+            result.makeRotate(osg::Quat(x, y, z, w));
+        }
+        if(n.controllers.control_pos && !n.controllers.control_pos->keys.empty())
+        {
+            auto const& [key, x, y, z] = n.controllers.control_pos->keys.front();
+            result.postMultTranslate(osg::Vec3d(x, y, z));
+        }
+        return result;
+    }
+
+    string file_path;
+    refl::aurora_format aoa;
+    std::set<refl::node, node_cmp> nodes;
+    string root_name;
+
+private:
+    boost::interprocess::file_mapping  file_;
+    boost::interprocess::mapped_region region_;
+};
+
+osg::ref_ptr<aoa_document> get_aoa_document(string const& aoa_path)
+{
+    static std::mutex mutex;
+    static std::map<string, osg::observer_ptr<aoa_document>> documents;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    osg::ref_ptr<aoa_document> result;
+    auto it = documents.find(aoa_path);
+    if(it != documents.end() && it->second.lock(result))
+        return result;
+
+    result = new aoa_document(aoa_path);
+    documents[aoa_path] = result.get();
+    return result;
+}
+
+const char* const paged_lod_extension = "aoalod";
+
+// "<aoa path>.<node name>.aoalod"
+string paged_lod_file_name(string const& aoa_path, string const& node_name)
+{
+    return aoa_path + "." + node_name + "." + paged_lod_extension;
+}
+
+optional<pair<string, string>> parse_paged_lod_file_name(string const& file_name)
+{
+    string name = osgDB::getNameLessExtension(file_name);
+
+    string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return char(std::tolower(c)); });
+
+    auto pos = lower.rfind(".aoa.");
+    if(pos == string::npos)
+        return boost::none;
+
+    return pair<string, string>(name.substr(0, pos + 4), name.substr(pos + 5));
+}
+
 struct node_context
 {
-    node_context(string const& aoa_path, refl::aurora_format aoa, refl::node root_node, std::set<osg::ref_ptr<osg::Node>, osg_node_cmp>& osg_nodes)
-        : root_node_(root_node)
-        , data_buffer_description_(aoa.buffer_data)
-        , dirname_(path(aoa_path).parent_path())
-        , filename_(path(aoa_path).filename())
+    node_context(aoa_document const& doc, std::set<osg::ref_ptr<osg::Node>, osg_node_cmp>& osg_nodes, read_options const& options)
+        : document_(doc)
+        , root_node_(doc.root_node())
+        , data_buffer_description_(doc.aoa.buffer_data)
+        , dirname_(path(doc.file_path).parent_path())
+        , filename_(path(doc.file_path).filename())
+        , options_(options)
+        , data_buffer_(doc.data())
         , osg_nodes_(osg_nodes)
     {
-        std::ifstream buffer_file(dirname_ / string(aoa.buffer_data.data_buffer_file), std::ios_base::binary);
-        std::ostringstream ss;
-        ss << buffer_file.rdbuf();
-        auto content = ss.str();
+        assert(root_node_.controllers.object_param_controller);
+        shared_streams_ = root_node_.controllers.object_param_controller->buffer;
+    }
+
+    aoa_document const& document() const
+    {
+        return document_;
+    }
 
-        data_buffer_ = {content.begin(), content.end()};
+    read_options const& options() const
+    {
+        return options_;
+    }
+
+    bool paged_lods() const
+    {
+        return options_.paged_lods;
+    }
+
+    bool collision_proxies() const
+    {
+        return options_.collision_proxies;
+    }
 
-        build_vertex_arrays_cache(aoa);
-        build_stateset_cache(aoa);
+    bool has_collision_data() const
+    {
+        return shared_streams_.collision_stream && shared_streams_.collision_stream->vertex_offset_size.size > 0;
     }
 
     osg::ref_ptr<osg::Node> get_descendant_osg_node(string const& name) const
@@ -84,8 +279,12 @@ struct node_context
         return it != osg_nodes_.end() ? *it : nullptr;
     }
 
+    // streams are decoded on first use, so only the geometry actually referenced by converted nodes is touched
     osg::Array* get_stream_vertex_attr_array(unsigned stream, unsigned attr_num) const
     {
+        if(decoded_streams_.insert(stream).second)
+            decode_stream(stream);
+
         auto it = stream_attr_arrays_cache_.find(std::pair(stream, attr_num));
         return it != stream_attr_arrays_cache_.end() ? it->second.get() : nullptr;
     }
@@ -93,7 +292,10 @@ struct node_context
     osg::StateSet* get_material_stateset(string const& mat_name) const
     {
         auto it = stateset_cache_.find(mat_name);
-        return it != stateset_cache_.end() ? it->second.get() : nullptr;
+        if(it == stateset_cache_.end())
+            it = stateset_cache_.emplace(mat_name, create_material_stateset(mat_name)).first;
+
+        return it->second.get();
     }
 
     osg::ref_ptr<osg::DrawElements> get_mesh_draw_elements(unsigned vao, unsigned stream_id, unsigned offset, unsigned count, unsigned base_vertex) const
@@ -112,8 +314,8 @@ struct node_context
                 previous_streams_offset += stream.vertex_offset_size.size;
         }
 
-        auto b = data_buffer_.begin();
-        auto e = data_buffer_.begin();
+        auto b = data_buffer_;
+        auto e = data_buffer_;
 
         auto stream = shared_streams_.geometry_streams.at(stream_id);
         auto buf_chunk = data_buffer_description_.vaos.at(vao);
@@ -122,7 +324,14 @@ struct node_context
         auto [buffer_id, buffer_format] = get_buffer_format_by_vertex_offset(stream.vertex_offset_size.offset);
         assert(vao == buffer_id);
 
-        std::advance(b, data_buffer_description_.index_file_offset_size.offset);
+        size_t index_size = buf_chunk.vertex_format_offset.format <= std::numeric_limits<uint16_t>::max() ? sizeof(uint16_t) : sizeof(uint32_t);
+        if(!data_buffer_ || data_buffer_description_.index_file_offset_size.offset + (size_t(offset) + count) * index_size > document_.size())
+        {
+            OSG_WARN << "AOA plugin: indices of stream " << stream_id << " are out of the data buffer" << std::endl;
+            return new osg::DrawElementsUInt(GL_TRIANGLES);
+        }
+
+        std::advance(b,data_buffer_description_.index_file_offset_size.offset);
         std::advance(e, data_buffer_description_.index_file_offset_size.offset + stream.index_offset_size.size);
         auto result = elements_array_to_osg(b, e, buf_chunk.vertex_format_offset.format, offset, count, base_vertex - previous_streams_offset / stride);
         assert(result->getNumIndices() > 0);
@@ -181,76 +390,131 @@ struct node_context
         return {std::distance(data_buffer_description_.vaos.begin(), result), *result};
     }
 
-    void build_vertex_arrays_cache(refl::aurora_format aoa)
+    void decode_stream(unsigned stream_num) const
     {
-        auto const& root_node = root_node_;
-        assert(root_node.controllers.object_param_controller);
+        auto const& stream = shared_streams_.geometry_streams.at(stream_num);
+        auto [buffer_id, buffer_format] = get_buffer_format_by_vertex_offset(stream.vertex_offset_size.offset);
+
+        // vertex buffer offset + stream offset
+        size_t stream_begin = size_t(data_buffer_description_.vertex_file_offset_size.offset) + stream.vertex_offset_size.offset;
+        size_t stream_end   = stream_begin + stream.vertex_offset_size.size;
 
-        shared_streams_ = root_node.controllers.object_param_controller->buffer;
+        // a missing or truncated aod gives empty arrays rather than reads outside the mapping
+        bool in_buffer = data_buffer_ && stream_end <= document_.size();
+        if(!in_buffer)
+            OSG_WARN << "AOA plugin: stream " << stream_num << " is out of the data buffer" << std::endl;
 
-        unsigned stream_num = 0;
-        for(auto stream: root_node.controllers.object_param_controller->buffer.geometry_streams)
+        for(unsigned i = 0; i < buffer_format.format.attributes.size(); ++i)
         {
-            auto [buffer_id, buffer_format] = get_buffer_format_by_vertex_offset(stream.vertex_offset_size.offset);
-            for(unsigned i = 0; i < buffer_format.format.attributes.size(); ++i)
-            {
-                auto const a = buffer_format.format.attributes[i];
-                auto [offset, stride] = get_attribute_array_offset_stride(buffer_format, i);
-                auto b = data_buffer_.begin();
-                auto e = b;
-                // vertex buffer offset + stream offset + attribute offset
-                std::advance(b, data_buffer_description_.vertex_file_offset_size.offset + stream.vertex_offset_size.offset);
-                std::advance(e, data_buffer_description_.vertex_file_offset_size.offset + stream.vertex_offset_size.offset + stream.vertex_offset_size.size);
-                stream_attr_arrays_cache_.emplace(pair{stream_num, a.id}, attribute_array_to_osg(b, e, a.type, a.size, offset, stride));
-            } 
-            stream_num++;
+            auto const a = buffer_format.format.attributes[i];
+            auto [offset, stride] = get_attribute_array_offset_stride(buffer_format, i);
+            auto b = in_buffer ? data_buffer_ + stream_begin : data_buffer_;
+            auto e = in_buffer ? data_buffer_ + stream_end : data_buffer_;
+            stream_attr_arrays_cache_.emplace(pair{stream_num, a.id}, attribute_array_to_osg(b, e, a.type, a.size, offset, stride));
         }
     }
 
-    void build_stateset_cache(refl::aurora_format aoa)
+    // collision vertices and indices are addressed relative to the collision stream of the root node,
+    // indices are local to the mesh
+    osg::ref_ptr<osg::Geometry> get_collision_geometry(refl::node::controllers_t::control_collision_volume::cv_mesh const& mesh) const
     {
-        for(auto m: aoa.materials.list)
+        if(!has_collision_data() || !data_buffer_)
+            return nullptr;
+
+        auto const& col_stream = *shared_streams_.collision_stream;
+        auto const& buf_chunk = data_buffer_description_.vaos.at(mesh.vertex_vao_offset_size.format);
+        auto const& attributes = buf_chunk.format.attributes;
+
+        auto pos = std::find_if(attributes.begin(), attributes.end(), [](auto const& a) { return a.id == 0; });
+        if(pos == attributes.end())
+        {
+            OSG_WARN << "AOA plugin: collision mesh without positions" << std::endl;
+            return nullptr;
+        }
+
+        size_t vertex_begin = size_t(col_stream.vertex_offset_size.offset) + mesh.vertex_vao_offset_size.offset;
+        size_t vertex_end   = vertex_begin + mesh.vertex_vao_offset_size.size;
+        size_t index_begin  = size_t(col_stream.index_offset_size.offset) + mesh.index_offset_size.offset;
+        size_t index_end    = index_begin + mesh.index_offset_size.size;
+
+        if(vertex_end > document_.size() || index_end > document_.size())
+        {
+            OSG_WARN << "AOA plugin: collision mesh is out of the data buffer" << std::endl;
+            return nullptr;
+        }
+
+        auto [offset, stride] = get_attribute_array_offset_stride(buf_chunk, unsigned(std::distance(attributes.begin(), pos)));
+        osg::ref_ptr<osg::Vec3Array> vertices = dynamic_cast<osg::Vec3Array*>(
+            attribute_array_to_osg(data_buffer_ + vertex_begin, data_buffer_ + vertex_end, pos->type, pos->size, offset, stride).get());
+
+        if(!vertices || vertices->empty())
+            return nullptr;
+
+        unsigned num_indices = mesh.index_offset_size.size / sizeof(uint32_t);
+        num_indices -= num_indices % 3;
+
+        osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(GL_TRIANGLES, num_indices, reinterpret_cast<const GLuint*>(data_buffer_ + index_begin));
+        if(num_indices == 0 || *std::max_element(indices->begin(), indices->end()) >= vertices->size())
+        {
+            OSG_WARN << "AOA plugin: collision mesh has invalid indices" << std::endl;
+            return nullptr;
+        }
+
+        osg::ref_ptr<osg::Geometry> result = new osg::Geometry();
+        result->setVertexArray(vertices);
+        result->addPrimitiveSet(indices);
+        return result;
+    }
+
+    osg::ref_ptr<osg::StateSet> create_material_stateset(string const& mat_name) const
+    {
+        auto const& materials = document_.aoa.materials.list;
+        auto m = std::find_if(materials.begin(), materials.end(), [&mat_name](auto const& m) { return string(m.name) == mat_name; });
+        if(m == materials.end())
+            return nullptr;
+
+        osg::ref_ptr<osg::StateSet> ss = new osg::StateSet();
+
+        for(int i = 0; i < m->textures.size(); ++i)
         {
-            osg::ref_ptr<osg::StateSet> ss = new osg::StateSet();
+            auto mat_group = m->textures[i];
+            auto tex_name = (dirname_ / path(filename_).replace_extension("img") / string(mat_group.texture)).string();
+            auto read_result = osgDB::Registry::instance()->readObject(tex_name, nullptr);
 
-            for(int i = 0; i < m.textures.size(); ++i)
+            if(auto image = read_result.getImage())
             {
-                auto mat_group = m.textures[i];
-                auto tex_name = (dirname_ / filename_.replace_extension("img") / string(mat_group.texture)).string();
-                auto read_result = osgDB::Registry::instance()->readObject(tex_name, nullptr);
-
-                if(auto image = read_result.getImage())
-                {
-                    auto num_levels = image->getNumMipmapLevels();
-                    osg::ref_ptr<osg::Texture> tex = image->r() > 1 
-                        ? osg::ref_ptr<osg::Texture>(new osg::Texture3D()) 
-                        : osg::ref_ptr<osg::Texture>(new osg::Texture2D());
-                    tex->setImage(0, image);
-                    ss->setTextureAttributeAndModes(i, tex, i == 0 ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
-                }
-                else if(auto tex = dynamic_cast<osg::Texture*>(read_result.getObject()))
-                {
-                    ss->setTextureAttributeAndModes(i, tex, i == 0 ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
-                }
-                else
-                {
-                    OSG_WARN << "AOA plugin: failed to read texture " << tex_name;
-                }
+                auto num_levels = image->getNumMipmapLevels();
+                osg::ref_ptr<osg::Texture> tex = image->r() > 1 
+                    ? osg::ref_ptr<osg::Texture>(new osg::Texture3D()) 
+                    : osg::ref_ptr<osg::Texture>(new osg::Texture2D());
+                tex->setImage(0, image);
+                ss->setTextureAttributeAndModes(i, tex, i == 0 ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+            }
+            else if(auto tex = dynamic_cast<osg::Texture*>(read_result.getObject()))
+            {
+                ss->setTextureAttributeAndModes(i, tex, i == 0 ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+            }
+            else
+            {
+                OSG_WARN << "AOA plugin: failed to read texture " << tex_name;
             }
-
-            stateset_cache_.emplace(m.name, ss);
         }
+
+        return ss;
     }
 
 private:
-    refl::node root_node_;
-    refl::data_buffer data_buffer_description_;
+    aoa_document const& document_;
+    refl::node const& root_node_;
+    refl::data_buffer const& data_buffer_description_;
     path dirname_;
     path filename_;
+    read_options options_;
     refl::node::controllers_t::control_object_param_data::data_buffer shared_streams_;
-    std::map<pair<unsigned, unsigned>, osg::ref_ptr<osg::Array>> stream_attr_arrays_cache_;
-    std::map<string, osg::ref_ptr<osg::StateSet>> stateset_cache_;
-    vector<char> data_buffer_;
+    mutable std::set<unsigned> decoded_streams_;
+    mutable std::map<pair<unsigned, unsigned>, osg::ref_ptr<osg::Array>> stream_attr_arrays_cache_;
+    mutable std::map<string, osg::ref_ptr<osg::StateSet>> stateset_cache_;
+    const char* data_buffer_;
     std::set<osg::ref_ptr<osg::Node>, osg_node_cmp>& osg_nodes_;
 };
 
@@ -305,18 +569,72 @@ osg::ref_ptr<osg::Node> osg_geometry_from_aoa_mesh(refl::node::mesh_t mesh, node
 }
 
 
-osg::ref_ptr<osg::Node> extract_mesh_as_osg_nodes(refl::node const& n, node_context const& context)
+// visual geometry of a node that has a collision proxy, intersection visitors that can reach the proxy skip it,
+// so the default traversal mask tests the proxy only and a mask without collision_proxy_node_mask the geometry only
+struct proxied_geometry_group: osg::Group
+{
+    void traverse(osg::NodeVisitor& nv) override
+    {
+        if(nv.getVisitorType() == osg::NodeVisitor::INTERSECTION_VISITOR && (nv.getTraversalMask() & collision_proxy_node_mask))
+            return;
+
+        osg::Group::traverse(nv);
+    }
+};
+
+osg::ref_ptr<osg::Node> extract_mesh_as_osg_nodes(refl::node const& n, node_context const& context, bool has_proxy)
 {
     osg::ref_ptr<osg::Node> result;
     if(n.mesh)
         result = osg_geometry_from_aoa_mesh(*n.mesh, context);
 
+    if(result && has_proxy)
+    {
+        osg::ref_ptr<osg::Group> proxied = new proxied_geometry_group();
+        proxied->addChild(result);
+        proxied->setNodeMask(~collision_proxy_node_mask);
+        result = proxied;
+    }
+
     if(result)
         result->setName("geometry");
 
     return result;
 }
 
+// proxies are never drawn, they are only visited by intersection visitors
+struct skip_cull_callback: osg::NodeCallback
+{
+    void operator()(osg::Node* /*node*/, osg::NodeVisitor* /*nv*/) override
+    {
+    }
+};
+
+osg::ref_ptr<osg::Node> extract_collision_proxy(refl::node const& n, node_context const& context)
+{
+    if(!n.controllers.collision_volume || n.controllers.collision_volume->meshes.empty())
+        return nullptr;
+
+    osg::ref_ptr<osg::Group> result = new osg::Group();
+    for(auto const& mesh: n.controllers.collision_volume->meshes)
+    {
+        if(auto g = context.get_collision_geometry(mesh))
+            result->addChild(g);
+    }
+
+    if(result->getNumChildren() == 0)
+        return nullptr;
+
+    // the tree is built once at import, so the first intersection test does not pay for it
+    osg::ref_ptr<osg::KdTreeBuilder> kd_tree_builder = new osg::KdTreeBuilder();
+    result->accept(*kd_tree_builder);
+
+    result->setName("collision_proxy");
+    result->setNodeMask(collision_proxy_node_mask);
+    result->setCullCallback(new skip_cull_callback());
+    return result;
+}
+
 osg::ref_ptr<osg::LOD> convert_lod_node(refl::node const& n, node_context const& context)
 {
     osg::ref_ptr<osg::LOD> result = new osg::LOD();
@@ -340,69 +658,100 @@ osg::ref_ptr<osg::LOD> convert_lod_node(refl::node const& n, node_context const&
     return result;
 }
 
-osg::ref_ptr<osg::Node> aoa_node_to_osg_node(refl::node const& n, node_context const& context)
+// LOD levels are not converted here, each child is loaded by the DatabasePager from a "*.aoalod" pseudo file when it comes into range
+osg::ref_ptr<osg::LOD> convert_paged_lod_node(refl::node const& n, node_context const& context)
 {
-    osg::ref_ptr<osg::Group> result = convert_group_node(n, context);
+    osg::ref_ptr<osg::PagedLOD> result = new osg::PagedLOD();
+    assert(n.controllers.control_lod);
+
+    auto const& doc = context.document();
+    auto bbox = doc.get_subtree_bbox(n.name);
+
+    result->setCenter(bbox.valid() ? bbox.center() : osg::Vec3());
+    result->setRadius(n.controllers.control_lod->radius);
+    result->setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
+    // keeps the parsed description and the mapping alive while the LOD is in the scene graph
+    result->setUserData(const_cast<aoa_document*>(&doc));
 
-    if(n.controllers.control_lod)
+    // levels are read with the options of the file, so they keep its conversion options and plugin data (stats receiver)
+    auto const* db_options = context.options().db_options;
+    if(db_options || context.collision_proxies())
     {
-        result = convert_lod_node(n, context);
+        osg::ref_ptr<osgDB::Options> lod_options = db_options ? db_options->cloneOptions() : new osgDB::Options();
+        if(context.collision_proxies() && lod_options->getOptionString().find("aoaCollisionProxies") == string::npos)
+            lod_options->setOptionString(lod_options->getOptionString() + " aoaCollisionProxies");
+        result->setDatabaseOptions(lod_options);
     }
 
-    if(n.mesh)
+    int lod_num = n.controllers.control_lod->lod_pixel.size();
+
+    if(n.children.children.size() != lod_num)
     {
-        auto geom = extract_mesh_as_osg_nodes(n, context);
-        result->addChild(geom);
-    } 
+        OSG_WARN << "AOA plugin: number of LODS is " << lod_num << ", but there are " << n.children.children.size() << " children" << std::endl;
+    }
 
-    result->setName(n.name);
-    return result;
-}
+    for(int i = 0; i < std::min<int>(lod_num, n.children.children.size()); ++i)
+    {
+        float lod_pixel = n.controllers.control_lod->lod_pixel[i];
+        result->setFileName(i, paged_lod_file_name(doc.file_path, n.children.children[i]));
+        result->setRange(i, lod_pixel, std::numeric_limits<float>::infinity());
+    }
 
-bool compareChar(char c1, char c2)
-{
-    if(c1 == c2)
-        return true;
-    else if(std::toupper(c1) == std::toupper(c2))
-        return true;
-    return false;
+    return result;
 }
 
-/*
- * Case Insensitive String Comparision
- */
-bool caseInSensStringCompare(std::string const& str1, std::string const&str2)
+bool is_paged_lod(refl::node const& n, node_context const& context)
 {
-    return ((str1.size() == str2.size()) &&
-             std::equal(str1.begin(), str1.end(), str2.begin(), &compareChar));
+    return context.paged_lods() && n.controllers.control_lod;
 }
 
-osg::ref_ptr<osg::Node> aoa_to_osg(string const& path)
+osg::ref_ptr<osg::Node> aoa_node_to_osg_node(refl::node const& n, node_context const& context)
 {
-    auto aoa = read_aoa(path);
-    string root_name = std::filesystem::path(path).stem().string();
+    osg::ref_ptr<osg::Group> result = convert_group_node(n, context);
 
-    std::set<refl::node, node_cmp> nodes{aoa.nodes.begin(), aoa.nodes.end()};
-    std::set<osg::ref_ptr<osg::Node>, osg_node_cmp> osg_nodes;
+    if(is_paged_lod(n, context))
+    {
+        // children of a PagedLOD are its paged levels, so the node's own mesh and proxy
+        // go next to it in a plain group, where they stay visible and are never expired
+        auto lod = convert_paged_lod_node(n, context);
+        lod->setName(n.name);
+        result->addChild(lod);
+    }
+    else if(n.controllers.control_lod)
+    {
+        result = convert_lod_node(n, context);
+    }
 
+    osg::ref_ptr<osg::Node> proxy;
+    if(context.collision_proxies())
+        proxy = extract_collision_proxy(n, context);
 
-    bool found = false;
-    for(auto n : nodes)
+    if(n.mesh)
     {
-        if(caseInSensStringCompare(n.name, root_name))
-        {
-            root_name = n.name;
-            found = true;
-            break;
-        }
-    }
+        auto geom = extract_mesh_as_osg_nodes(n, context, proxy.valid());
+        result->addChild(geom);
+    } 
 
-    assert(found);
+    if(proxy)
+        result->addChild(proxy);
+
+    result->setName(n.name);
+    return result;
+}
+
+// converts the subgraph below subtree_root, children of paged LODs are left to the DatabasePager
+osg::ref_ptr<osg::Node> convert_subtree(aoa_document const& doc, string const& subtree_root, read_options const& options)
+{
+    std::set<osg::ref_ptr<osg::Node>, osg_node_cmp> osg_nodes;
+    node_context context(doc, osg_nodes, options);
 
     map<string, vector<string>> edges;
     map<string, bool> visited;
-    for(auto const& n: nodes)
+    for(auto const& n: doc.nodes)
     {
+        if(is_paged_lod(n, context))
+            continue;
+
         for(auto const& c: n.children.children)
         {
             edges[n.name].push_back(c);
@@ -425,28 +774,21 @@ osg::ref_ptr<osg::Node> aoa_to_osg(string const& path)
         traversal_order.push_back(n);
     };
 
-    for(auto const& n: nodes)
-    {
-        if(!visited[n.name])
-            dfs(n.name);
-    }
-
-    refl::node root_node = *nodes.find(root_name);
-    node_context context(path, aoa, root_node, osg_nodes);
+    dfs(subtree_root);
 
     // reverse topological order
     // added this when there seemed to be a need to access children of converted nodes
     // but for now the need disappeared
     for(auto node_name: traversal_order)
     {
-        osg_nodes.insert(aoa_node_to_osg_node(*nodes.find(node_name), context));
+        osg_nodes.insert(aoa_node_to_osg_node(*doc.nodes.find(node_name), context));
     }
 
-    for(auto const&n : nodes)
+    for(auto const& node_name: traversal_order)
     {
-        for(auto const& child: n.children.children)
+        for(auto const& child: edges[node_name])
         {
-            osg::Group* g = dynamic_cast<osg::Group*>((*osg_nodes.find(n.name)).get());
+            osg::Group* g = dynamic_cast<osg::Group*>((*osg_nodes.find(node_name)).get());
             if(g)
                 g->addChild(*osg_nodes.find(child));
             else
@@ -456,9 +798,79 @@ osg::ref_ptr<osg::Node> aoa_to_osg(string const& path)
         }
     }
 
-    auto it = osg_nodes.find(root_name);
+    auto it = osg_nodes.find(subtree_root);
     assert(it != osg_nodes.end());
     return *it;
 }
 
+// converted nodes and drawables, the items of the convert phase
+size_t count_nodes(osg::Node* root)
+{
+    struct count_visitor : osg::NodeVisitor
+    {
+        count_visitor() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN) {}
+        void apply(osg::Node& n) override { count++; traverse(n); }
+        size_t count = 0;
+    };
+
+    if(!root)
+        return 0;
+
+    count_visitor v;
+    root->accept(v);
+    return v.count;
+}
+
+osg::ref_ptr<osg::Node> aoa_to_osg(string const& path, read_options const& options)
+{
+    osg::ref_ptr<aoa_document> doc;
+    measure_phase(options.stats, "open_document", [&]()
+    {
+        doc = get_aoa_document(path);
+        return doc->nodes.size();
+    });
+
+    osg::ref_ptr<osg::Node> result;
+    measure_phase(options.stats, "convert", [&]()
+    {
+        result = convert_subtree(*doc, doc->root_name, options);
+        return count_nodes(result.get());
+    });
+
+    return result;
+}
+
+osg::ref_ptr<osg::Node> aoa_lod_to_osg(string const& pseudo_file_name, read_options const& options)
+{
+    auto names = parse_paged_lod_file_name(pseudo_file_name);
+    if(!names || !std::filesystem::exists(names->first))
+        return nullptr;
+
+    osg::ref_ptr<aoa_document> doc;
+    measure_phase(options.stats, "open_document", [&]()
+    {
+        doc = get_aoa_document(names->first);
+        return doc->nodes.size();
+    });
+
+    if(doc->nodes.find(names->second) == doc->nodes.end())
+    {
+        OSG_WARN << "AOA plugin: no node " << names->second << " in " << names->first << std::endl;
+        return nullptr;
+    }
+
+    // nested LODs of a paged level are paged as well
+    read_options lod_options = options;
+    lod_options.paged_lods = true;
+
+    osg::ref_ptr<osg::Node> result;
+    measure_phase(options.stats, "convert", [&]()
+    {
+        result = convert_subtree(*doc, names->second, lod_options);
+        return count_nodes(result.get());
+    });
+
+    return result;
+}
+
 }
\ No newline at end of file
@@ -4,10 +4,8 @@
 namespace aurora
 {
 
-dict_t aoa_to_dict(std::string const& path)
+dict_t aoa_to_dict(std::istream& file)
 {
-    std::ifstream file(path, std::ios_base::binary);
-
     std::string key, value;
     bool reading_key = false;
     bool reading_value = false;
@@ -111,13 +109,23 @@ dict_t aoa_to_dict(std::string const& path)
     return result;
 }
 
-refl::aurora_format read_aoa(std::string const& path)
+dict_t aoa_to_dict(std::string const& path)
+{
+    std::ifstream file(path, std::ios_base::binary);
+    return aoa_to_dict(file);
+}
+
+refl::aurora_format dict_to_aoa(dict_t const& aoa_dict)
 {
     refl::aurora_format result;
-    auto aoa_dict = aoa_to_dict(path);
     read_processor p(aoa_dict);
     reflect(p, result);
     return result;
 }
 
+refl::aurora_format read_aoa(std::string const& path)
+{
+    return dict_to_aoa(aoa_to_dict(path));
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include "compress_textures_visitor.h"
+#include "bc_encoder.h"
+
+#include <osg/Texture>
+#include <osgDB/WriteFile>
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace aurora
+{
+
+namespace
+{
+
+// texture unit of normal maps in "__DN" and "__DEAFG" materials
+constexpr unsigned normal_map_unit = 1;
+
+struct compression_job
+{
+    osg::ref_ptr<osg::Image> source;
+    bc::format               format;
+    string                   file_name;
+    vector<osg::Image*>      users;
+    bool                     written = false;
+};
+
+bool is_convertible(osg::Image const& image)
+{
+    if(image.isCompressed() || image.getDataType() != GL_UNSIGNED_BYTE || image.r() != 1 || !image.data())
+        return false;
+
+    switch(image.getPixelFormat())
+    {
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGB:
+    case GL_BGR:
+    case GL_LUMINANCE:
+    case GL_LUMINANCE_ALPHA:
+    case GL_RED:
+    case GL_RG:
+    case GL_ALPHA:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// expands any supported 8 bit image to tightly packed rgba8
+vector<uint8_t> to_rgba8(osg::Image const& image)
+{
+    unsigned w = image.s(), h = image.t();
+    unsigned components = osg::Image::computeNumComponents(image.getPixelFormat());
+    vector<uint8_t> result(size_t(w) * h * 4);
+
+    for(unsigned y = 0; y < h; ++y)
+    {
+        const uint8_t* src = image.data(0, y);
+        uint8_t* dst = result.data() + size_t(y) * w * 4;
+
+        for(unsigned x = 0; x < w; ++x, src += components, dst += 4)
+        {
+            switch(image.getPixelFormat())
+            {
+            case GL_RGBA:            dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; break;
+            case GL_BGRA:            dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0]; dst[3] = src[3]; break;
+            case GL_RGB:             dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255;    break;
+            case GL_BGR:             dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0]; dst[3] = 255;    break;
+            case GL_LUMINANCE:       dst[0] = dst[1] = dst[2] = src[0];                 dst[3] = 255;    break;
+            case GL_LUMINANCE_ALPHA: dst[0] = dst[1] = dst[2] = src[0];                 dst[3] = src[1]; break;
+            case GL_RED:             dst[0] = src[0]; dst[1] = 0;      dst[2] = 0;      dst[3] = 255;    break;
+            case GL_RG:              dst[0] = src[0]; dst[1] = src[1]; dst[2] = 0;      dst[3] = 255;    break;
+            case GL_ALPHA:           dst[0] = dst[1] = dst[2] = 255;                    dst[3] = src[0]; break;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool has_alpha(osg::Image const& image)
+{
+    auto pf = image.getPixelFormat();
+    if(pf != GL_RGBA && pf != GL_BGRA && pf != GL_LUMINANCE_ALPHA && pf != GL_ALPHA)
+        return false;
+
+    unsigned components = osg::Image::computeNumComponents(pf);
+    for(int y = 0; y < image.t(); ++y)
+    {
+        const uint8_t* row = image.data(0, y);
+        for(int x = 0; x < image.s(); ++x)
+        {
+            if(row[x * components + components - 1] != 255)
+                return true;
+        }
+    }
+    return false;
+}
+
+// 2x2 box filter, odd sizes are handled by clamping
+vector<uint8_t> downsample(vector<uint8_t> const& src, unsigned w, unsigned h)
+{
+    unsigned dw = std::max(w / 2, 1u), dh = std::max(h / 2, 1u);
+    vector<uint8_t> result(size_t(dw) * dh * 4);
+
+    for(unsigned y = 0; y < dh; ++y)
+    {
+        const uint8_t* r0 = src.data() + size_t(std::min(2 * y,     h - 1)) * w * 4;
+        const uint8_t* r1 = src.data() + size_t(std::min(2 * y + 1, h - 1)) * w * 4;
+
+        for(unsigned x = 0; x < dw; ++x)
+        {
+            unsigned x0 = std::min(2 * x, w - 1) * 4, x1 = std::min(2 * x + 1, w - 1) * 4;
+            uint8_t* dst = result.data() + (size_t(y) * dw + x) * 4;
+
+            for(unsigned c = 0; c < 4; ++c)
+                dst[c] = uint8_t((r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) / 4);
+        }
+    }
+
+    return result;
+}
+
+// FNV-1a of the pixels and everything that affects the compressed result
+uint64_t content_hash(osg::Image const& image, bc::format fmt)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void* data, size_t size)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for(size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+
+    int header[] = { image.s(), image.t(), int(image.getPixelFormat()), int(fmt) };
+    add(header, sizeof(header));
+
+    unsigned row_size = image.getRowSizeInBytes();
+    for(int y = 0; y < image.t(); ++y)
+        add(image.data(0, y), row_size);
+
+    return hash;
+}
+
+osg::ref_ptr<osg::Image> compress(osg::Image const& source, bc::format fmt)
+{
+    unsigned w = source.s(), h = source.t();
+
+    vector<uint8_t> level = to_rgba8(source);
+    vector<size_t> offsets;
+    vector<uint8_t> compressed;
+
+    for(;;)
+    {
+        offsets.push_back(compressed.size());
+        compressed.resize(compressed.size() + bc::compressed_size(w, h, fmt));
+        bc::compress_image(level.data(), w, h, fmt, compressed.data() + offsets.back());
+
+        if(w == 1 && h == 1)
+            break;
+
+        level = downsample(level, w, h);
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    unsigned char* data = new unsigned char[compressed.size()];
+    std::copy(compressed.begin(), compressed.end(), data);
+
+    osg::ref_ptr<osg::Image> result = new osg::Image();
+    result->setImage(source.s(), source.t(), 1, bc::gl_format(fmt), bc::gl_format(fmt), GL_UNSIGNED_BYTE, data, osg::Image::USE_NEW_DELETE);
+    result->setMipmapLevels(osg::Image::MipmapDataType(offsets.begin() + 1, offsets.end()));
+    result->setOrigin(source.getOrigin());
+    return result;
+}
+
+}
+
+void compress_textures_visitor::apply(osg::Node & node)
+{
+    if(node.getStateSet()) apply(*node.getStateSet());
+    traverse(node);
+}
+
+void compress_textures_visitor::apply(osg::StateSet & stateset)
+{
+    for(unsigned int i = 0; i < stateset.getTextureAttributeList().size(); ++i)
+    {
+        osg::Texture* texture = dynamic_cast<osg::Texture*>(stateset.getTextureAttribute(i, osg::StateAttribute::TEXTURE));
+        if(!texture)
+            continue;
+
+        for(unsigned j = 0; j < texture->getNumImages(); ++j)
+        {
+            if(osg::Image* image = texture->getImage(j))
+                images_.emplace(image, i);
+        }
+    }
+}
+
+size_t compress_textures_visitor::write(string const& dir, unsigned num_threads)
+{
+    // unique contents, images with equal pixels share one job
+    vector<compression_job> jobs;
+    map<uint64_t, size_t> job_by_hash;
+
+    for(auto const& [image, unit] : images_)
+    {
+        if(!is_convertible(*image))
+        {
+            OSG_INFO << "AOA plugin: image " << image->getFileName() << " is left as is, its format is not supported by the texture compressor\n";
+            continue;
+        }
+
+        auto fmt = unit == normal_map_unit ? bc::format::BC5 : has_alpha(*image) ? bc::format::BC3 : bc::format::BC1;
+        auto hash = content_hash(*image, fmt);
+
+        auto it = job_by_hash.find(hash);
+        if(it == job_by_hash.end())
+        {
+            std::ostringstream name;
+            name << std::hex << std::setw(16) << std::setfill('0') << hash << ".dds";
+
+            compression_job job;
+            job.source = image;
+            job.format = fmt;
+            job.file_name = name.str();
+
+            it = job_by_hash.emplace(hash, jobs.size()).first;
+            jobs.push_back(job);
+        }
+
+        jobs[it->second].users.push_back(image.get());
+    }
+
+    if(jobs.empty())
+        return 0;
+
+    fs::create_directories(dir);
+
+    std::atomic<size_t> next_job(0);
+    std::mutex log_mutex;
+
+    auto worker = [&]()
+    {
+        for(size_t i = next_job++; i < jobs.size(); i = next_job++)
+        {
+            auto& job = jobs[i];
+            auto path = (fs::path(dir) / job.file_name).string();
+
+            try
+            {
+                // content addressed, so an existing file is the result of an earlier export of the same pixels
+                job.written = fs::exists(path) || osgDB::writeImageFile(*compress(*job.source, job.format), path);
+            }
+            catch(std::exception const& e)
+            {
+                std::lock_guard<std::mutex> lock(log_mutex);
+                OSG_WARN << "AOA plugin: failed to compress " << job.source->getFileName() << ": " << e.what() << "\n";
+            }
+        }
+    };
+
+    num_threads = std::max(1u, std::min<unsigned>(num_threads, jobs.size()));
+    vector<std::thread> threads;
+    for(unsigned i = 1; i < num_threads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for(auto& t : threads)
+        t.join();
+
+    size_t num_images = 0, num_written = 0;
+    for(auto const& job : jobs)
+    {
+        if(!job.written)
+        {
+            OSG_WARN << "AOA plugin: failed to write compressed texture for " << job.source->getFileName() << "\n";
+            continue;
+        }
+
+        for(auto image : job.users)
+            image->setFileName(job.file_name);
+
+        num_images += job.users.size();
+        num_written++;
+    }
+
+    OSG_NOTICE << "AOA plugin: " << num_images << " images compressed to " << num_written << " textures in '" << dir << "'\n";
+    return num_written;
+}
+
+}
@@ -19,6 +19,7 @@ struct fix_materials_visitor::impl
 
     material_loader& loader;
     std::string      relative_dir;
+    size_t           material_count = 0;
 };
 
 fix_materials_visitor::fix_materials_visitor(material_loader& l, string relative_dir)
@@ -30,6 +31,11 @@ fix_materials_visitor::fix_materials_visitor(material_loader& l, string relative
 
 fix_materials_visitor::~fix_materials_visitor() = default;
 
+size_t fix_materials_visitor::material_count() const
+{
+    return pimpl_->material_count;
+}
+
 void fix_materials_visitor::apply(osg::Geometry & g)
 {
     auto pGeometry = &g;
@@ -37,6 +43,7 @@ void fix_materials_visitor::apply(osg::Geometry & g)
     {
         osg::StateSet* state_set = pGeometry->getStateSet();
         osg::Material* mat = (osg::Material*) pGeometry->getStateSet()->getAttribute(osg::StateAttribute::MATERIAL);
+        pimpl_->material_count++;
         //unsigned num_textures = state_set->getNumTextureAttributeLists();
 
         auto mat_data = pimpl_->loader.get_material_data(mat->getName());
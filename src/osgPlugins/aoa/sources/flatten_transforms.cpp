@@ -0,0 +1,105 @@
+#include "flatten_transforms.h"
+#include "phase_stats.h"
+
+#include <osg/NodeVisitor>
+#include <osg/Transform>
+
+#include <osgUtil/Optimizer>
+
+namespace aurora
+{
+
+namespace
+{
+
+struct make_transforms_static_visitor: osg::NodeVisitor
+{
+    make_transforms_static_visitor()
+        : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {}
+
+
+    void apply(osg::Node& node) override
+    {
+        traverse(node);
+    }
+
+    void apply(osg::Transform& t) override
+    {
+        t.setDataVariance(osg::Object::DataVariance::STATIC);
+        transform_count++;
+        traverse(t);
+    }
+
+    size_t transform_count = 0;
+};
+
+struct remove_hanging_transforms_visitor : osg::NodeVisitor
+{
+    remove_hanging_transforms_visitor()
+        : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {}
+
+    void apply(osg::Group& n) override
+    {
+        if(n.getNumChildren() == 0)
+            nodes_to_remove_.insert(&n);
+        else 
+            traverse(n);
+    }
+
+    bool remove_hanging_transforms()
+    {
+        for(auto& t: nodes_to_remove_)
+        {
+            assert(t->getNumParents() == 1);
+            t->getParent(0)->removeChild(t.get());
+        }
+
+        removed_count += nodes_to_remove_.size();
+
+        bool sts = nodes_to_remove_.size() != 0;
+        nodes_to_remove_.clear();
+        return sts;
+    }
+
+    size_t removed_count = 0;
+
+private:
+    std::set<osg::ref_ptr<osg::Node>> nodes_to_remove_;
+};
+
+}
+
+void flatten_transforms(osg::Node& root, bool index_mesh, phase_stats* stats)
+{
+    // apply transforms from ancestor nodes to geometry
+    // optimizer will only do this for transform nodes whose data variance is STATIC so we set it here 
+    measure_phase(stats, "make_transforms_static", [&]()
+    {
+        make_transforms_static_visitor make_tranforms_static;
+        root.accept(make_tranforms_static);
+        return make_tranforms_static.transform_count;
+    });
+
+    // remove leaf Transform nodes because otherwise the optimizer will not be able to flatten all transforms properly
+    measure_phase(stats, "remove_hanging_transforms", [&]()
+    {
+        remove_hanging_transforms_visitor remove_hanging_tv;
+
+        do root.accept(remove_hanging_tv);
+        while(remove_hanging_tv.remove_hanging_transforms());
+
+        return remove_hanging_tv.removed_count;
+    });
+
+    // run the optimizer
+    measure_phase(stats, "optimizer", [&]()
+    {
+        osgUtil::Optimizer optimizer;
+        optimizer.optimize(&root, osgUtil::Optimizer::FLATTEN_STATIC_TRANSFORMS | (index_mesh ? osgUtil::Optimizer::INDEX_MESH : 0));
+        return size_t(0);
+    });
+}
+
+}
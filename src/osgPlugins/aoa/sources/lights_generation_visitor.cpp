@@ -187,6 +187,17 @@ void lights_generation_visitor::apply(osg::Geode & geode)
     }
 }
 
+size_t aurora::lights_generation_visitor::light_count() const
+{
+    size_t result = 0;
+    for(auto const& channel : lights_)
+    {
+        for(auto const& type : channel.second)
+            result += type.second.size();
+    }
+    return result;
+}
+
 void aurora::lights_generation_visitor::generate_lights()
 {
     aoa_writer::node_ptr root = aoa_writer_.get_root_node();
@@ -0,0 +1,60 @@
+#include "phase_stats.h"
+#include "phase_stats_receiver.h"
+
+#include <osgDB/Options>
+
+namespace aurora
+{
+
+double phase_stats::total_seconds() const
+{
+    double result = 0;
+    for(auto const& p : phases)
+        result += p.seconds;
+    return result;
+}
+
+void publish_phase_stats(phase_stats const& stats, osgDB::Options const* options)
+{
+    OSG_INFO << "AOA plugin: " << stats.operation << " " << stats.file << " took " << stats.total_seconds() << " s" << std::endl;
+    for(auto const& p : stats.phases)
+        OSG_INFO << "AOA plugin:     " << p.name << ": " << p.seconds << " s, " << p.items << " items" << std::endl;
+
+    if(!options)
+        return;
+
+    // the receiver locks, so reads sharing the options can publish at once
+    osg::ref_ptr<phase_stats_receiver> receiver = static_cast<phase_stats_receiver*>(const_cast<void*>(options->getPluginData(phase_stats_plugin_data)));
+    if(!receiver)
+        return;
+
+    phase_stats_receiver::values_t values;
+    for(auto const& p : stats.phases)
+    {
+        string prefix = stats.operation + "." + p.name;
+        values[prefix + ".seconds"] = p.seconds;
+        values[prefix + ".items"]   = double(p.items);
+    }
+
+    for(auto const& c : stats.counters)
+        values[stats.operation + "." + c.first] = double(c.second);
+
+    // the receiver sums the values, the number of files gives the averages
+    values[stats.operation + ".files"] = 1;
+
+    receiver->publish(values);
+}
+
+void write_phase_stats(phase_stats const& stats, string const& path)
+{
+    std::ofstream out(path);
+    if(!out)
+    {
+        OSG_WARN << "AOA plugin: cannot write stats report " << path << std::endl;
+        return;
+    }
+
+    json_io::data_to_stream(out, stats, true);
+}
+
+}
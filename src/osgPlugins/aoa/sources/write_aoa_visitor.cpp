@@ -412,7 +412,7 @@ void write_aoa_visitor::write_debug_obj_file(string file_name) const
     }
 }
 
-void write_aoa_visitor::write_aoa()
+void write_aoa_visitor::finish_root_node()
 {
     OSG_INFO << "AOA plugin: EXTRACTED " << get_chunks().size()    << " CHUNKS"   << std::endl;
     OSG_INFO << "AOA plugin: EXTRACTED " << get_faces().size()     << " FACES"    << std::endl;
@@ -428,6 +428,11 @@ void write_aoa_visitor::write_aoa()
     }
 
     root->set_cvbox_spec(bbox);
+}
+
+void write_aoa_visitor::write_aoa()
+{
+    finish_root_node();
     aoa_writer_.save_data();
 }
 
@@ -0,0 +1,445 @@
+// Statistics of the .aoa files packed in the .arsc archives of an asset tree, a native replacement
+// of tools/models_stats.py. Archives are scanned on a pool of threads, entries are inflated into the
+// AOA tokenizer as a stream, nothing is extracted. The report holds per file stats (fields, vertex formats,
+// LOD levels and buffer sizes) and the histograms over all of them.
+//
+// usage: aoa_stats <asset dir> [--report aoa_stats.json] [--incremental] [--threads N]
+//                              [--exclude airports-db] [--stats2 stats2.json] [--list]
+//
+// --incremental  reuses the stats of archives whose mtime and size did not change since the --report was written
+// --stats2       writes the {field: [archive/entry, ...]} map of models_stats.py for process_stats.py
+// --list         prints the .aoa entries of every archive, as models_stats_2.py did
+
+#include "arsc_archive.h"
+
+#include "aurora_aoa_reader.h"
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osgDB/FileNameUtils>
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+using namespace aurora;
+
+namespace
+{
+
+struct aoa_file_stats
+{
+    string entry;
+    size_t aoa_bytes     = 0;
+    size_t nodes         = 0;
+    size_t meshes        = 0;
+    size_t lod_nodes     = 0;
+    size_t materials     = 0;
+    // sizes of the buffers the file references in its .aod
+    size_t vertex_bytes    = 0;
+    size_t index_bytes     = 0;
+    size_t light_bytes     = 0;
+    size_t collision_bytes = 0;
+
+    // #FIELD keys without the '#'
+    vector<string>   fields;
+    // one signature per VAO, "id:size x type" of every attribute
+    vector<string>   vertex_formats;
+    // levels of every LOD node
+    vector<unsigned> lod_levels;
+    string           error;
+
+    REFL_INNER(aoa_file_stats)
+        REFL_ENTRY(entry)
+        REFL_ENTRY(aoa_bytes)
+        REFL_ENTRY(nodes)
+        REFL_ENTRY(meshes)
+        REFL_ENTRY(lod_nodes)
+        REFL_ENTRY(materials)
+        REFL_ENTRY(vertex_bytes)
+        REFL_ENTRY(index_bytes)
+        REFL_ENTRY(light_bytes)
+        REFL_ENTRY(collision_bytes)
+        REFL_ENTRY(fields)
+        REFL_ENTRY(vertex_formats)
+        REFL_ENTRY(lod_levels)
+        REFL_ENTRY(error)
+    REFL_END()
+};
+
+struct archive_stats
+{
+    string                 path;
+    size_t                 mtime = 0;
+    size_t                 size  = 0;
+    vector<aoa_file_stats> files;
+    string                 error;
+
+    REFL_INNER(archive_stats)
+        REFL_ENTRY(path)
+        REFL_ENTRY(mtime)
+        REFL_ENTRY(size)
+        REFL_ENTRY(files)
+        REFL_ENTRY(error)
+    REFL_END()
+};
+
+struct stats_report
+{
+    string                root;
+    size_t                archives_scanned = 0;
+    size_t                archives_reused  = 0;
+    size_t                files            = 0;
+    double                seconds          = 0;
+
+    // files a field appears in
+    std::map<string, size_t> field_files;
+    // VAOs of a vertex format
+    std::map<string, size_t> vertex_formats;
+    // LOD nodes by the number of levels
+    std::map<string, size_t> lod_levels;
+    // files by the total size of referenced buffers, power of two buckets
+    std::map<string, size_t> buffer_sizes;
+
+    vector<archive_stats> archives;
+
+    REFL_INNER(stats_report)
+        REFL_ENTRY(root)
+        REFL_ENTRY(archives_scanned)
+        REFL_ENTRY(archives_reused)
+        REFL_ENTRY(files)
+        REFL_ENTRY(seconds)
+        REFL_ENTRY(field_files)
+        REFL_ENTRY(vertex_formats)
+        REFL_ENTRY(lod_levels)
+        REFL_ENTRY(buffer_sizes)
+        REFL_ENTRY(archives)
+    REFL_END()
+};
+
+void collect_fields(dict_t const& dict, set<string>& fields)
+{
+    for(auto const& child : dict.children())
+    {
+        auto const& key = child.first;
+        fields.insert(!key.empty() && key[0] == '#' ? key.substr(1) : key);
+        collect_fields(child.second, fields);
+    }
+}
+
+const char* attribute_type_name(unsigned type)
+{
+    static const char* const names[] =
+    {
+        "UNSIGNED_INT_2_10_10_10_REV",
+        "INT_2_10_10_10_REV",
+        "UNSIGNED_INT",
+        "INT",
+        "UNSIGNED_BYTE",
+        "BYTE",
+        "FLOAT",
+        "HALF_FLOAT",
+    };
+
+    return type < sizeof(names) / sizeof(names[0]) ? names[type] : "UNKNOWN";
+}
+
+string vertex_format_signature(data_buffer::vao_buffer::vertex_format const& format)
+{
+    string result;
+    for(auto const& a : format.attributes)
+    {
+        if(!result.empty())
+            result += ",";
+        result += std::to_string(a.id) + ":" + std::to_string(a.size) + "x" + attribute_type_name(a.type);
+        if(a.divisor)
+            result += "/" + std::to_string(a.divisor);
+    }
+    return result;
+}
+
+void scan_aoa(std::istream& in, aoa_file_stats& stats)
+{
+    auto dict = aoa_to_dict(in);
+
+    set<string> fields;
+    collect_fields(dict, fields);
+    stats.fields.assign(fields.begin(), fields.end());
+
+    auto aoa = dict_to_aoa(dict);
+
+    stats.nodes     = aoa.nodes.size();
+    stats.materials = aoa.materials.list.size();
+
+    stats.vertex_bytes = aoa.buffer_data.vertex_file_offset_size.size;
+    stats.index_bytes  = aoa.buffer_data.index_file_offset_size.size;
+    for(auto const& vao : aoa.buffer_data.vaos)
+        stats.vertex_formats.push_back(vertex_format_signature(vao.format));
+
+    for(auto const& n : aoa.nodes)
+    {
+        if(n.mesh)
+            stats.meshes++;
+
+        auto const& controllers = n.controllers;
+        if(controllers.control_lod)
+        {
+            stats.lod_nodes++;
+            stats.lod_levels.push_back(unsigned(controllers.control_lod->lod_pixel.size()));
+        }
+
+        if(controllers.object_param_controller)
+        {
+            auto const& buffer = controllers.object_param_controller->buffer;
+            for(auto const& s : buffer.light_streams)
+                stats.light_bytes += s.light_offset_size.size;
+            if(buffer.collision_stream)
+                stats.collision_bytes += buffer.collision_stream->vertex_offset_size.size + buffer.collision_stream->index_offset_size.size;
+        }
+    }
+}
+
+void scan_archive(archive_stats& stats)
+{
+    arsc_archive archive(stats.path);
+    if(!archive.is_open())
+    {
+        stats.error = "can't open archive";
+        return;
+    }
+
+    for(auto const& e : archive.entries())
+    {
+        if(osgDB::getLowerCaseFileExtension(e.name) != "aoa")
+            continue;
+
+        aoa_file_stats file;
+        file.entry     = e.name;
+        file.aoa_bytes = e.size;
+
+        try
+        {
+            scan_aoa(archive.open_entry(e), file);
+            if(!archive.entry_ok())
+                file.error = "corrupted entry";
+        }
+        catch(std::exception const& ex)
+        {
+            file.error = ex.what();
+        }
+
+        stats.files.push_back(std::move(file));
+    }
+}
+
+string size_bucket(size_t bytes)
+{
+    if(bytes == 0)
+        return "0";
+
+    size_t bucket = 1;
+    while(bucket < bytes)
+        bucket <<= 1;
+
+    static const char* const units[] = { "B", "KB", "MB", "GB" };
+    unsigned unit = 0;
+    while(bucket >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0]))
+    {
+        bucket /= 1024;
+        unit++;
+    }
+
+    return "<=" + std::to_string(bucket) + units[unit];
+}
+
+void build_histograms(stats_report& report)
+{
+    report.files = 0;
+    for(auto const& a : report.archives)
+    {
+        for(auto const& f : a.files)
+        {
+            report.files++;
+
+            for(auto const& field : f.fields)
+                report.field_files[field]++;
+            for(auto const& format : f.vertex_formats)
+                report.vertex_formats[format]++;
+            for(auto levels : f.lod_levels)
+                report.lod_levels[std::to_string(levels)]++;
+
+            report.buffer_sizes[size_bucket(f.vertex_bytes + f.index_bytes + f.light_bytes + f.collision_bytes)]++;
+        }
+    }
+}
+
+void write_stats2(stats_report const& report, string const& path)
+{
+    std::map<string, vector<string>> files_by_field;
+    for(auto const& a : report.archives)
+    {
+        for(auto const& f : a.files)
+        {
+            auto file_path = (fs::path(a.path) / f.entry).string();
+            for(auto const& field : f.fields)
+                files_by_field[field].push_back(file_path);
+        }
+    }
+
+    std::ofstream out(path);
+    json_io::data_to_stream(out, files_by_field, true);
+}
+
+vector<string> find_archives(fs::path const& root, set<string> const& excludes)
+{
+    vector<string> result;
+
+    for(fs::recursive_directory_iterator it(root), end; it != end; ++it)
+    {
+        auto const& path = it->path();
+        if(fs::is_directory(path))
+        {
+            if(excludes.count(path.filename().string()))
+                it.no_push();
+            continue;
+        }
+
+        if(osgDB::getLowerCaseFileExtension(path.string()) == "arsc")
+            result.push_back(path.string());
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    string report_path = "aoa_stats.json";
+    string stats2_path;
+    unsigned num_threads = 0;
+    arguments.read("--report", report_path);
+    arguments.read("--stats2", stats2_path);
+    arguments.read("--threads", num_threads);
+    bool incremental = arguments.read("--incremental");
+    bool list = arguments.read("--list");
+
+    set<string> excludes;
+    for(string exclude; arguments.read("--exclude", exclude); )
+        excludes.insert(exclude);
+    if(excludes.empty())
+        excludes.insert("airports-db");
+
+    if(arguments.argc() < 2)
+    {
+        std::cerr << "usage: aoa_stats <asset dir> [--report aoa_stats.json] [--incremental] [--threads N] "
+                     "[--exclude airports-db] [--stats2 stats2.json] [--list]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+
+        stats_report report;
+        report.root = fs::absolute(arguments[1]).string();
+
+        // stats of the previous run by archive path
+        std::map<string, archive_stats> previous;
+        if(incremental && fs::exists(report_path))
+        {
+            stats_report previous_report;
+            json_io::read_file(report_path, previous_report);
+            for(auto& a : previous_report.archives)
+                previous.emplace(a.path, std::move(a));
+        }
+
+        vector<bool> reused;
+        for(auto const& path : find_archives(report.root, excludes))
+        {
+            boost::system::error_code ec;
+            size_t mtime = size_t(fs::last_write_time(path, ec));
+            size_t size  = size_t(fs::file_size(path, ec));
+
+            auto it = previous.find(path);
+            if(it != previous.end() && it->second.mtime == mtime && it->second.size == size && it->second.error.empty())
+            {
+                report.archives.push_back(std::move(it->second));
+                reused.push_back(true);
+                report.archives_reused++;
+                continue;
+            }
+
+            archive_stats a;
+            a.path  = path;
+            a.mtime = mtime;
+            a.size  = size;
+            report.archives.push_back(std::move(a));
+            reused.push_back(false);
+        }
+
+        vector<archive_stats*> to_scan;
+        for(size_t i = 0; i < report.archives.size(); ++i)
+        {
+            if(!reused[i])
+                to_scan.push_back(&report.archives[i]);
+        }
+
+        std::atomic<size_t> next_archive(0);
+        std::mutex output_mutex;
+        auto worker = [&]()
+        {
+            for(size_t i = next_archive++; i < to_scan.size(); i = next_archive++)
+            {
+                scan_archive(*to_scan[i]);
+
+                if(list || !to_scan[i]->error.empty())
+                {
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    if(!to_scan[i]->error.empty())
+                        std::cerr << to_scan[i]->path << ": " << to_scan[i]->error << std::endl;
+                    for(auto const& f : to_scan[i]->files)
+                        std::cout << f.entry << ": " << fs::path(to_scan[i]->path).filename().string() << std::endl;
+                }
+            }
+        };
+
+        num_threads = num_threads ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+        num_threads = std::max(1u, std::min<unsigned>(num_threads, unsigned(to_scan.size())));
+
+        vector<std::thread> threads;
+        for(unsigned i = 1; i < num_threads; ++i)
+            threads.emplace_back(worker);
+        worker();
+        for(auto& t : threads)
+            t.join();
+
+        report.archives_scanned = to_scan.size();
+        build_histograms(report);
+        report.seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+        {
+            std::ofstream out(report_path);
+            json_io::data_to_stream(out, report, true);
+        }
+
+        if(!stats2_path.empty())
+            write_stats2(report, stats2_path);
+
+        std::cout << "aoa_stats: " << report.files << " aoa files in " << report.archives.size() << " archives ("
+                  << report.archives_scanned << " scanned, " << report.archives_reused << " reused) in "
+                  << report.seconds << " s" << std::endl;
+    }
+    catch(std::exception const& e)
+    {
+        std::cerr << "aoa_stats: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
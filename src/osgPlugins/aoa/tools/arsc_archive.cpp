@@ -0,0 +1,146 @@
+#include "arsc_archive.h"
+
+#include "unzip.h"
+
+#include <streambuf>
+
+namespace aurora
+{
+
+namespace
+{
+
+// inflates the entry with UnzipItem in fixed size chunks
+struct zip_entry_streambuf : std::streambuf
+{
+    static constexpr size_t chunk_size = 64 * 1024;
+
+    zip_entry_streambuf()
+        : buffer_(chunk_size)
+    {}
+
+    void reset(HZIP zip, int index, size_t size)
+    {
+        zip_   = zip;
+        index_ = index;
+        size_  = size;
+        read_  = 0;
+        done_  = false;
+        ok_    = true;
+        setg(buffer_.data(), buffer_.data(), buffer_.data());
+    }
+
+    bool ok() const
+    {
+        return ok_;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if(gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        if(done_)
+            return traits_type::eof();
+
+        size_t n = 0;
+        ZRESULT zr = UnzipItem(zip_, index_, buffer_.data(), unsigned(buffer_.size()));
+        if(zr == ZR_MORE)
+        {
+            n = buffer_.size();
+        }
+        else if(zr == ZR_OK)
+        {
+            // the last chunk holds the rest of the entry
+            n = size_ - read_;
+            done_ = true;
+        }
+        else
+        {
+            ok_ = false;
+            done_ = true;
+        }
+
+        read_ += n;
+        if(n == 0)
+            return traits_type::eof();
+
+        setg(buffer_.data(), buffer_.data(), buffer_.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    vector<char> buffer_;
+    HZIP         zip_   = nullptr;
+    int          index_ = 0;
+    size_t       size_  = 0;
+    size_t       read_  = 0;
+    bool         done_  = true;
+    bool         ok_    = true;
+};
+
+}
+
+struct arsc_archive::impl
+{
+    HZIP                zip = nullptr;
+    vector<entry>       entries;
+    zip_entry_streambuf buf;
+    std::istream        stream { &buf };
+};
+
+arsc_archive::arsc_archive(string const& path)
+    : pimpl_(std::make_unique<impl>())
+{
+    pimpl_->zip = OpenZip(path.c_str(), nullptr);
+    if(!pimpl_->zip)
+        return;
+
+    ZIPENTRY ze;
+    if(GetZipItem(pimpl_->zip, -1, &ze) != ZR_OK)
+        return;
+
+    int count = ze.index;
+    for(int i = 0; i < count; ++i)
+    {
+        if(GetZipItem(pimpl_->zip, i, &ze) != ZR_OK)
+            continue;
+
+        string name = ze.name;
+        if(name.empty() || name.back() == '/')
+            continue;
+
+        pimpl_->entries.push_back({ i, name, size_t(std::max(ze.comp_size, 0l)), size_t(std::max(ze.unc_size, 0l)) });
+    }
+}
+
+arsc_archive::~arsc_archive()
+{
+    if(pimpl_->zip)
+        CloseZip(pimpl_->zip);
+}
+
+bool arsc_archive::is_open() const
+{
+    return pimpl_->zip != nullptr;
+}
+
+vector<arsc_archive::entry> const& arsc_archive::entries() const
+{
+    return pimpl_->entries;
+}
+
+std::istream& arsc_archive::open_entry(entry const& e)
+{
+    pimpl_->buf.reset(pimpl_->zip, e.index, e.size);
+    pimpl_->stream.clear();
+    return pimpl_->stream;
+}
+
+bool arsc_archive::entry_ok() const
+{
+    return pimpl_->buf.ok();
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+
+namespace aurora
+{
+
+// Read-only view of an .arsc (zip) archive. Entries are inflated chunk by chunk into a stream,
+// nothing is extracted to disk and an entry never has to fit in memory as a whole.
+struct arsc_archive
+{
+    struct entry
+    {
+        int    index;
+        string name;
+        size_t compressed_size;
+        size_t size;
+    };
+
+    explicit arsc_archive(string const& path);
+    ~arsc_archive();
+
+    bool is_open() const;
+    vector<entry> const& entries() const;
+
+    // the stream is valid until the next call, entries are read one at a time
+    std::istream& open_entry(entry const& e);
+    // false if the last opened entry was truncated or corrupted
+    bool entry_ok() const;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl_;
+};
+
+}
@@ -0,0 +1,278 @@
+#include "bc_encoder.h"
+
+#include <osg/Texture>
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cstring>
+
+namespace aurora
+{
+namespace bc
+{
+
+namespace
+{
+
+// per channel minimum and maximum of 16 rgba pixels
+void block_bounds(const uint8_t* rgba, uint8_t* lo, uint8_t* hi)
+{
+    __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba) + 0);
+    __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba) + 1);
+    __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba) + 2);
+    __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba) + 3);
+
+    __m128i mn = _mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3));
+    __m128i mx = _mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3));
+
+    // reduce 4 pixels of a register to one
+    mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1, 0, 3, 2)));
+    mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1, 0, 3, 2)));
+    mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2, 3, 0, 1)));
+    mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    uint32_t l = uint32_t(_mm_cvtsi128_si32(mn));
+    uint32_t h = uint32_t(_mm_cvtsi128_si32(mx));
+    memcpy(lo, &l, 4);
+    memcpy(hi, &h, 4);
+}
+
+uint16_t to_565(int r, int g, int b)
+{
+    return uint16_t(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+void from_565(uint16_t c, int* rgb)
+{
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// dot products of 4 pixels with a 16 bit direction (r, g, b, a) replicated twice
+__m128i dot4(__m128i pixels, __m128i dir)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), dir);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), dir);
+
+    // (rg, ba) pairs to one sum per pixel in the even lanes
+    lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+    hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+void encode_color_block(const uint8_t* rgba, uint8_t* dst)
+{
+    uint8_t lo[4], hi[4];
+    block_bounds(rgba, lo, hi);
+
+    // inset the bounding box by 1/16 to reduce the error of the end points
+    int mn[3], mx[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        int inset = (hi[i] - lo[i]) >> 4;
+        mn[i] = lo[i] + inset;
+        mx[i] = hi[i] - inset;
+    }
+
+    // pick the box diagonal: channels varying against the widest one are flipped
+    int ref = 0;
+    for(int i = 1; i < 3; ++i)
+    {
+        if(hi[i] - lo[i] > hi[ref] - lo[ref])
+            ref = i;
+    }
+
+    int center[3] = { (lo[0] + hi[0]) / 2, (lo[1] + hi[1]) / 2, (lo[2] + hi[2]) / 2 };
+    int cov[3] = {};
+    for(int p = 0; p < 16; ++p)
+    {
+        int d = rgba[p * 4 + ref] - center[ref];
+        for(int i = 0; i < 3; ++i)
+            cov[i] += d * (rgba[p * 4 + i] - center[i]);
+    }
+
+    for(int i = 0; i < 3; ++i)
+    {
+        if(cov[i] < 0)
+            std::swap(mn[i], mx[i]);
+    }
+
+    uint16_t c0 = to_565(mx[0], mx[1], mx[2]);
+    uint16_t c1 = to_565(mn[0], mn[1], mn[2]);
+
+    uint32_t indices = 0;
+    if(c0 != c1)
+    {
+        // four color mode requires c0 > c1
+        if(c0 < c1)
+            std::swap(c0, c1);
+
+        int p0[3], p1[3];
+        from_565(c0, p0);
+        from_565(c1, p1);
+
+        int dir[3] = { p0[0] - p1[0], p0[1] - p1[1], p0[2] - p1[2] };
+        int len2 = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+        int base = p1[0] * dir[0] + p1[1] * dir[1] + p1[2] * dir[2];
+
+        // projection 0..3 from c1 to c0, mapped to the palette order c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+        static const uint32_t remap[4] = { 1, 3, 2, 0 };
+
+        const __m128i vdir   = _mm_setr_epi16(short(dir[0]), short(dir[1]), short(dir[2]), 0, short(dir[0]), short(dir[1]), short(dir[2]), 0);
+        const __m128i vbase  = _mm_set1_epi32(base);
+        const __m128  vscale = _mm_set1_ps(3.f / float(len2));
+        const __m128i vmax   = _mm_set1_epi32(3);
+        const __m128i zero   = _mm_setzero_si128();
+
+        for(int i = 0; i < 4; ++i)
+        {
+            __m128i d = _mm_sub_epi32(dot4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba) + i), vdir), vbase);
+            __m128i t = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(d), vscale));
+
+            // clamp to 0..3, epi32 min/max are SSE4.1 so compare and select
+            t = _mm_and_si128(t, _mm_cmpgt_epi32(t, zero));
+            __m128i over = _mm_cmpgt_epi32(t, vmax);
+            t = _mm_or_si128(_mm_andnot_si128(over, t), _mm_and_si128(over, vmax));
+
+            alignas(16) int32_t ti[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(ti), t);
+            for(int j = 0; j < 4; ++j)
+                indices |= remap[ti[j]] << (2 * (i * 4 + j));
+        }
+    }
+
+    memcpy(dst + 0, &c0, 2);
+    memcpy(dst + 2, &c1, 2);
+    memcpy(dst + 4, &indices, 4);
+}
+
+// BC4 block of one channel, 8 interpolated values
+void encode_channel_block(const uint8_t* rgba, unsigned channel, uint8_t* dst)
+{
+    alignas(16) uint8_t values[16];
+    for(int i = 0; i < 16; ++i)
+        values[i] = rgba[i * 4 + channel];
+
+    __m128i mn = _mm_load_si128(reinterpret_cast<const __m128i*>(values));
+    __m128i mx = mn;
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 8)); mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 8));
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4)); mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 2)); mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 2));
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 1)); mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 1));
+
+    int a1 = _mm_cvtsi128_si32(mn) & 0xff;
+    int a0 = _mm_cvtsi128_si32(mx) & 0xff;
+
+    dst[0] = uint8_t(a0);
+    dst[1] = uint8_t(a1);
+
+    uint64_t indices = 0;
+    if(a0 != a1)
+    {
+        // projection 0..7 from a1 to a0, palette order is a0, a1, then 6/7 a0 + 1/7 a1 down to 1/7 a0 + 6/7 a1
+        static const uint64_t remap[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+
+        const __m128 vmin   = _mm_set1_ps(float(a1));
+        const __m128 vscale = _mm_set1_ps(7.f / float(a0 - a1));
+        const __m128i zero  = _mm_setzero_si128();
+
+        for(int i = 0; i < 4; ++i)
+        {
+            int32_t four;
+            memcpy(&four, values + i * 4, 4);
+
+            __m128i p = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(four), zero), zero);
+            __m128i t = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(p), vmin), vscale));
+
+            alignas(16) int32_t ti[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(ti), t);
+            for(int j = 0; j < 4; ++j)
+                indices |= remap[std::min(std::max(ti[j], 0), 7)] << (3 * (i * 4 + j));
+        }
+    }
+
+    for(int i = 0; i < 6; ++i)
+        dst[2 + i] = uint8_t(indices >> (8 * i));
+}
+
+}
+
+unsigned block_size(format fmt)
+{
+    return fmt == format::BC1 ? 8 : 16;
+}
+
+unsigned gl_format(format fmt)
+{
+    switch(fmt)
+    {
+    case format::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case format::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case format::BC5: return GL_COMPRESSED_RED_GREEN_RGTC2_EXT;
+    }
+    return 0;
+}
+
+void encode_bc1_block(const uint8_t* rgba, uint8_t* dst)
+{
+    encode_color_block(rgba, dst);
+}
+
+void encode_bc3_block(const uint8_t* rgba, uint8_t* dst)
+{
+    encode_channel_block(rgba, 3, dst);
+    encode_color_block(rgba, dst + 8);
+}
+
+void encode_bc5_block(const uint8_t* rgba, uint8_t* dst)
+{
+    encode_channel_block(rgba, 0, dst);
+    encode_channel_block(rgba, 1, dst + 8);
+}
+
+size_t compressed_size(unsigned width, unsigned height, format fmt)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * block_size(fmt);
+}
+
+void compress_image(const uint8_t* rgba, unsigned width, unsigned height, format fmt, uint8_t* dst)
+{
+    auto encode = fmt == format::BC1 ? &encode_bc1_block : fmt == format::BC3 ? &encode_bc3_block : &encode_bc5_block;
+    unsigned bs = block_size(fmt);
+
+    alignas(16) uint8_t block[64];
+
+    for(unsigned by = 0; by < height; by += 4)
+    {
+        for(unsigned bx = 0; bx < width; bx += 4, dst += bs)
+        {
+            if(bx + 4 <= width && by + 4 <= height)
+            {
+                for(unsigned y = 0; y < 4; ++y)
+                    memcpy(block + y * 16, rgba + (size_t(by + y) * width + bx) * 4, 16);
+            }
+            else
+            {
+                for(unsigned y = 0; y < 4; ++y)
+                {
+                    for(unsigned x = 0; x < 4; ++x)
+                    {
+                        unsigned sx = std::min(bx + x, width - 1);
+                        unsigned sy = std::min(by + y, height - 1);
+                        memcpy(block + y * 16 + x * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+                    }
+                }
+            }
+
+            encode(block, dst);
+        }
+    }
+}
+
+}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Range fit BC1/BC3/BC5 block encoder.
+// Endpoints are taken from the inset bounding box of the block, indices are chosen by projecting
+// the pixels onto the endpoint axis, four pixels at a time.
+
+namespace aurora
+{
+namespace bc
+{
+
+enum class format
+{
+    BC1,    // rgb, 1 bit alpha is not used
+    BC3,    // rgb + interpolated alpha
+    BC5,    // two interpolated channels (red, green), used for normal maps
+};
+
+unsigned block_size(format fmt);
+
+// GL internal format of the compressed image
+unsigned gl_format(format fmt);
+
+// rgba: 4x4 block of rgba8 pixels, rows are tightly packed
+void encode_bc1_block(const uint8_t* rgba, uint8_t* dst);
+void encode_bc3_block(const uint8_t* rgba, uint8_t* dst);
+void encode_bc5_block(const uint8_t* rgba, uint8_t* dst);
+
+// compresses a tightly packed rgba8 image, partial blocks on the right and top edges are padded by clamping
+void compress_image(const uint8_t* rgba, unsigned width, unsigned height, format fmt, uint8_t* dst);
+
+// size of the compressed image in bytes
+size_t compressed_size(unsigned width, unsigned height, format fmt);
+
+}
+}
@@ -35,7 +35,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "sampler.h"
 #include "btx_to_dds.h"
+#include "btx_to_image.h"
+#include "image_to_btx.h"
 
 // Macro similar to what's in FLT/TRP plugins (except it uses wide char under Windows if OSG_USE_UTF8_FILENAME)
 #if defined(_WIN32)
@@ -1326,7 +1329,11 @@ public:
         //supportsOption("dds_dxt1_rgb","Set the pixel format of DXT1 encoded images to be RGB variant of DXT1");
         //supportsOption("dds_dxt1_rgba","Set the pixel format of DXT1 encoded images to be RGBA variant of DXT1");
         //supportsOption("dds_dxt1_detect_rgba","For DXT1 encode images set the pixel format according to presence of transparent pixels");
-        //supportsOption("dds_flip","Flip the image about the horizontal axis");
+        supportsOption("dds_flip","Flip the image about the horizontal axis");
+        supportsOption("btxTarget=<2d|3d|array|cube>","(Write option) Texture target of the written image, 2d or 3d by the image depth if not set");
+        supportsOption("btxCompress","(Write option) Compress RGB(A)8 images to BC1/BC3");
+        supportsOption("btxNoBatches","(Write option) Store the mip chain without streaming batches");
+        supportsOption("btxThreads=<n>","(Write option) Number of threads encoding the batches, all cores by default");
         //supportsOption("ddsNoAutoFlipWrite", "(Write option) Avoid automatically flipping the image vertically when writing, depending on the origin (Image::getOrigin()).");
     }
 
@@ -1363,12 +1370,21 @@ public:
 
     virtual ReadResult readImage(std::istream& fin, const Options* options) const
     {
-        std::stringstream out(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
-        auto sts = btx_to_dds(fin, out);
-        if(!sts)
-            return ReadResult::ERROR_IN_READING_FILE;
+        bool dds_flip(false);
+        if (options)
+        {
+            std::istringstream iss(options->getOptionString());
+            std::string opt;
+            while (iss >> opt)
+            {
+                if (opt == "dds_flip") dds_flip = true;
+            }
+        }
 
-        return osgDB::Registry::instance()->getReaderWriterForExtension("dds")->readImage(out, options);
+        osg::Image* osgImage = btx_to_image(fin, dds_flip);
+        if (osgImage==NULL) return ReadResult::ERROR_IN_READING_FILE;
+
+        return osgImage;
     }
 
     virtual WriteResult writeObject(const osg::Object& object,const std::string& file, const osgDB::ReaderWriter::Options* options) const
@@ -1407,7 +1423,33 @@ public:
 
     virtual WriteResult writeImage(const osg::Image& image,std::ostream& fout,const Options* options) const
     {
-        return WriteResult(WriteResult::NOT_IMPLEMENTED);
+        btx_write_options write_options;
+        if (options)
+        {
+            std::istringstream iss(options->getOptionString());
+            std::string opt;
+            while (iss >> opt)
+            {
+                std::string::size_type eq = opt.find('=');
+                std::string name = opt.substr(0, eq);
+                std::string value = eq == std::string::npos ? std::string() : opt.substr(eq + 1);
+
+                if (name == "btxTarget")
+                {
+                    if (value == "2d")         write_options.target = Sampler::Texture2d;
+                    else if (value == "3d")    write_options.target = Sampler::Texture3d;
+                    else if (value == "array") write_options.target = Sampler::Texture2dArray;
+                    else if (value == "cube")  write_options.target = Sampler::TextureCubeMap;
+                    else OSG_WARN << "ReaderWriterBTX: unknown btxTarget " << value << std::endl;
+                }
+                else if (name == "btxCompress")  write_options.compress = true;
+                else if (name == "btxNoBatches") write_options.no_batches = true;
+                else if (name == "btxThreads")   write_options.num_threads = atoi(value.c_str());
+            }
+        }
+
+        if (!image_to_btx(image, fout, write_options)) return WriteResult::ERROR_IN_WRITING_FILE;
+        return WriteResult::FILE_SAVED;
     }
 };
 
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "sampler.h"
+
+#include <algorithm>
+#include <vector>
+
+// On-disk layout of BTX textures: header, batchesNum batch descriptions, then the batch data.
+// Batch offsets are counted from the end of the header.
+// A file without batches stores the whole mip chain right after the header.
+
+#pragma pack(push, 1)
+
+struct BTXHeader
+{
+    unsigned		magic;
+    unsigned		hash;
+    unsigned		dataSize;
+    unsigned		swizzle;
+    unsigned short	target;
+    unsigned short	format;
+    unsigned short	width;
+    unsigned short	height;
+    unsigned short	depth;
+    unsigned short	mipmaps;
+    unsigned short	batchesNum;
+    unsigned short	reserved;
+};
+
+struct BTXBatch
+{
+    unsigned		offset;
+    unsigned		size;
+    unsigned short	x;
+    unsigned short	y;
+    unsigned short	w;
+    unsigned short	h;
+    unsigned short	layerOrFace;
+    unsigned char	mipmap;
+    unsigned char	action;
+};
+
+#pragma pack(pop)
+
+// Placement of levels and layers in the decoded image, same as the engine keeps them in memory:
+// levels one after another, 3D textures halve the depth per level, array and cube textures keep all layers.
+struct btx_layout
+{
+    btx_layout(BTXHeader const& btx_header)
+        : header(btx_header)
+        , format_info(Sampler::GetFormatInfo(Sampler::Format(btx_header.format)))
+    {
+        block_pixels = format_info->IsCompressed() ? 4 : 1;
+        block_bytes  = format_info->Bytes();
+
+        size_t offset = 0;
+        for(unsigned mip = 0; mip < std::max<unsigned>(header.mipmaps, 1); ++mip)
+        {
+            level_offsets.push_back(offset);
+            offset += layer_size(mip) * layers(mip);
+        }
+        total_size = offset;
+    }
+
+    unsigned width(unsigned mip) const  { return std::max(header.width >> mip, 1); }
+    unsigned height(unsigned mip) const { return std::max(header.height >> mip, 1); }
+
+    unsigned layers(unsigned mip) const
+    {
+        if(header.target == Sampler::Texture3d)
+            return std::max(header.depth >> mip, 1);
+        if(header.target == Sampler::TextureCubeMap)
+            return 6;
+        return std::max<unsigned>(header.depth, 1);
+    }
+
+    // bytes in one row of blocks
+    size_t row_pitch(unsigned mip) const
+    {
+        return size_t((width(mip) + block_pixels - 1) / block_pixels) * block_bytes;
+    }
+
+    size_t layer_size(unsigned mip) const
+    {
+        return row_pitch(mip) * ((height(mip) + block_pixels - 1) / block_pixels);
+    }
+
+    BTXHeader const& header;
+    const Sampler::FormatInfo* format_info;
+    unsigned block_pixels;
+    unsigned block_bytes;
+    std::vector<size_t> level_offsets;
+    size_t total_size;
+};
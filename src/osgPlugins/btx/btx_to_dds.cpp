@@ -11,43 +11,11 @@
 #include <osg/Image>
 
 #include "btx_to_dds.h"
+#include "btx_format.h"
 
 using DirectX::DDS_HEADER;
 using DirectX::DDS_HEADER_DXT10;
 
-#pragma pack(push, 1)
-
-struct BTXHeader
-{
-    unsigned		magic;
-    unsigned		hash;
-    unsigned		dataSize;
-    unsigned		swizzle;
-    unsigned short	target;
-    unsigned short	format;
-    unsigned short	width;
-    unsigned short	height;
-    unsigned short	depth;
-    unsigned short	mipmaps;
-    unsigned short	batchesNum;
-    unsigned short	reserved;
-};
-
-struct BTXBatch
-{
-    unsigned		offset;
-    unsigned		size;
-    unsigned short	x;
-    unsigned short	y;
-    unsigned short	w;
-    unsigned short	h;
-    unsigned short	layerOrFace;
-    unsigned char	mipmap;
-    unsigned char	action;
-};
-
-#pragma pack(pop)
-
 using std::pair;
 using std::vector;
 using std::optional;
@@ -0,0 +1,135 @@
+#include "sampler.h"
+#include "btx_format.h"
+#include "btx_to_image.h"
+
+#include <osg/Notify>
+
+#include <algorithm>
+#include <istream>
+#include <vector>
+
+using std::vector;
+
+namespace
+{
+
+// copies the batch rectangle into its place, one memcpy per row of blocks
+bool place_batch(btx_layout const& layout, BTXBatch const& batch, const char* src, size_t src_size, unsigned char* dst)
+{
+    unsigned mip = batch.mipmap;
+    if(mip >= layout.level_offsets.size() || batch.layerOrFace >= layout.layers(mip)
+        || batch.x + batch.w > layout.width(mip) || batch.y + batch.h > layout.height(mip))
+        return false;
+
+    unsigned bp = layout.block_pixels;
+    size_t batch_pitch = size_t((batch.w + bp - 1) / bp) * layout.block_bytes;
+    unsigned rows = (batch.h + bp - 1) / bp;
+
+    if(batch_pitch * rows > src_size)
+        return false;
+
+    size_t pitch = layout.row_pitch(mip);
+    unsigned char* level = dst + layout.level_offsets[mip] + batch.layerOrFace * layout.layer_size(mip);
+    unsigned char* row   = level + (batch.y / bp) * pitch + (batch.x / bp) * layout.block_bytes;
+
+    for(unsigned r = 0; r < rows; ++r, row += pitch, src += batch_pitch)
+        memcpy(row, src, batch_pitch);
+
+    return true;
+}
+
+}
+
+osg::Image* btx_to_image(std::istream& in, bool flip)
+{
+    in.seekg(0, std::ios_base::end);
+    size_t file_size = size_t(in.tellg());
+    in.seekg(0);
+
+    if(file_size < sizeof(BTXHeader))
+        return nullptr;
+
+    vector<char> file(file_size);
+    in.read(file.data(), file_size);
+    if(size_t(in.gcount()) != file_size)
+        return nullptr;
+
+    BTXHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+
+    if(header.magic != BTX_MAGIC || header.format == Sampler::FORMAT_NONE || header.format >= Sampler::FORMATS_NUM)
+        return nullptr;
+
+    btx_layout layout(header);
+    const char* data = file.data() + sizeof(header);
+    size_t data_size = file_size - sizeof(header);
+
+    if(layout.total_size == 0)
+        return nullptr;
+
+    // parts of the layout not covered by the file stay zero
+    unsigned char* pixels = new unsigned char[layout.total_size]();
+
+    if(header.batchesNum == 0)
+    {
+        memcpy(pixels, data, std::min(layout.total_size, data_size));
+    }
+    else
+    {
+        if(size_t(header.batchesNum) * sizeof(BTXBatch) > data_size)
+        {
+            delete[] pixels;
+            return nullptr;
+        }
+
+        // only batches with data, the others are streaming notifications
+        vector<BTXBatch> batches;
+        for(unsigned i = 0; i < header.batchesNum; ++i)
+        {
+            BTXBatch batch;
+            memcpy(&batch, data + i * sizeof(BTXBatch), sizeof(batch));
+            if(batch.action == Sampler::BTX_DATA)
+                batches.push_back(batch);
+        }
+
+        // placing is a plain copy per row of blocks, files are decoded in parallel by the pager threads
+        size_t num_failed = 0;
+        for(auto const& b : batches)
+        {
+            if(size_t(b.offset) + b.size > data_size || !place_batch(layout, b, data + b.offset, b.size, pixels))
+                num_failed++;
+        }
+
+        if(num_failed)
+            OSG_WARN << "btx_to_image: " << num_failed << " batches are out of the texture bounds or the file" << std::endl;
+    }
+
+    auto format_info = layout.format_info;
+    bool compressed = format_info->IsCompressed();
+
+    osg::Image* image = new osg::Image();
+    image->setImage(layout.width(0), layout.height(0), layout.layers(0),
+                    format_info->InternalFormat(),
+                    compressed ? format_info->InternalFormat() : format_info->SourceFormat(),
+                    compressed ? GL_UNSIGNED_BYTE : format_info->Type(),
+                    pixels, osg::Image::USE_NEW_DELETE, 1);
+
+    if(layout.level_offsets.size() > 1)
+    {
+        osg::Image::MipmapDataType offsets(layout.level_offsets.begin() + 1, layout.level_offsets.end());
+        image->setMipmapLevels(offsets);
+    }
+
+    if(flip)
+    {
+        unsigned s = image->s(), t = image->t();
+        image->setOrigin(osg::Image::BOTTOM_LEFT);
+        // same restriction as the dds plugin
+        if(!compressed || ((s > 4 && s % 4 == 0 && t > 4 && t % 4 == 0) || s <= 4))
+            image->flipVertical();
+        else
+            OSG_WARN << "btx_to_image warning: Vertical flip was skipped. Image dimensions have to be multiple of 4." << std::endl;
+    }
+
+    return image;
+}
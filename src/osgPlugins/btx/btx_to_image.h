@@ -0,0 +1,7 @@
+#pragma once
+
+#include <osg/Image>
+
+// Builds the image with all mip levels and layers straight from the BTX batches.
+// Levels of 3D textures halve the depth, array and cube textures keep all layers (faces) on every level.
+osg::Image* btx_to_image(std::istream& in, bool flip = false);
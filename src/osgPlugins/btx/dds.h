@@ -18,7 +18,13 @@
 
 #pragma once
 #include <cstdint>
+
+#ifdef _WIN32
 #include "dxgiformat.h"
+#else
+// only the DX10 header refers to DXGI formats, elsewhere just the unknown format is needed
+enum DXGI_FORMAT { DXGI_FORMAT_UNKNOWN = 0 };
+#endif
 
 namespace DirectX
 {
@@ -58,97 +64,97 @@ struct DDS_PIXELFORMAT
                 | (static_cast<uint32_t>(static_cast<uint8_t>(ch3)) << 24))
 #endif /* defined(MAKEFOURCC) */
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_DXT1 =
+inline constexpr DDS_PIXELFORMAT DDSPF_DXT1 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('D','X','T','1'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_DXT2 =
+inline constexpr DDS_PIXELFORMAT DDSPF_DXT2 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('D','X','T','2'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_DXT3 =
+inline constexpr DDS_PIXELFORMAT DDSPF_DXT3 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('D','X','T','3'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_DXT4 =
+inline constexpr DDS_PIXELFORMAT DDSPF_DXT4 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('D','X','T','4'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_DXT5 =
+inline constexpr DDS_PIXELFORMAT DDSPF_DXT5 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('D','X','T','5'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_BC4_UNORM =
+inline constexpr DDS_PIXELFORMAT DDSPF_BC4_UNORM =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('B','C','4','U'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_BC4_SNORM =
+inline constexpr DDS_PIXELFORMAT DDSPF_BC4_SNORM =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('B','C','4','S'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_BC5_UNORM =
+inline constexpr DDS_PIXELFORMAT DDSPF_BC5_UNORM =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('B','C','5','U'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_BC5_SNORM =
+inline constexpr DDS_PIXELFORMAT DDSPF_BC5_SNORM =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('B','C','5','S'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_R8G8_B8G8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_R8G8_B8G8 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('R','G','B','G'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_G8R8_G8B8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_G8R8_G8B8 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('G','R','G','B'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_YUY2 =
+inline constexpr DDS_PIXELFORMAT DDSPF_YUY2 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('Y','U','Y','2'), 0, 0, 0, 0, 0 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_A8R8G8B8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_A8R8G8B8 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGBA, 0, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_X8R8G8B8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_X8R8G8B8 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGB,  0, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_A8B8G8R8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_A8B8G8R8 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGBA, 0, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_X8B8G8R8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_X8B8G8R8 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGB,  0, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0x00000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_G16R16 =
+inline constexpr DDS_PIXELFORMAT DDSPF_G16R16 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGB,  0, 32, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_R5G6B5 =
+inline constexpr DDS_PIXELFORMAT DDSPF_R5G6B5 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGB, 0, 16, 0x0000f800, 0x000007e0, 0x0000001f, 0x00000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_A1R5G5B5 =
+inline constexpr DDS_PIXELFORMAT DDSPF_A1R5G5B5 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGBA, 0, 16, 0x00007c00, 0x000003e0, 0x0000001f, 0x00008000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_A4R4G4B4 =
+inline constexpr DDS_PIXELFORMAT DDSPF_A4R4G4B4 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGBA, 0, 16, 0x00000f00, 0x000000f0, 0x0000000f, 0x0000f000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_R8G8B8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_R8G8B8 =
     { sizeof(DDS_PIXELFORMAT), DDS_RGB, 0, 24, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_L8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_L8 =
     { sizeof(DDS_PIXELFORMAT), DDS_LUMINANCE, 0,  8, 0xff, 0x00, 0x00, 0x00 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_L16 =
+inline constexpr DDS_PIXELFORMAT DDSPF_L16 =
     { sizeof(DDS_PIXELFORMAT), DDS_LUMINANCE, 0, 16, 0xffff, 0x0000, 0x0000, 0x0000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_A8L8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_A8L8 =
     { sizeof(DDS_PIXELFORMAT), DDS_LUMINANCEA, 0, 16, 0x00ff, 0x0000, 0x0000, 0xff00 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_A8L8_ALT =
+inline constexpr DDS_PIXELFORMAT DDSPF_A8L8_ALT =
     { sizeof(DDS_PIXELFORMAT), DDS_LUMINANCEA, 0, 8, 0x00ff, 0x0000, 0x0000, 0xff00 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_A8 =
+inline constexpr DDS_PIXELFORMAT DDSPF_A8 =
     { sizeof(DDS_PIXELFORMAT), DDS_ALPHA, 0, 8, 0x00, 0x00, 0x00, 0xff };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_V8U8 = 
+inline constexpr DDS_PIXELFORMAT DDSPF_V8U8 = 
     { sizeof(DDS_PIXELFORMAT), DDS_BUMPDUDV, 0, 16, 0x00ff, 0xff00, 0x0000, 0x0000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_Q8W8V8U8 = 
+inline constexpr DDS_PIXELFORMAT DDSPF_Q8W8V8U8 = 
     { sizeof(DDS_PIXELFORMAT), DDS_BUMPDUDV, 0, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 };
 
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_V16U16 = 
+inline constexpr DDS_PIXELFORMAT DDSPF_V16U16 = 
     { sizeof(DDS_PIXELFORMAT), DDS_BUMPDUDV, 0, 32, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000 };
 
 // D3DFMT_A2R10G10B10/D3DFMT_A2B10G10R10 should be written using DX10 extension to avoid D3DX 10:10:10:2 reversal issue
 
 // This indicates the DDS_HEADER_DXT10 extension is present (the format is in dxgiFormat)
-extern __declspec(selectany) const DDS_PIXELFORMAT DDSPF_DX10 =
+inline constexpr DDS_PIXELFORMAT DDSPF_DX10 =
     { sizeof(DDS_PIXELFORMAT), DDS_FOURCC, MAKEFOURCC('D','X','1','0'), 0, 0, 0, 0, 0 };
 
 #define DDS_HEADER_FLAGS_TEXTURE        0x00001007  // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT 
@@ -0,0 +1,348 @@
+#include "sampler.h"
+#include "btx_format.h"
+#include "image_to_btx.h"
+
+// BC encoder shared with the aoa plugin
+#include "bc_encoder.h"
+
+#include <osg/Notify>
+
+#include <atomic>
+#include <limits>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+namespace
+{
+
+struct tile
+{
+    unsigned     mip;
+    unsigned     layer;
+    unsigned     x, y, w, h;
+    vector<char> data;
+};
+
+bool is_plain_format(Sampler::FormatInfo const* info)
+{
+    return !info->IsCompressed() && !info->Flags(Sampler::TEXTURE_SRGB | Sampler::TEXTURE_INTEGER | Sampler::TEXTURE_SIGNED);
+}
+
+// format of the Sampler table the image data can be stored in without conversion
+Sampler::Format find_format(osg::Image const& image)
+{
+    auto pixel_format = image.getPixelFormat();
+    auto internal_format = unsigned(image.getInternalTextureFormat());
+
+    Sampler::Format fallback = Sampler::FORMAT_NONE;
+    for(unsigned i = Sampler::FORMAT_NONE + 1; i < Sampler::FORMATS_NUM; ++i)
+    {
+        auto info = Sampler::GetFormatInfo(Sampler::Format(i));
+
+        if(image.isCompressed())
+        {
+            if(info->IsCompressed() && info->InternalFormat() == pixel_format)
+                return Sampler::Format(i);
+            continue;
+        }
+
+        if(info->IsCompressed() || info->SourceFormat() != pixel_format || info->Type() != image.getDataType())
+            continue;
+
+        if(info->InternalFormat() == internal_format)
+            return Sampler::Format(i);
+
+        if(fallback == Sampler::FORMAT_NONE && is_plain_format(info))
+            fallback = Sampler::Format(i);
+    }
+
+    return fallback;
+}
+
+// row of blocks (pixels for plain formats) as the osg image stores it
+struct source_level
+{
+    const unsigned char* data;
+    size_t               pitch;
+    size_t               layer_size;
+};
+
+source_level get_source_level(osg::Image const& image, btx_layout const& layout, unsigned mip)
+{
+    source_level result;
+    result.data = image.getMipmapData(mip);
+
+    unsigned w = layout.width(mip);
+    unsigned rows = (layout.height(mip) + layout.block_pixels - 1) / layout.block_pixels;
+
+    if(image.isCompressed())
+        result.pitch = layout.row_pitch(mip);
+    else
+        result.pitch = osg::Image::computeRowWidthInBytes(w, image.getPixelFormat(), image.getDataType(), image.getPacking());
+
+    result.layer_size = result.pitch * rows;
+    return result;
+}
+
+void copy_tile(source_level const& src, btx_layout const& layout, tile& t)
+{
+    unsigned bp = layout.block_pixels;
+    size_t tile_pitch = size_t((t.w + bp - 1) / bp) * layout.block_bytes;
+    unsigned rows = (t.h + bp - 1) / bp;
+
+    t.data.resize(tile_pitch * rows);
+
+    const unsigned char* row = src.data + t.layer * src.layer_size + (t.y / bp) * src.pitch + (t.x / bp) * layout.block_bytes;
+    for(unsigned r = 0; r < rows; ++r, row += src.pitch)
+        memcpy(t.data.data() + r * tile_pitch, row, tile_pitch);
+}
+
+void compress_tile(source_level const& src, osg::Image const& image, aurora::bc::format fmt, tile& t)
+{
+    unsigned components = osg::Image::computeNumComponents(image.getPixelFormat());
+    bool bgr = image.getPixelFormat() == GL_BGR || image.getPixelFormat() == GL_BGRA;
+
+    vector<uint8_t> rgba(size_t(t.w) * t.h * 4);
+    for(unsigned y = 0; y < t.h; ++y)
+    {
+        const unsigned char* s = src.data + t.layer * src.layer_size + (t.y + y) * src.pitch + t.x * components;
+        uint8_t* d = rgba.data() + size_t(y) * t.w * 4;
+
+        for(unsigned x = 0; x < t.w; ++x, s += components, d += 4)
+        {
+            d[0] = s[bgr ? 2 : 0];
+            d[1] = s[1];
+            d[2] = s[bgr ? 0 : 2];
+            d[3] = components == 4 ? s[3] : 255;
+        }
+    }
+
+    t.data.resize(aurora::bc::compressed_size(t.w, t.h, fmt));
+    aurora::bc::compress_image(rgba.data(), t.w, t.h, fmt, reinterpret_cast<uint8_t*>(t.data.data()));
+}
+
+bool has_alpha(osg::Image const& image, btx_layout const& layout)
+{
+    if(osg::Image::computeNumComponents(image.getPixelFormat()) != 4)
+        return false;
+
+    auto level = get_source_level(image, layout, 0);
+    for(unsigned l = 0; l < layout.layers(0); ++l)
+    {
+        for(unsigned y = 0; y < layout.height(0); ++y)
+        {
+            const unsigned char* row = level.data + l * level.layer_size + y * level.pitch;
+            for(unsigned x = 0; x < layout.width(0); ++x)
+            {
+                if(row[x * 4 + 3] != 255)
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool is_compressible(osg::Image const& image)
+{
+    auto pf = image.getPixelFormat();
+    return !image.isCompressed() && image.getDataType() == GL_UNSIGNED_BYTE
+        && (pf == GL_RGB || pf == GL_RGBA || pf == GL_BGR || pf == GL_BGRA);
+}
+
+uint32_t fnv1a(uint32_t hash, const char* data, size_t size)
+{
+    for(size_t i = 0; i < size; ++i)
+        hash = (hash ^ uint8_t(data[i])) * 16777619u;
+    return hash;
+}
+
+}
+
+bool image_to_btx(osg::Image const& image, std::ostream& out, btx_write_options const& options)
+{
+    if(!image.data() || image.s() <= 0 || image.t() <= 0)
+        return false;
+
+    auto source_format = find_format(image);
+    if(source_format == Sampler::FORMAT_NONE)
+    {
+        OSG_WARN << "image_to_btx: pixel format 0x" << std::hex << image.getPixelFormat() << std::dec << " has no BTX counterpart" << std::endl;
+        return false;
+    }
+
+    if(image.s() > std::numeric_limits<unsigned short>::max() || image.t() > std::numeric_limits<unsigned short>::max() || image.r() > std::numeric_limits<unsigned short>::max())
+        return false;
+
+    BTXHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.magic   = BTX_MAGIC;
+    header.target  = options.target ? options.target : unsigned(image.r() > 1 ? Sampler::Texture3d : Sampler::Texture2d);
+    header.format  = source_format;
+    header.width   = image.s();
+    header.height  = image.t();
+    header.depth   = header.target == Sampler::TextureCubeMap ? 1 : image.r();
+    header.mipmaps = image.getNumMipmapLevels();
+
+    // layout of the source image
+    btx_layout source_layout(header);
+
+    if(header.target == Sampler::TextureCubeMap && image.r() != 6)
+    {
+        OSG_WARN << "image_to_btx: cube map image must have 6 faces" << std::endl;
+        return false;
+    }
+
+    bool compress = options.compress && is_compressible(image);
+    aurora::bc::format bc_format = aurora::bc::format::BC1;
+    if(compress)
+    {
+        bc_format = has_alpha(image, source_layout) ? aurora::bc::format::BC3 : aurora::bc::format::BC1;
+        header.format = bc_format == aurora::bc::format::BC3 ? Sampler::RGBA_bc3 : Sampler::RGBA_bc1;
+    }
+
+    // layout of the written texture
+    btx_layout layout(header);
+
+    // tiles are whole levels when batches are not written
+    unsigned tile_size = options.no_batches ? std::numeric_limits<unsigned>::max() : unsigned(Sampler::BATCH_WIDTH);
+
+    vector<tile> tiles;
+    vector<BTXBatch> batches;
+
+    for(int mip = int(header.mipmaps) - 1; mip >= 0; --mip)
+    {
+        for(unsigned layer = 0; layer < layout.layers(mip); ++layer)
+        {
+            for(unsigned y = 0; y < layout.height(mip); y += tile_size)
+            {
+                for(unsigned x = 0; x < layout.width(mip); x += tile_size)
+                {
+                    tile t;
+                    t.mip   = mip;
+                    t.layer = layer;
+                    t.x     = x;
+                    t.y     = y;
+                    t.w     = std::min(tile_size, layout.width(mip) - x);
+                    t.h     = std::min(tile_size, layout.height(mip) - y);
+                    tiles.push_back(std::move(t));
+                }
+            }
+        }
+
+        BTXBatch mip_complete;
+        memset(&mip_complete, 0, sizeof(mip_complete));
+        mip_complete.mipmap = mip;
+        mip_complete.action = Sampler::BTX_MIP_COMPLETE;
+        batches.push_back(mip_complete);
+    }
+
+    if(options.no_batches)
+    {
+        // whole chain from the largest level in the in-memory order
+        std::stable_sort(tiles.begin(), tiles.end(), [](tile const& l, tile const& r) { return l.mip < r.mip; });
+        batches.clear();
+    }
+    else if(tiles.size() + batches.size() + 1 > std::numeric_limits<unsigned short>::max())
+    {
+        OSG_WARN << "image_to_btx: too many tiles for the batch table, use btxNoBatches" << std::endl;
+        return false;
+    }
+
+    // encode tiles on a pool of threads
+    vector<source_level> source_levels;
+    for(unsigned mip = 0; mip < header.mipmaps; ++mip)
+        source_levels.push_back(get_source_level(image, source_layout, mip));
+
+    std::atomic<size_t> next_tile(0);
+    auto worker = [&]()
+    {
+        for(size_t i = next_tile++; i < tiles.size(); i = next_tile++)
+        {
+            auto& t = tiles[i];
+            if(compress)
+                compress_tile(source_levels[t.mip], image, bc_format, t);
+            else
+                copy_tile(source_levels[t.mip], source_layout, t);
+        }
+    };
+
+    unsigned num_threads = options.num_threads ? options.num_threads : std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::max(1u, std::min<unsigned>(num_threads, tiles.size()));
+
+    vector<std::thread> threads;
+    for(unsigned i = 1; i < num_threads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for(auto& t : threads)
+        t.join();
+
+    // batch table: data batches of a level followed by its BTX_MIP_COMPLETE, then BTX_TEX_COMPLETE
+    vector<BTXBatch> table;
+    if(!options.no_batches)
+    {
+        auto mip_complete = batches.begin();
+        for(size_t i = 0; i < tiles.size(); ++i)
+        {
+            auto const& t = tiles[i];
+
+            BTXBatch b;
+            memset(&b, 0, sizeof(b));
+            b.size        = unsigned(t.data.size());
+            b.x           = t.x;
+            b.y           = t.y;
+            b.w           = t.w;
+            b.h           = t.h;
+            b.layerOrFace = t.layer;
+            b.mipmap      = t.mip;
+            b.action      = Sampler::BTX_DATA;
+            table.push_back(b);
+
+            if(i + 1 == tiles.size() || tiles[i + 1].mip != t.mip)
+                table.push_back(*mip_complete++);
+        }
+
+        BTXBatch tex_complete;
+        memset(&tex_complete, 0, sizeof(tex_complete));
+        tex_complete.action = Sampler::BTX_TEX_COMPLETE;
+        table.push_back(tex_complete);
+
+        header.batchesNum = (unsigned short)table.size();
+    }
+
+    // offsets are counted from the end of the header, the batch table comes first
+    size_t offset = table.size() * sizeof(BTXBatch);
+    size_t data_size = 0;
+    uint32_t hash = 2166136261u;
+    for(auto& b : table)
+    {
+        if(b.action != Sampler::BTX_DATA)
+            continue;
+        b.offset = unsigned(offset + data_size);
+        data_size += b.size;
+    }
+
+    for(auto const& t : tiles)
+    {
+        if(options.no_batches)
+            data_size += t.data.size();
+        hash = fnv1a(hash, t.data.data(), t.data.size());
+    }
+
+    if(offset + data_size > std::numeric_limits<unsigned>::max())
+        return false;
+
+    header.dataSize = unsigned(data_size);
+    header.hash     = hash;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(!table.empty())
+        out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(BTXBatch));
+    for(auto const& t : tiles)
+        out.write(t.data.data(), t.data.size());
+
+    return !out.fail();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <osg/Image>
+
+struct btx_write_options
+{
+    // 0: Texture2d for flat images, Texture3d for images with depth
+    unsigned target      = 0;
+    // RGB(A)8 images are compressed to BC1 (opaque) or BC3 tile by tile
+    bool     compress    = false;
+    // store the mip chain as is instead of BATCH_WIDTH tiles
+    bool     no_batches  = false;
+    // 0: all cores
+    unsigned num_threads = 0;
+};
+
+// Writes the image as BTX, every mip level, layer and face is split into BATCH_WIDTH x BATCH_WIDTH tiles
+// which are encoded in parallel. Smallest levels go first, so a streaming reader can show the texture early.
+// The image must be laid out as btx_to_image produces it.
+bool image_to_btx(osg::Image const& image, std::ostream& out, btx_write_options const& options = btx_write_options());
@@ -0,0 +1,342 @@
+// Round trip of the BTX writer: images written through ReaderWriterBTX::writeImage are read back with btx_to_image
+// and compared with the source, header fields and pixels. Uncompressed images have to come back unchanged,
+// BC compressed ones are decoded and have to stay within the error of the encoder.
+//
+// usage: btx_round_trip [path of the btx plugin]
+
+#include "sampler.h"
+#include "btx_format.h"
+#include "btx_to_image.h"
+
+#include <osgDB/Registry>
+#include <osgDB/ReaderWriter>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct test_case
+{
+    const char* name;
+    const char* options;
+    unsigned    target;
+    unsigned    width, height, depth, mipmaps;
+    bool        smooth;     // gradients the BC encoder reproduces closely, random bytes otherwise
+    bool        alpha;      // alpha below 255, the writer picks BC3 over BC1 then
+    unsigned    format;     // Sampler format expected in the file, RGBA8 when not compressed
+};
+
+// rgba of a pixel of the source image
+void source_pixel(test_case const& tc, unsigned mip, unsigned layer, unsigned x, unsigned y, unsigned char* rgba)
+{
+    if(tc.smooth)
+    {
+        // a gentle triangle wave, so the colours of a block lie on a line a BC1 block can hold
+        unsigned v = ((x + y) * 2 + layer * 16 + mip * 8) % 512;
+        unsigned t = v < 256 ? v : 511 - v;
+        rgba[0] = (unsigned char)t;
+        rgba[1] = (unsigned char)(255 - t);
+        rgba[2] = (unsigned char)(64 + t / 2);
+        rgba[3] = tc.alpha ? (unsigned char)(255 - t / 2) : 255;
+        return;
+    }
+
+    unsigned seed = ((mip * 131 + layer) * 8191 + y) * 65537 + x;
+    for(unsigned c = 0; c < 4; ++c)
+    {
+        seed = seed * 1103515245u + 12345u;
+        rgba[c] = (unsigned char)(seed >> 16);
+    }
+}
+
+// RGBA8 image with all levels and layers laid out the way btx_to_image produces them
+osg::ref_ptr<osg::Image> make_image(test_case const& tc)
+{
+    BTXHeader header;
+    memset(&header, 0, sizeof(header));
+    header.target  = tc.target;
+    header.format  = Sampler::RGBA8;
+    header.width   = tc.width;
+    header.height  = tc.height;
+    header.depth   = tc.target == Sampler::TextureCubeMap ? 1 : tc.depth;
+    header.mipmaps = tc.mipmaps;
+
+    btx_layout layout(header);
+
+    unsigned char* data = new unsigned char[layout.total_size];
+    for(unsigned mip = 0; mip < tc.mipmaps; ++mip)
+    {
+        unsigned char* level = data + layout.level_offsets[mip];
+        for(unsigned layer = 0; layer < layout.layers(mip); ++layer)
+        {
+            for(unsigned y = 0; y < layout.height(mip); ++y)
+            {
+                for(unsigned x = 0; x < layout.width(mip); ++x)
+                {
+                    unsigned char* p = level + layer * layout.layer_size(mip) + y * layout.row_pitch(mip) + x * 4;
+                    source_pixel(tc, mip, layer, x, y, p);
+                }
+            }
+        }
+    }
+
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->setImage(tc.width, tc.height, layout.layers(0), GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, data, osg::Image::USE_NEW_DELETE, 1);
+    if(tc.mipmaps > 1)
+        image->setMipmapLevels(osg::Image::MipmapDataType(layout.level_offsets.begin() + 1, layout.level_offsets.end()));
+    return image;
+}
+
+void decode_565(unsigned c, int* rgb)
+{
+    rgb[0] = ((c >> 11) & 31) * 255 / 31;
+    rgb[1] = ((c >> 5) & 63) * 255 / 63;
+    rgb[2] = (c & 31) * 255 / 31;
+}
+
+// 4x4 rgba pixels of a BC1 colour block, the four colour mode is always used by BC3
+void decode_bc1_block(const unsigned char* block, bool four_colors, unsigned char* rgba)
+{
+    unsigned c0 = block[0] | (block[1] << 8);
+    unsigned c1 = block[2] | (block[3] << 8);
+
+    int colors[4][4];
+    decode_565(c0, colors[0]);
+    decode_565(c1, colors[1]);
+    colors[0][3] = colors[1][3] = colors[2][3] = colors[3][3] = 255;
+
+    for(unsigned c = 0; c < 3; ++c)
+    {
+        if(four_colors || c0 > c1)
+        {
+            colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+            colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+        }
+        else
+        {
+            colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+            colors[3][c] = 0;
+        }
+    }
+    if(!four_colors && c0 <= c1)
+        colors[3][3] = 0;
+
+    unsigned indices = block[4] | (block[5] << 8) | (block[6] << 16) | (unsigned(block[7]) << 24);
+    for(unsigned i = 0; i < 16; ++i)
+    {
+        for(unsigned c = 0; c < 4; ++c)
+            rgba[i * 4 + c] = (unsigned char)colors[(indices >> (2 * i)) & 3][c];
+    }
+}
+
+void decode_bc3_alpha(const unsigned char* block, unsigned char* rgba)
+{
+    int a[8];
+    a[0] = block[0];
+    a[1] = block[1];
+    if(a[0] > a[1])
+    {
+        for(int i = 1; i < 7; ++i)
+            a[i + 1] = ((7 - i) * a[0] + i * a[1]) / 7;
+    }
+    else
+    {
+        for(int i = 1; i < 5; ++i)
+            a[i + 1] = ((5 - i) * a[0] + i * a[1]) / 5;
+        a[6] = 0;
+        a[7] = 255;
+    }
+
+    unsigned long long indices = 0;
+    for(unsigned i = 0; i < 6; ++i)
+        indices |= (unsigned long long)block[2 + i] << (8 * i);
+
+    for(unsigned i = 0; i < 16; ++i)
+        rgba[i * 4 + 3] = (unsigned char)a[(indices >> (3 * i)) & 7];
+}
+
+int check_header(test_case const& tc, std::string const& file, BTXHeader& header)
+{
+    int errors = 0;
+    if(file.size() < sizeof(header))
+    {
+        printf("%s: file of %u bytes has no header\n", tc.name, unsigned(file.size()));
+        return 1;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    unsigned depth = tc.target == Sampler::TextureCubeMap ? 1 : tc.depth;
+    if(header.magic != BTX_MAGIC)       { printf("%s: bad magic\n", tc.name); ++errors; }
+    if(header.target != tc.target)      { printf("%s: target %u, expected %u\n", tc.name, header.target, tc.target); ++errors; }
+    if(header.format != tc.format)   { printf("%s: format %u, expected %u\n", tc.name, header.format, tc.format); ++errors; }
+    if(header.width != tc.width || header.height != tc.height || header.depth != depth)
+    {
+        printf("%s: size %ux%ux%u, expected %ux%ux%u\n", tc.name, header.width, header.height, header.depth, tc.width, tc.height, depth);
+        ++errors;
+    }
+    if(header.mipmaps != tc.mipmaps)    { printf("%s: %u mipmaps, expected %u\n", tc.name, header.mipmaps, tc.mipmaps); ++errors; }
+
+    // data follows the batch table up to the end of the file
+    size_t data_size = file.size() - sizeof(header) - header.batchesNum * sizeof(BTXBatch);
+    if(header.dataSize != data_size)    { printf("%s: data size %u, file holds %u\n", tc.name, header.dataSize, unsigned(data_size)); ++errors; }
+
+    bool batches = strstr(tc.options, "btxNoBatches") == nullptr;
+    if(batches != (header.batchesNum > 0)) { printf("%s: %u batches\n", tc.name, header.batchesNum); ++errors; }
+    return errors;
+}
+
+int check_pixels(test_case const& tc, BTXHeader const& header, osg::Image const& source, osg::Image const& result)
+{
+    BTXHeader source_header = header;
+    source_header.format = Sampler::RGBA8;
+    btx_layout rgba_layout(source_header);
+    btx_layout layout(header);
+
+    if(unsigned(result.s()) != tc.width || unsigned(result.t()) != tc.height || unsigned(result.r()) != layout.layers(0)
+        || result.getNumMipmapLevels() != tc.mipmaps)
+    {
+        printf("%s: read image %dx%dx%d with %u levels\n", tc.name, result.s(), result.t(), result.r(), result.getNumMipmapLevels());
+        return 1;
+    }
+
+    // every level keeps all layers, not the halved depth osg::Image assumes by default
+    for(unsigned mip = 1; mip < tc.mipmaps; ++mip)
+    {
+        if(result.getMipmapOffset(mip) != layout.level_offsets[mip])
+        {
+            printf("%s: level %u at %u, expected %u\n", tc.name, mip, unsigned(result.getMipmapOffset(mip)), unsigned(layout.level_offsets[mip]));
+            return 1;
+        }
+    }
+
+    if(!layout.format_info->IsCompressed())
+    {
+        if(memcmp(result.data(), source.data(), layout.total_size) != 0)
+        {
+            printf("%s: pixels differ\n", tc.name);
+            return 1;
+        }
+        return 0;
+    }
+
+    bool bc3 = header.format == Sampler::RGBA_bc3;
+    int max_error = 0;
+    for(unsigned mip = 0; mip < tc.mipmaps; ++mip)
+    {
+        const unsigned char* level = result.getMipmapData(mip);
+        const unsigned char* source_level = source.getMipmapData(mip);
+        unsigned blocks_x = (layout.width(mip) + 3) / 4, blocks_y = (layout.height(mip) + 3) / 4;
+
+        for(unsigned layer = 0; layer < layout.layers(mip); ++layer)
+        {
+            for(unsigned by = 0; by < blocks_y; ++by)
+            {
+                for(unsigned bx = 0; bx < blocks_x; ++bx)
+                {
+                    const unsigned char* block = level + layer * layout.layer_size(mip) + by * layout.row_pitch(mip) + bx * layout.block_bytes;
+
+                    unsigned char rgba[64];
+                    if(bc3)
+                    {
+                        decode_bc1_block(block + 8, true, rgba);
+                        decode_bc3_alpha(block, rgba);
+                    }
+                    else
+                        decode_bc1_block(block, false, rgba);
+
+                    for(unsigned y = 0; y < 4 && by * 4 + y < layout.height(mip); ++y)
+                    {
+                        for(unsigned x = 0; x < 4 && bx * 4 + x < layout.width(mip); ++x)
+                        {
+                            const unsigned char* s = source_level + layer * rgba_layout.layer_size(mip)
+                                + (by * 4 + y) * rgba_layout.row_pitch(mip) + (bx * 4 + x) * 4;
+                            for(unsigned c = 0; c < 4; ++c)
+                                max_error = std::max(max_error, abs(int(rgba[(y * 4 + x) * 4 + c]) - int(s[c])));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 5:6:5 end points and the interpolation of range fit blocks over smooth gradients
+    const int tolerance = 16;
+    if(max_error > tolerance)
+    {
+        printf("%s: decoded pixels are off by up to %d\n", tc.name, max_error);
+        return 1;
+    }
+    return 0;
+}
+
+int run(osgDB::ReaderWriter* rw, test_case const& tc)
+{
+    osg::ref_ptr<osg::Image> source = make_image(tc);
+
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options(tc.options);
+    std::ostringstream out;
+    osgDB::ReaderWriter::WriteResult wr = rw->writeImage(*source, out, options.get());
+    if(!wr.success())
+    {
+        printf("%s: writeImage failed\n", tc.name);
+        return 1;
+    }
+
+    std::string file = out.str();
+    BTXHeader header;
+    int errors = check_header(tc, file, header);
+    if(errors)
+        return errors;
+
+    std::istringstream in(file);
+    osg::ref_ptr<osg::Image> result = btx_to_image(in);
+    if(!result)
+    {
+        printf("%s: btx_to_image failed\n", tc.name);
+        return 1;
+    }
+
+    errors += check_pixels(tc, header, *source, *result);
+    printf("%s: %s, %u bytes, %u batches\n", tc.name, errors ? "FAILED" : "ok", unsigned(file.size()), header.batchesNum);
+    return errors;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if(argc > 1)
+        osgDB::Registry::instance()->loadLibrary(argv[1]);
+
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("btx");
+    if(!rw)
+    {
+        printf("no ReaderWriter for btx\n");
+        return 1;
+    }
+
+    const test_case cases[] =
+    {
+        { "2d",              "btxThreads=3",                           Sampler::Texture2d,      200, 130, 1, 8, false, false, Sampler::RGBA8 },
+        { "2d no batches",   "btxNoBatches",                           Sampler::Texture2d,      200, 130, 1, 8, false, false, Sampler::RGBA8 },
+        { "array",           "btxTarget=array btxThreads=3",           Sampler::Texture2dArray, 100,  64, 3, 7, false, false, Sampler::RGBA8 },
+        { "cube",            "btxTarget=cube",                         Sampler::TextureCubeMap,  64,  64, 6, 7, false, false, Sampler::RGBA8 },
+        { "2d bc1",          "btxCompress",                            Sampler::Texture2d,      256, 128, 1, 9, true,  false, Sampler::RGBA_bc1 },
+        { "2d bc3",          "btxCompress btxThreads=2",               Sampler::Texture2d,      100,  60, 1, 7, true,  true,  Sampler::RGBA_bc3 },
+        { "array bc1",       "btxTarget=array btxCompress",            Sampler::Texture2dArray, 128, 128, 4, 8, true,  false, Sampler::RGBA_bc1 },
+        { "cube bc3",        "btxTarget=cube btxCompress",             Sampler::TextureCubeMap,  64,  64, 6, 7, true,  true,  Sampler::RGBA_bc3 },
+    };
+
+    int errors = 0;
+    for(auto const& tc : cases)
+        errors += run(rw, tc);
+
+    return errors ? 1 : 0;
+}
@@ -2,6 +2,7 @@
 #define OSG2_BINARYSTREAMOPERATOR
 
 #include <osgDB/StreamOperator>
+#include <osgDB/MemoryMappedFile>
 #include <osg/Types>
 #include <vector>
 
@@ -144,7 +145,9 @@ protected:
 class BinaryInputIterator : public osgDB::InputIterator
 {
 public:
-    BinaryInputIterator( std::istream* istream, int byteSwap )
+    BinaryInputIterator( std::istream* istream, int byteSwap ):
+        _memoryStream(0),
+        _memory(0)
     {
         _in = istream;
         setByteSwap(byteSwap);
@@ -157,40 +160,40 @@ public:
     virtual void readBool( bool& b )
     {
         char c = 0;
-        _in->read( &c, osgDB::CHAR_SIZE );
+        readRaw( &c, osgDB::CHAR_SIZE );
         b = (c!=0);
     }
 
     virtual void readChar( char& c )
-    { _in->read( &c, osgDB::CHAR_SIZE ); }
+    { readRaw( &c, osgDB::CHAR_SIZE ); }
 
     virtual void readSChar( signed char& c )
-    { _in->read( (char*)&c, osgDB::CHAR_SIZE ); }
+    { readRaw( (char*)&c, osgDB::CHAR_SIZE ); }
 
     virtual void readUChar( unsigned char& c )
-    { _in->read( (char*)&c, osgDB::CHAR_SIZE ); }
+    { readRaw( (char*)&c, osgDB::CHAR_SIZE ); }
 
     virtual void readShort( short& s )
     {
-        _in->read( (char*)&s, osgDB::SHORT_SIZE );
+        readRaw( (char*)&s, osgDB::SHORT_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&s, osgDB::SHORT_SIZE );
     }
 
     virtual void readUShort( unsigned short& s )
     {
-        _in->read( (char*)&s, osgDB::SHORT_SIZE );
+        readRaw( (char*)&s, osgDB::SHORT_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&s, osgDB::SHORT_SIZE );
     }
 
     virtual void readInt( int& i )
     {
-        _in->read( (char*)&i, osgDB::INT_SIZE );
+        readRaw( (char*)&i, osgDB::INT_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&i, osgDB::INT_SIZE );
     }
 
     virtual void readUInt( unsigned int& i )
     {
-        _in->read( (char*)&i, osgDB::INT_SIZE );
+        readRaw( (char*)&i, osgDB::INT_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&i, osgDB::INT_SIZE );
     }
 
@@ -198,7 +201,7 @@ public:
     {
         // On 64-bit systems a long may not be the same size as the file value
         int32_t value;
-        _in->read( (char*)&value, osgDB::LONG_SIZE );
+        readRaw( (char*)&value, osgDB::LONG_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&value, osgDB::LONG_SIZE );
         l = (long)value;
     }
@@ -206,20 +209,20 @@ public:
     virtual void readULong( unsigned long& l )
     {
         uint32_t value;
-        _in->read( (char*)&value, osgDB::LONG_SIZE );
+        readRaw( (char*)&value, osgDB::LONG_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&value, osgDB::LONG_SIZE );
         l = (unsigned long)value;
     }
 
     virtual void readFloat( float& f )
     {
-        _in->read( (char*)&f, osgDB::FLOAT_SIZE );
+        readRaw( (char*)&f, osgDB::FLOAT_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&f, osgDB::FLOAT_SIZE );
     }
 
     virtual void readDouble( double& d )
     {
-        _in->read( (char*)&d, osgDB::DOUBLE_SIZE );
+        readRaw( (char*)&d, osgDB::DOUBLE_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&d, osgDB::DOUBLE_SIZE );
     }
 
@@ -230,7 +233,7 @@ public:
         if ( size>0 )
         {
             s.resize( size );
-            _in->read( (char*)s.c_str(), size );
+            readRaw( (char*)s.c_str(), size );
         }
         else if ( size<0 )
         {
@@ -245,7 +248,7 @@ public:
     virtual void readGLenum( osgDB::ObjectGLenum& value )
     {
         GLenum e = 0;
-        _in->read( (char*)&e, osgDB::GLENUM_SIZE );
+        readRaw( (char*)&e, osgDB::GLENUM_SIZE );
         if ( _byteSwap ) osg::swapBytes( (char*)&e, osgDB::GLENUM_SIZE );
         value.set( e );
     }
@@ -255,7 +258,7 @@ public:
         int value = 0;
         if ( prop._mapProperty )
         {
-            _in->read( (char*)&value, osgDB::INT_SIZE );
+            readRaw( (char*)&value, osgDB::INT_SIZE );
             if ( _byteSwap ) osg::swapBytes( (char*)&value, osgDB::INT_SIZE );
         }
         prop.set( value );
@@ -275,14 +278,14 @@ public:
                 if (getInputStream() && getInputStream()->getFileVersion() > 148)
                 {
                    uint64_t size = 0;
-                   _in->read( (char*)&size, osgDB::INT64_SIZE);
+                   readRaw( (char*)&size, osgDB::INT64_SIZE);
                    if ( _byteSwap ) osg::swapBytes( (char*)&size, osgDB::INT64_SIZE);
                    _blockSizes.push_back( size );
                 }
                 else
                 {
                    int size = 0;
-                   _in->read( (char*)&size, osgDB::INT_SIZE);
+                   readRaw( (char*)&size, osgDB::INT_SIZE);
                    if ( _byteSwap ) osg::swapBytes( (char*)&size, osgDB::INT_SIZE);
                    _blockSizes.push_back( size );
                 }
@@ -296,7 +299,7 @@ public:
     }
 
     virtual void readCharArray( char* s, unsigned int size )
-    { if ( size>0 ) _in->read( s, size ); }
+    { if ( size>0 ) readRaw( s, size ); }
 
     virtual void readWrappedString( std::string& str )
     { readString( str ); }
@@ -314,8 +317,26 @@ public:
     }
 
 protected:
+    // reads straight from memory when the stream is over a MemoryMappedFile, skipping the istream sentry and file buffer
+    inline void readRaw( char* s, unsigned int size )
+    {
+        // the stream is replaced by InputStream::decompress()
+        if ( _memoryStream!=_in )
+        {
+            _memoryStream = _in;
+            _memory = dynamic_cast<osgDB::MemoryStreamBuffer*>( _in->rdbuf() );
+        }
+
+        // reads the memory buffer can't serve in one go, such as those crossing the end of a decompressed block,
+        // go through the std::istream which sets eof and fail on a short read
+        if ( !_memory || !_memory->read(s, size) ) _in->read( s, size );
+    }
+
     std::vector<std::streampos> _beginPositions;
     std::vector<std::streampos> _blockSizes;
+
+    std::istream*               _memoryStream;
+    osgDB::MemoryStreamBuffer*  _memory;
 };
 
 #endif
@@ -16,6 +16,7 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <osgDB/MemoryMappedFile>
 #include <stdlib.h>
 #include "AsciiStreamOperator.h"
 #include "BinaryStreamOperator.h"
@@ -128,9 +129,10 @@ public:
         supportsOption( "Ascii", "Import/Export option: Force reading/writing ascii file" );
         supportsOption( "XML", "Import/Export option: Force reading/writing XML file" );
         supportsOption( "ForceReadingImage", "Import option: Load an empty image instead if required file missed" );
+        supportsOption( "NoMemoryMapping", "Import option: Read binary files through a file stream rather than mapping them into memory" );
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
-        supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
+        supportsOption( "Compressor=<name>", "Export option: Use an inbuilt (null, zlib, zlib_blocks, lz) or user-defined compressor" );
         supportsOption( "WriteImageHint=<hint>", "Export option: Hint of writing image to stream: "
                         "<IncludeData> writes Image::data() directly; "
                         "<IncludeFile> writes the image file itself to stream; "
@@ -174,6 +176,14 @@ public:
         return local_opt.release();
     }
 
+    // binary files are read straight from a mapping of the file, which saves the copy through the file buffer
+    osgDB::MemoryMappedFile* openMemoryMappedFile( const std::string& fileName, std::ios::openmode mode, const Options* options ) const
+    {
+        if ( (mode & std::ios::binary)==0 || osgDB::MemoryMappedFile::isDisabled() ) return 0;
+        if ( options && options->getOptionString().find("NoMemoryMapping")!=std::string::npos ) return 0;
+        return osgDB::MemoryMappedFile::open( fileName );
+    }
+
     virtual ReadResult readObject( const std::string& file, const Options* options ) const
     {
         ReadResult result = ReadResult::FILE_LOADED;
@@ -182,6 +192,13 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<osgDB::MemoryMappedFile> mappedFile = openMemoryMappedFile( fileName, mode, local_opt );
+        if ( mappedFile.valid() )
+        {
+            osgDB::imappedstream istream( mappedFile.get() );
+            return readObject( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readObject( istream, local_opt );
     }
@@ -213,6 +230,13 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<osgDB::MemoryMappedFile> mappedFile = openMemoryMappedFile( fileName, mode, local_opt );
+        if ( mappedFile.valid() )
+        {
+            osgDB::imappedstream istream( mappedFile.get() );
+            return readImage( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readImage( istream, local_opt );
     }
@@ -244,6 +268,13 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<osgDB::MemoryMappedFile> mappedFile = openMemoryMappedFile( fileName, mode, local_opt );
+        if ( mappedFile.valid() )
+        {
+            osgDB::imappedstream istream( mappedFile.get() );
+            return readNode( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readNode( istream, local_opt );
     }
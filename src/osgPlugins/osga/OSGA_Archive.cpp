@@ -320,7 +320,8 @@ void OSGA_Archive::IndexBlock::setPositionNextIndexBlock(pos_type position)
 
 OSGA_Archive::OSGA_Archive():
     _version(0.0f),
-    _status(READ)
+    _status(READ),
+    _useMemoryMapping(true)
 {
 }
 
@@ -330,6 +331,54 @@ OSGA_Archive::~OSGA_Archive()
 }
 
 
+void OSGA_Archive::HashIndex::build(const FileNamePositionMap& indexMap)
+{
+    unsigned int numBuckets = 16;
+    while (numBuckets<indexMap.size()) numBuckets *= 2;
+
+    _buckets.assign(numBuckets, 0);
+    _entries.clear();
+    _entries.reserve(indexMap.size());
+
+    for(FileNamePositionMap::const_iterator itr=indexMap.begin();
+        itr!=indexMap.end();
+        ++itr)
+    {
+        Entry entry;
+        entry._itr = itr;
+        entry._hash = hash(itr->first);
+
+        unsigned int& bucket = _buckets[entry._hash & (numBuckets-1)];
+        entry._next = bucket;
+        _entries.push_back(entry);
+        bucket = static_cast<unsigned int>(_entries.size());
+    }
+}
+
+const OSGA_Archive::PositionSizePair* OSGA_Archive::HashIndex::find(const std::string& filename) const
+{
+    if (_buckets.empty()) return 0;
+
+    unsigned int h = hash(filename);
+    for(unsigned int i = _buckets[h & (_buckets.size()-1)]; i!=0; i = _entries[i-1]._next)
+    {
+        const Entry& entry = _entries[i-1];
+        if (entry._hash==h && entry._itr->first==filename) return &(entry._itr->second);
+    }
+    return 0;
+}
+
+unsigned int OSGA_Archive::HashIndex::hash(const std::string& str)
+{
+    // FNV-1a
+    unsigned int h = 2166136261u;
+    for(std::string::const_iterator itr=str.begin(); itr!=str.end(); ++itr)
+    {
+        h = (h ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return h;
+}
+
 bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSize)
 {
     SERIALIZER();
@@ -341,7 +390,15 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
         _status = status;
         _input.open(filename.c_str(), std::ios_base::binary | std::ios_base::in);
 
-        return _open(_input);
+        if (!_open(_input)) return false;
+
+        // reads from the mapping are independent of each other, fall back to the serialized stream if it can't be mapped
+        if (_useMemoryMapping && !osgDB::MemoryMappedFile::isDisabled())
+        {
+            _mappedFile = osgDB::MemoryMappedFile::open(filename);
+            OSG_INFO<<"OSGA_Archive::open("<<filename<<") memory mapped "<<_mappedFile.valid()<<std::endl;
+        }
+        return true;
     }
     else
     {
@@ -375,6 +432,7 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
                 }
             }
             _input.close();
+            _mappedFile = 0;
             _status = WRITE;
 
             osgDB::open(_output, filename.c_str(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
@@ -461,6 +519,7 @@ bool OSGA_Archive::_open(std::istream& input)
             }
 
             // now need to build the filename map.
+            _hashIndex.clear();
             _indexMap.clear();
 
             if (!_indexBlockList.empty())
@@ -475,6 +534,8 @@ bool OSGA_Archive::_open(std::istream& input)
                 (*itr)->getFileReferences(_indexMap);
             }
 
+            _hashIndex.build(_indexMap);
+
             for(FileNamePositionMap::iterator mitr=_indexMap.begin();
                 mitr!=_indexMap.end();
                 ++mitr)
@@ -494,6 +555,7 @@ void OSGA_Archive::close()
     SERIALIZER();
 
     _input.close();
+    _mappedFile = 0;
 
     if (_status==WRITE)
     {
@@ -509,7 +571,7 @@ std::string OSGA_Archive::getMasterFileName() const
 
 osgDB::FileType OSGA_Archive::getFileType(const std::string& filename) const
 {
-    if (_indexMap.count(filename)!=0) return osgDB::REGULAR_FILE;
+    if (_hashIndex.find(filename)) return osgDB::REGULAR_FILE;
     return osgDB::FILE_NOT_FOUND;
 }
 
@@ -548,7 +610,7 @@ void OSGA_Archive::writeIndexBlocks()
 
 bool OSGA_Archive::fileExists(const std::string& filename) const
 {
-    return (_indexMap.count(filename)!=0);
+    return _hashIndex.find(filename)!=0;
 }
 
 bool OSGA_Archive::addFileReference(pos_type position, size_type size, const std::string& fileName)
@@ -726,16 +788,15 @@ struct OSGA_Archive::ReadShaderFunctor : public OSGA_Archive::ReadFunctor
 
 ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
 {
-    SERIALIZER();
-
+    // the status, index and mapping are only changed by open() and close(), reads need no lock unless they share _input
     if (_status!=READ)
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, archive opened as write only."<<std::endl;
         return ReadResult(ReadResult::FILE_NOT_HANDLED);
     }
 
-    FileNamePositionMap::const_iterator itr = _indexMap.find(readFunctor._filename);
-    if (itr==_indexMap.end())
+    const PositionSizePair* positionSize = _hashIndex.find(readFunctor._filename);
+    if (!positionSize)
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file not found in archive"<<std::endl;
         return ReadResult(ReadResult::FILE_NOT_FOUND);
@@ -750,11 +811,29 @@ ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
 
     OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<")"<<std::endl;
 
-    _input.seekg( STREAM_POS( itr->second.first ) );
+    osg::ref_ptr<osgDB::MemoryMappedFile> mappedFile = _mappedFile;
+    if (mappedFile.valid())
+    {
+        if (positionSize->first<0 || positionSize->second<0 ||
+            static_cast<unsigned long long>(positionSize->first+positionSize->second)>mappedFile->size())
+        {
+            OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file extends past the end of the archive"<<std::endl;
+            return ReadResult(ReadResult::ERROR_IN_READING_FILE);
+        }
+
+        // a stream of its own over just the file's bytes in the mapping
+        osgDB::MemoryStreamBuffer buffer(mappedFile->data()+positionSize->first, static_cast<size_t>(positionSize->second));
+        std::istream input(&buffer);
+        return readFunctor.doRead(*rw, input);
+    }
+
+    SERIALIZER();
+
+    _input.seekg( STREAM_POS( positionSize->first ) );
 
     // set up proxy stream buffer to provide the faked ending.
     std::istream& ins = _input;
-    proxy_streambuf mystreambuf(ins.rdbuf(),itr->second.second);
+    proxy_streambuf mystreambuf(ins.rdbuf(),positionSize->second);
     ins.rdbuf(&mystreambuf);
 
     ReaderWriter::ReadResult result = readFunctor.doRead(*rw, _input);
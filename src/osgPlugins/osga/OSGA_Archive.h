@@ -14,6 +14,7 @@
 #include <osg/Notify>
 #include <osgDB/Archive>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MemoryMappedFile>
 
 #include <OpenThreads/ScopedLock>
 #include <OpenThreads/ReentrantMutex>
@@ -41,6 +42,11 @@ class OSGA_Archive : public osgDB::Archive
         /** open the archive for reading.*/
         virtual bool open(std::istream& fin);
 
+        /** Set whether an archive opened for reading from a file is memory mapped, which lets any number of threads
+          * read from it at once. Otherwise reads are serialized on a single stream. Must be set before open().*/
+        void setUseMemoryMapping(bool flag) { _useMemoryMapping = flag; }
+        bool getUseMemoryMapping() const { return _useMemoryMapping; }
+
         /** close the archive.*/
         virtual void close();
 
@@ -103,6 +109,35 @@ class OSGA_Archive : public osgDB::Archive
 
     protected:
 
+        /** Hash table over the entries of a FileNamePositionMap, which must not change while the index is in use.
+          * Built when the archive is opened for reading and only read from then on, so lookups need no locking.*/
+        class HashIndex
+        {
+        public:
+            HashIndex() {}
+
+            void build(const FileNamePositionMap& indexMap);
+            void clear() { _buckets.clear(); _entries.clear(); }
+
+            /** return the position and size of the file, or 0 if it isn't in the archive.*/
+            const PositionSizePair* find(const std::string& filename) const;
+
+        protected:
+
+            static unsigned int hash(const std::string& str);
+
+            struct Entry
+            {
+                FileNamePositionMap::const_iterator _itr;
+                unsigned int                        _hash;
+                unsigned int                        _next;
+            };
+
+            // index+1 of the first entry in each bucket, 0 for an empty bucket
+            std::vector<unsigned int>   _buckets;
+            std::vector<Entry>          _entries;
+        };
+
         mutable OpenThreads::ReentrantMutex _serializerMutex;
 
         class IndexBlock;
@@ -223,6 +258,10 @@ class OSGA_Archive : public osgDB::Archive
         std::string         _masterFileName;
         IndexBlockList      _indexBlockList;
         FileNamePositionMap _indexMap;
+        HashIndex           _hashIndex;
+
+        bool                                _useMemoryMapping;
+        osg::ref_ptr<osgDB::MemoryMappedFile> _mappedFile;
 
 
         template <typename T>
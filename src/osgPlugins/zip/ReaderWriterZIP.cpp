@@ -14,6 +14,7 @@ class ReaderWriterZIP : public osgDB::ReaderWriter
         ReaderWriterZIP()
         {
             supportsExtension("zip","Zip archive format");
+            supportsOption("NoMemoryMapping","Import option: Open archives through the unzip file reader rather than mapping them into memory");
             osgDB::Registry::instance()->addArchiveExtension("zip");
         }
 
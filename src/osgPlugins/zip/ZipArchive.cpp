@@ -38,7 +38,9 @@
 
 
 ZipArchive::ZipArchive()  :
-_zipLoaded( false )
+_zipLoaded( false ),
+_zipData( 0 ),
+_zipDataSize( 0 )
 {
 }
 
@@ -54,15 +56,22 @@ void ZipArchive::close()
         OpenThreads::ScopedLock<OpenThreads::Mutex> exclusive(_zipMutex);
         if ( _zipLoaded )
         {
-            // close the file (on one thread since it's a shared file)
-            const PerThreadData& data = getDataNoLock();
-            CloseZip( data._zipHandle );
+            // close the handles of all the threads that read from it
+            for(PerThreadDataMap::iterator itr = _perThreadData.begin(); itr != _perThreadData.end(); ++itr)
+            {
+                if ( itr->second._zipHandle != NULL ) CloseZip( itr->second._zipHandle );
+            }
 
             // clear out the file handles
             _perThreadData.clear();
 
             // clear out the index.
             _zipIndex.clear();
+            _zipLocations.clear();
+
+            _mappedFile = 0;
+            _zipData = 0;
+            _zipDataSize = 0;
 
             _zipLoaded = false;
         }
@@ -129,6 +138,18 @@ bool ZipArchive::open(const std::string& file, ArchiveStatus /*status*/, const o
 
             _password = ReadPassword(options);
 
+            // map the archive so that entries can be read straight from memory
+            if ( !osgDB::MemoryMappedFile::isDisabled() &&
+                 !(options && options->getOptionString().find("NoMemoryMapping")!=std::string::npos) )
+            {
+                _mappedFile = osgDB::MemoryMappedFile::open( _filename );
+                if ( _mappedFile.valid() )
+                {
+                    _zipData = _mappedFile->data();
+                    _zipDataSize = _mappedFile->size();
+                }
+            }
+
             // open the zip file in this thread:
             const PerThreadData& data = getDataNoLock();
 
@@ -136,6 +157,7 @@ bool ZipArchive::open(const std::string& file, ArchiveStatus /*status*/, const o
             if ( data._zipHandle != NULL )
             {
                 IndexZipFiles( data._zipHandle );
+                IndexZipLocations();
                 _zipLoaded = true;
             }
         }
@@ -162,6 +184,8 @@ bool ZipArchive::open(std::istream& fin, const osgDB::ReaderWriter::Options* opt
             std::stringstream buf;
             buf << fin.rdbuf();
             _membuffer = buf.str();
+            _zipData = _membuffer.data();
+            _zipDataSize = _membuffer.size();
 
             _password = ReadPassword(options);
 
@@ -171,6 +195,7 @@ bool ZipArchive::open(std::istream& fin, const osgDB::ReaderWriter::Options* opt
             if ( data._zipHandle != NULL )
             {
                 IndexZipFiles( data._zipHandle );
+                IndexZipLocations();
                 _zipLoaded = true;
             }
         }
@@ -189,7 +214,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readObject(const std::string& file,
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -222,7 +247,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readImage(const std::string& file,co
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -255,7 +280,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readHeightField(const std::string& f
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -288,7 +313,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readNode(const std::string& file,con
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -321,7 +346,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readScript(const std::string& file,c
     const ZIPENTRY* ze = GetZipEntry(file);
     if (ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -354,7 +379,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readShader(const std::string& file,c
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -408,46 +433,98 @@ osgDB::ReaderWriter::WriteResult ZipArchive::writeShader(const osg::Shader& /*sh
 }
 
 
-osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* /*options*/, std::stringstream& buffer) const
+osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* /*options*/, ZipEntryStream& buffer) const
+{
+    if (ze == 0 || !ReadZipEntryData(ze, buffer))
+    {
+        return NULL;
+    }
+
+    std::string file_ext = osgDB::getFileExtension(ze->name);
+    return osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
+}
+
+namespace
 {
-    if (ze != 0)
+    // zip headers are little endian and unaligned
+    inline unsigned int readUInt16(const char* ptr)
     {
-        char* ibuf = new (std::nothrow) char[ze->unc_size];
-        if (ibuf)
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(ptr);
+        return p[0] | (p[1]<<8);
+    }
+
+    inline unsigned int readUInt32(const char* ptr)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(ptr);
+        return p[0] | (p[1]<<8) | (p[2]<<16) | (static_cast<unsigned int>(p[3])<<24);
+    }
+}
+
+bool ZipArchive::CheckZipEntryCrc(const ZIPENTRY* ze, const ZipEntryLocation& location, const char* data, size_t size) const
+{
+    // as UnzipItem() does, so a corrupt entry fails to read rather than handing its data to the plugin
+    if (CrcZipData(data, static_cast<unsigned int>(size)) == location._crc) return true;
+
+    OSG_WARN << "Error reading " << ze->name << " from zip file: " << _filename << ", crc doesn't match." << std::endl;
+    return false;
+}
+
+bool ZipArchive::ReadZipEntryData(const ZIPENTRY* ze, ZipEntryStream& buffer) const
+{
+    // entries that aren't encrypted are read straight from the archive in memory without any locking,
+    // stored ones without even a copy
+    if (ze->index >= 0 && static_cast<size_t>(ze->index) < _zipLocations.size())
+    {
+        const ZipEntryLocation& location = _zipLocations[ze->index];
+        const char* header = _zipData + location._localHeaderOffset;
+
+        if ((location._flags & 1) == 0 && (location._method == 0 || location._method == 8) &&
+            location._localHeaderOffset + 30 <= _zipDataSize && readUInt32(header) == 0x04034b50)
         {
-            // fetch the handle for the current thread:
-            const PerThreadData& data = getData();
-            if ( data._zipHandle != NULL )
+            size_t dataOffset = location._localHeaderOffset + 30 + readUInt16(header+26) + readUInt16(header+28);
+            if (dataOffset + location._compressedSize <= _zipDataSize)
             {
-                ZRESULT result = UnzipItem(data._zipHandle, ze->index, ibuf, ze->unc_size);
-                bool unzipSuccesful = CheckZipErrorCode(result);
-                if(unzipSuccesful)
+                const char* data = _zipData + dataOffset;
+                if (location._method == 0)
                 {
-                    buffer.write(ibuf,ze->unc_size);
-                }
+                    if (location._compressedSize != location._size) return false;
+                    if (!CheckZipEntryCrc(ze, location, data, location._size)) return false;
 
-                delete[] ibuf;
-
-                std::string file_ext = osgDB::getFileExtension(ze->name);
+                    buffer.setData(data, location._size);
+                    return true;
+                }
 
-                osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
-                if (rw != NULL)
+                std::string& inflated = buffer.getInflatedData();
+                inflated.resize(location._size);
+                if (location._size > 0 &&
+                    !CheckZipErrorCode(InflateZipData(data, static_cast<unsigned int>(location._compressedSize), &inflated[0], static_cast<unsigned int>(location._size))))
                 {
-                    return rw;
+                    return false;
                 }
+                if (!CheckZipEntryCrc(ze, location, inflated.data(), inflated.size())) return false;
+
+                buffer.setData(inflated.data(), inflated.size());
+                return true;
             }
-            else
-            {
-                delete[] ibuf;
-            }
-        }
-        else
-        {
-            //std::cout << "Error- failed to allocate enough memory to unzip file '" << ze->name << ", with size '" << ze->unc_size << std::endl;
         }
     }
 
-    return NULL;
+    // otherwise unzip through the current thread's own handle on the archive
+    const PerThreadData& data = getData();
+    if (data._zipHandle == NULL || ze->unc_size < 0)
+    {
+        return false;
+    }
+
+    std::string& inflated = buffer.getInflatedData();
+    inflated.resize(ze->unc_size);
+    if (ze->unc_size > 0 && !CheckZipErrorCode(UnzipItem(data._zipHandle, ze->index, &inflated[0], ze->unc_size)))
+    {
+        return false;
+    }
+
+    buffer.setData(inflated.data(), inflated.size());
+    return true;
 }
 
 void CleanupFileString(std::string& strFileOrDir)
@@ -511,6 +588,70 @@ void ZipArchive::IndexZipFiles(HZIP hz)
     }
 }
 
+void ZipArchive::IndexZipLocations()
+{
+    _zipLocations.clear();
+    if (_zipData == NULL || _zipDataSize < 22)
+    {
+        return;
+    }
+
+    // the end of central directory record is the last 22 bytes, followed by a comment of up to 64k
+    const char* end = _zipData + _zipDataSize;
+    const char* endRecord = NULL;
+    for (const char* ptr = end - 22; ptr >= _zipData && end - ptr <= 22 + 65535; --ptr)
+    {
+        if (readUInt32(ptr) == 0x06054b50)
+        {
+            endRecord = ptr;
+            break;
+        }
+    }
+    if (endRecord == NULL)
+    {
+        return;
+    }
+
+    unsigned int numEntries = readUInt16(endRecord+10);
+    size_t directorySize = readUInt32(endRecord+12);
+    size_t directoryOffset = readUInt32(endRecord+16);
+    if (directoryOffset + directorySize > _zipDataSize)
+    {
+        return;
+    }
+
+    // ZIPENTRY::index counts the central directory entries in order
+    std::vector<ZipEntryLocation> locations;
+    locations.reserve(numEntries);
+
+    const char* ptr = _zipData + directoryOffset;
+    const char* directoryEnd = ptr + directorySize;
+    for (unsigned int i = 0; i < numEntries; ++i)
+    {
+        if (directoryEnd - ptr < 46 || readUInt32(ptr) != 0x02014b50)
+        {
+            return;
+        }
+
+        ZipEntryLocation location;
+        location._flags = readUInt16(ptr+8);
+        location._method = readUInt16(ptr+10);
+        location._crc = readUInt32(ptr+16);
+        location._compressedSize = readUInt32(ptr+20);
+        location._size = readUInt32(ptr+24);
+        location._localHeaderOffset = readUInt32(ptr+42);
+        locations.push_back(location);
+
+        ptr += 46 + readUInt16(ptr+28) + readUInt16(ptr+30) + readUInt16(ptr+32);
+    }
+
+    // fall back to unzipping through handles if the central directory doesn't agree with the unzipper
+    if (locations.size() == static_cast<size_t>(_mainRecord.index))
+    {
+        _zipLocations.swap(locations);
+    }
+}
+
 ZIPENTRY* ZipArchive::GetZipEntry(const std::string& filename)
 {
     ZIPENTRY* ze = NULL;
@@ -683,13 +824,13 @@ ZipArchive::getDataNoLock() const
 
         // data does not already exist, so open the ZIP with a handle exclusively for this thread:
         PerThreadData& data = ncThis->_perThreadData[current];
-        if ( !_filename.empty() )
+        if ( _zipData != NULL )
         {
-            data._zipHandle = OpenZip( _filename.c_str(), _password.c_str() );
+            data._zipHandle = OpenZip( (void*)_zipData, _zipDataSize, _password.c_str() );
         }
-        else if ( !_membuffer.empty() )
+        else if ( !_filename.empty() )
         {
-            data._zipHandle = OpenZip( (void*)_membuffer.c_str(), _membuffer.length(), _password.c_str() );
+            data._zipHandle = OpenZip( _filename.c_str(), _password.c_str() );
         }
         else
         {
@@ -5,10 +5,33 @@
 #include <osgDB/FileUtils>
 
 #include <osgDB/Archive>
+#include <osgDB/MemoryMappedFile>
 #include <OpenThreads/Mutex>
 
 #include "unzip.h"
 
+/** Stream over a zip entry, either a view straight into the archive's memory or onto the inflated entry.*/
+class ZipEntryStream : public std::istream
+{
+    public:
+        ZipEntryStream() : std::istream(0), _buffer(0) {}
+        ~ZipEntryStream() { delete _buffer; }
+
+        void setData(const char* data, size_t size)
+        {
+            delete _buffer;
+            _buffer = new osgDB::MemoryStreamBuffer(data, size);
+            rdbuf(_buffer);
+        }
+
+        /** storage for entries that have to be inflated, pass it to setData() once filled in.*/
+        std::string& getInflatedData() { return _inflatedData; }
+
+    protected:
+        std::string                 _inflatedData;
+        osgDB::MemoryStreamBuffer*  _buffer;
+};
+
 
 class ZipArchive : public osgDB::Archive
 {
@@ -66,9 +89,11 @@ class ZipArchive : public osgDB::Archive
 
     protected:
 
-        osgDB::ReaderWriter* ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, std::stringstream& streamIn) const;
+        osgDB::ReaderWriter* ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, ZipEntryStream& streamIn) const;
+        bool ReadZipEntryData(const ZIPENTRY* ze, ZipEntryStream& streamIn) const;
 
         void IndexZipFiles(HZIP hz);
+        void IndexZipLocations();
         const ZIPENTRY* GetZipEntry(const std::string& filename) const;
         ZIPENTRY* GetZipEntry(const std::string& filename);
 
@@ -88,6 +113,31 @@ class ZipArchive : public osgDB::Archive
         ZipEntryMap        _zipIndex;
         ZIPENTRY           _mainRecord;
 
+        // whole archive in memory, mapped from the file or read from the stream it was opened with
+        osg::ref_ptr<osgDB::MemoryMappedFile> _mappedFile;
+        const char*        _zipData;
+        size_t             _zipDataSize;
+
+        /** Where an entry's data is in _zipData, read from the central directory when the archive is opened and
+          * never changed after, so entries can be read by any number of threads without locking.*/
+        struct ZipEntryLocation
+        {
+            ZipEntryLocation() : _method(0), _flags(0), _crc(0), _localHeaderOffset(0), _compressedSize(0), _size(0) {}
+
+            unsigned int _method;
+            unsigned int _flags;
+            unsigned int _crc;
+            size_t       _localHeaderOffset;
+            size_t       _compressedSize;
+            size_t       _size;
+        };
+
+        // indexed by ZIPENTRY::index, empty if the central directory couldn't be read
+        std::vector<ZipEntryLocation> _zipLocations;
+
+        /** Check entry data read straight from _zipData against the crc of the central directory.*/
+        bool CheckZipEntryCrc(const ZIPENTRY* ze, const ZipEntryLocation& location, const char* data, size_t size) const;
+
         struct PerThreadData {
             HZIP _zipHandle;
         };
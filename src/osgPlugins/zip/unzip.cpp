@@ -4540,6 +4540,27 @@ ZRESULT CloseZipU(HZIP hz)
   return lasterrorU;
 }
 
+ZRESULT InflateZipData(const void *src,unsigned int srclen, void *dst,unsigned int dstlen)
+{ z_stream stream;
+  stream.zalloc = (alloc_func)0;
+  stream.zfree = (free_func)0;
+  stream.opaque = (voidpf)0;
+  if (inflateInit2(&stream)!=Z_OK) return ZR_FLATE;
+  stream.next_in = (Byte*)src; stream.avail_in = srclen;
+  stream.next_out = (Byte*)dst; stream.avail_out = dstlen;
+  // with no zlib header inflate may want a byte past the end before it reports Z_STREAM_END,
+  // the size is known so stop once it's all there
+  int err = Z_OK;
+  while (err==Z_OK && stream.avail_out>0) err = inflate(&stream,Z_SYNC_FLUSH);
+  bool complete = stream.total_out==dstlen && (err==Z_OK || err==Z_STREAM_END);
+  inflateEnd(&stream);
+  return complete ? ZR_OK : ZR_FLATE;
+}
+
+unsigned long CrcZipData(const void *buf,unsigned int len)
+{ return ucrc32(0L,(const Byte*)buf,len);
+}
+
 bool IsZipHandleU(HZIP hz)
 { if (hz==0) return false;
   TUnzipHandleData *han = (TUnzipHandleData*)hz;
@@ -160,6 +160,15 @@ ZRESULT SetUnzipBaseDir(HZIP hz, const TCHAR *dir);
 ZRESULT CloseZip(HZIP hz);
 // CloseZip - the zip handle must be closed with this function.
 
+ZRESULT InflateZipData(const void *src,unsigned int srclen, void *dst,unsigned int dstlen);
+// InflateZipData - inflates the raw deflate data of an item, exactly dstlen bytes of it,
+// independently of any HZIP. It keeps no state between calls, so any number of threads
+// can inflate at once. The data isn't checked against the item's crc.
+
+unsigned long CrcZipData(const void *buf,unsigned int len);
+// CrcZipData - the crc-32 of the data, to check an item unzipped by InflateZipData, or stored,
+// against the crc the central directory records for it.
+
 unsigned int FormatZipMessage(ZRESULT code, TCHAR *buf,unsigned int len);
 // FormatZipMessage - given an error code, formats it as a string.
 // It returns the length of the error message. If buf/len points
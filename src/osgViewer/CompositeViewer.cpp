@@ -1438,6 +1438,13 @@ void CompositeViewer::updateTraversal()
         }
         view->updateSlaves();
 
+        // request the tiles the camera is heading towards, now that it has been placed for this frame
+        osgDB::DatabasePager* dp = view->getScene() ? view->getScene()->getDatabasePager() : 0;
+        if (dp && dp->getDoPrefetch() && view->getSceneData())
+        {
+            dp->prefetch(view->getSceneData(), *(view->getCamera()), *_frameStamp);
+        }
+
     }
 
     if (getViewerStats() && getViewerStats()->collectStats("update"))
@@ -1213,6 +1213,13 @@ void Viewer::updateTraversal()
 
     updateSlaves();
 
+    // request the tiles the camera is heading towards, now that it has been placed for this frame
+    osgDB::DatabasePager* dp = _scene->getDatabasePager();
+    if (dp && dp->getDoPrefetch() && getSceneData())
+    {
+        dp->prefetch(getSceneData(), *_camera, *_frameStamp);
+    }
+
     if (getViewerStats() && getViewerStats()->collectStats("update"))
     {
         double endUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
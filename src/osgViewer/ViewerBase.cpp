@@ -39,6 +39,7 @@ static osg::ApplicationUsageProxy ViewerBase_e3(osg::ApplicationUsage::ENVIRONME
 static osg::ApplicationUsageProxy ViewerBase_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_RUN_FRAME_SCHEME","Frame rate manage scheme that viewer run should use,  ON_DEMAND or CONTINUOUS (default).");
 static osg::ApplicationUsageProxy ViewerBase_e5(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_RUN_MAX_FRAME_RATE","Set the maximum number of frame as second that viewer run. 0.0 is default and disables an frame rate capping.");
 static osg::ApplicationUsageProxy ViewerBase_e6(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_RUN_FRAME_COUNT", "Set the maximum number of frames to run the viewer run method.");
+static osg::ApplicationUsageProxy ViewerBase_e8(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PRELOAD_PLUGINS <ext>[ ext]..", "Load the plugins of the listed file extensions on a background thread when the viewer is created, ALL loads every plugin of the plugin manifest.");
 
 using namespace osgViewer;
 
@@ -79,6 +80,23 @@ void ViewerBase::viewerBaseInit()
 
     osg::getEnvVar("OSG_RUN_MAX_FRAME_RATE", _runMaxFrameRate);
 
+    if (osg::getEnvVar("OSG_PRELOAD_PLUGINS", str))
+    {
+        std::vector<std::string> extensions;
+        if (str!="ALL" && str!="all")
+        {
+            std::string::size_type start = str.find_first_not_of(" ,;");
+            while(start!=std::string::npos)
+            {
+                std::string::size_type end = str.find_first_of(" ,;", start);
+                extensions.push_back(str.substr(start, end==std::string::npos ? std::string::npos : end-start));
+                start = str.find_first_not_of(" ,;", end);
+            }
+        }
+
+        if (!extensions.empty() || str=="ALL" || str=="all") osgDB::Registry::instance()->preloadPlugins(extensions);
+    }
+
     _useConfigureAffinity = true;
 }
 